@@ -0,0 +1,67 @@
+//
+// Map benchmark: std::map against SPU::Map on the same operations
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include "../libspu/map.hpp"
+
+using namespace std;
+
+using bench_clock = chrono::steady_clock;
+
+double seconds_since(bench_clock::time_point start) {
+  return chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+/// Вставка, поиск, обход и удаление n случайных ключей
+template <class MapT>
+void run(const string &name, MapT &m, unsigned n) {
+  srand(1);
+  auto start = bench_clock::now();
+  for (unsigned i = 0; i < n; i++) {
+    m.insert({ (unsigned long long) rand() * RAND_MAX + rand(), (double) i });
+  }
+  double ins = seconds_since(start);
+
+  srand(1);
+  start = bench_clock::now();
+  unsigned found = 0;
+  for (unsigned i = 0; i < n; i++) {
+    found += m.find((unsigned long long) rand() * RAND_MAX + rand()) != m.end();
+  }
+  double fnd = seconds_since(start);
+
+  start = bench_clock::now();
+  double sum = 0;
+  for (auto &ex : m) {
+    sum += ex.second;
+  }
+  double scan = seconds_since(start);
+
+  srand(1);
+  start = bench_clock::now();
+  for (unsigned i = 0; i < n; i++) {
+    m.erase((unsigned long long) rand() * RAND_MAX + rand());
+  }
+  double del = seconds_since(start);
+
+  cout << name << ": insert " << n / ins << " ops/s, find " << n / fnd << " ops/s, iterate "
+       << n / scan << " pairs/s, erase " << n / del << " ops/s (found " << found << ", sum " << sum << ")" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned n = argc > 1 ? atoi(argv[1]) : 100000;
+  cout << "Map benchmark: " << n << " keys" << endl;
+
+  std::map<unsigned long long, double> std_map;
+  run("std::map", std_map, n);
+
+  SPU::Map<unsigned long long, double> spu_map;
+  run("SPU::Map", spu_map, n);
+
+  return 0;
+}
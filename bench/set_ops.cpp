@@ -0,0 +1,117 @@
+//
+// Set operations benchmark: sorted set kernels against std::set_intersection and Simulator on host
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+#include "../libspu/set_kernels.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+
+using bench_clock = chrono::steady_clock;
+
+double seconds_since(bench_clock::time_point start) {
+  return chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+/// n различных ключей из [0, range) по возрастанию
+vector<unsigned long long> sorted_keys(mt19937_64 &gen, size_t n, unsigned long long range) {
+  set<unsigned long long> keys;
+  while (keys.size() < n) {
+    keys.insert(gen() % range);
+  }
+  return vector<unsigned long long>(keys.begin(), keys.end());
+}
+
+SPU::data_t to_key(unsigned long long x) {
+  SPU::data_t ret = {0};
+  ret.cont[0] = (SPU::u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (SPU::u32) (x >> 32);
+#endif
+  return ret;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+  int rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+  cout << "Set operations benchmark: " << n << " keys in each operand, kernels " << SPU::setKernelsIsa() << endl;
+
+  mt19937_64 gen(1);
+  vector<SPU::u32> pos(2 * n);
+  /// Плотность - отношение диапазона ключей к их числу: 1.2 - почти все ключи общие, 100 - редкие совпадения
+  for (double density : {1.2, 4.0, 100.0}) {
+    auto a = sorted_keys(gen, n, (unsigned long long) (density * n));
+    auto b = sorted_keys(gen, n, (unsigned long long) (density * n));
+
+    vector<SPU::u32> a32(a.begin(), a.end()), b32(b.begin(), b.end()), out32;
+    vector<SPU::data_t> ak, bk, out;
+    transform(a.begin(), a.end(), back_inserter(ak), to_key);
+    transform(b.begin(), b.end(), back_inserter(bk), to_key);
+    out32.reserve(n);
+    out.reserve(n);
+
+    size_t count = 0;
+    auto start = bench_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      out32.clear();
+      set_intersection(a32.begin(), a32.end(), b32.begin(), b32.end(), back_inserter(out32));
+    }
+    double std32 = seconds_since(start) / rounds;
+    start = bench_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      count = SPU::setIntersect(a32.data(), n, b32.data(), n, pos.data());
+    }
+    double kernel32 = seconds_since(start) / rounds;
+
+    start = bench_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      out.clear();
+      set_intersection(ak.begin(), ak.end(), bk.begin(), bk.end(), back_inserter(out));
+    }
+    double std_keys = seconds_since(start) / rounds;
+    start = bench_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      SPU::setIntersect(ak.data(), n, bk.data(), n, pos.data());
+    }
+    double kernel_keys = seconds_since(start) / rounds;
+
+    cout << "density " << density << ", " << count << " common keys" << endl
+         << "  u32:    std::set_intersection " << std32 * 1000 << " ms, setIntersect " << kernel32 * 1000 << " ms" << endl
+         << "  data_t: std::set_intersection " << std_keys * 1000 << " ms, setIntersect " << kernel_keys * 1000 << " ms"
+         << endl;
+  }
+
+  /// Операции над структурами симулятора: выгрузка деревьев, ядро и построение результата
+  SPU::Simulator x, y, result;
+  auto a = sorted_keys(gen, n, 4 * n);
+  auto b = sorted_keys(gen, n, 4 * n);
+  for (auto ex : a) {
+    x.insert(to_key(ex), to_key(ex));
+  }
+  for (auto ex : b) {
+    y.insert(to_key(ex), to_key(ex));
+  }
+  auto start = bench_clock::now();
+  x.intersect(y, result);
+  double and_sec = seconds_since(start);
+  start = bench_clock::now();
+  x.unite(y, result);
+  double or_sec = seconds_since(start);
+  start = bench_clock::now();
+  x.subtract(y, result);
+  double not_sec = seconds_since(start);
+  cout << "Simulator: AND " << and_sec * 1000 << " ms, OR " << or_sec * 1000 << " ms, NOT " << not_sec * 1000
+       << " ms" << endl;
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+//
+// Sort benchmark: ExternalSort against std::sort and GNU sort on 64-bit keys
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../libspu/external_sort.hpp"
+
+using namespace std;
+
+using bench_clock = chrono::steady_clock;
+
+double seconds_since(bench_clock::time_point start) {
+  return chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long long n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000000ULL;
+  SPU::u32 shard = argc > 2 ? atoi(argv[2]) : SORT_SHARD_KEYS;
+
+  cout << "Sort benchmark: " << n << " 64-bit keys" << endl;
+
+  vector<unsigned long long> keys(n);
+  mt19937_64 gen(1);
+  for (auto &ex : keys) {
+    ex = gen();
+  }
+
+  /// std::sort
+  vector<unsigned long long> ref(keys);
+  auto start = bench_clock::now();
+  sort(ref.begin(), ref.end());
+  double sec = seconds_since(start);
+  cout << "std::sort: " << sec << " s, " << n / sec << " keys/s" << endl;
+
+  /// GNU sort, время включает разбор текста
+  string in = "bench_sort_in.txt", out = "bench_sort_out.txt";
+  {
+    ofstream file(in);
+    for (auto ex : keys) {
+      file << ex << '\n';
+    }
+  }
+  start = bench_clock::now();
+  int rc = system(("LC_ALL=C sort -n -o " + out + " " + in).c_str());
+  sec = seconds_since(start);
+  if (rc == 0) {
+    cout << "GNU sort: " << sec << " s, " << n / sec << " keys/s" << endl;
+  } else {
+    cout << "GNU sort: not available" << endl;
+  }
+  remove(in.c_str());
+  remove(out.c_str());
+
+  /// Сортировка в СП: загрузка пакетами и слияние шардов
+  SPU::ExternalSort<unsigned long long> spu_sort(shard);
+  start = bench_clock::now();
+  for (auto ex : keys) {
+    spu_sort.push(ex);
+  }
+  spu_sort.flush();
+  double load = seconds_since(start);
+  unsigned long long pos = 0;
+  bool ok = true;
+  spu_sort.emit([&](unsigned long long key) { ok = ok && ref[pos++] == key; });
+  sec = seconds_since(start);
+  cout << "ExternalSort: " << sec << " s (load " << load << " s), " << n / sec << " keys/s, "
+       << spu_sort.shardCount() << " shards, " << spu_sort.runCount() << " host runs, "
+       << (ok && pos == n ? "order OK" : "order FAILED") << endl;
+
+  return 0;
+}
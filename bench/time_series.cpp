@@ -0,0 +1,90 @@
+//
+// Time-series benchmark: ingest and query mixes over TimeSeries
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "../libspu/time_series.h"
+
+using namespace std;
+using namespace SPU;
+
+using bench_clock = chrono::steady_clock;
+
+double seconds_since(bench_clock::time_point start) {
+  return chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+/// Загрузка points точек по series сериям, размер пакета задан при создании ts
+double ingest(TimeSeries &ts, u32 series, u32 points) {
+  auto start = bench_clock::now();
+  for (u32 t = 0; t < points / series; t++) {
+    for (u32 s = 0; s < series; s++) {
+      ts.append(s, t, BitFlow((double) t));
+    }
+  }
+  ts.flush();
+  return seconds_since(start);
+}
+
+int main(int argc, char *argv[]) {
+  u32 points  = argc > 1 ? atoi(argv[1]) : 1000000;
+  u32 series  = argc > 2 ? atoi(argv[2]) : 100;
+  u32 queries = argc > 3 ? atoi(argv[3]) : 10000;
+  u32 length  = points / series;
+
+  cout << "Time-series benchmark: " << points << " points, " << series << " series, "
+       << queries << " queries" << endl;
+
+  /// Ингест: поточечная вставка против пакетной
+  for (u32 batch : {1, TS_BATCH_SIZE}) {
+    TimeSeries ts(nullptr, batch);
+    double sec = ingest(ts, series, points);
+    cout << "ingest batch=" << batch << ": " << sec << " s, " << points / sec << " points/s" << endl;
+  }
+
+  TimeSeries ts;
+  ingest(ts, series, points);
+  srand(1);
+
+  /// Короткие диапазоны (последние 100 точек серии)
+  auto start = bench_clock::now();
+  u32 found = 0;
+  for (u32 i = 0; i < queries; i++) {
+    u32 s = rand() % series;
+    found += ts.range(s, length > 100 ? length - 100 : 0, length).size();
+  }
+  double sec = seconds_since(start);
+  cout << "range(100): " << queries / sec << " queries/s, " << found / sec << " points/s" << endl;
+
+  /// Прореживание всей серии до 100 интервалов
+  u32 bucket = length / 100 ? length / 100 : 1;
+  start = bench_clock::now();
+  found = 0;
+  for (u32 i = 0; i < queries / 10; i++) {
+    u32 s = rand() % series;
+    found += ts.downsample(s, 0, length, bucket).size();
+  }
+  sec = seconds_since(start);
+  cout << "downsample(100 buckets): " << queries / 10 / sec << " queries/s, " << found << " buckets" << endl;
+
+  /// Смешанная нагрузка: 90% вставок, 9% чтений, 1% удалений старых данных
+  start = bench_clock::now();
+  u32 now = length;
+  for (u32 i = 0; i < queries * 10; i++) {
+    u32 s = rand() % series;
+    u32 op = rand() % 100;
+    if (op < 90) {
+      ts.append(s, now + i / series, BitFlow((double) i));
+    } else if (op < 99) {
+      ts.range(s, now > 10 ? now - 10 : 0, now);
+    } else {
+      ts.retain(s, i / series);
+    }
+  }
+  sec = seconds_since(start);
+  cout << "mixed 90/9/1: " << queries * 10 / sec << " ops/s, power " << ts.get_power() << endl;
+
+  return 0;
+}
@@ -1,10 +1,13 @@
 #include <iostream>
 
-#include <libspu.hpp>
-#include <structure.hpp>
+#include <libspu.h>
+#include <batch.h>
+
+#include "graph_schema.h" // Generated from graph.schema
 
 using namespace std;
 using namespace SPU;
+using namespace dijkstra;
 
 #define INF    0xf
 #define u_cnt  5 
@@ -26,42 +29,12 @@ using namespace SPU;
   Structures definitions
 *************************************/
 
-/* Graph of convergence G */
-Structure<> G; // Only field is u
-
-/* Data Fields of G */
-Fields<string> G_data({
-  { "Adj[u]", 16 }, // Has own Fields
-  { "w[u]",   20 }, // Also has own Fields
-  { "d[u]",   4  }, // Max distance is 16
-  { "p[u]",   4  },
-  { "u∈Q",    1  }  // Boolean
-});
-
-/* Adj[u] fields */
-Fields<> Adj_u({ // Every field is boolean
-  { 1, 1 },
-  { 2, 1 },
-  { 3, 1 },
-  { 4, 1 },
-  { 5, 1 }
-});
-
-/* w[u] fields */
-Fields<> w_u({ // Max distance is 16 
-  { 1, 4 },
-  { 2, 4 },
-  { 3, 4 },
-  { 4, 4 },
-  { 5, 4 }
-});
+/* Graph of convergence G, records are packed by generated GraphKey and GraphValue */
+Graph G;
 
-/* Structure of consideration Q */
-Structure<string> Q({
-  { "d[u]", 4  }, // Same size as in G_data
-  { "u",    60 }
-});
-auto Q_key = Q.keyFields(); // Get Fields to separate Q key
+/* Structure of consideration Q: nodes with inQ ordered by d, keys are packed by generated QueueKey */
+/* It is written in the same batch as G, so no separate del/insert calls are needed */
+Queue Q;
 
 /*************************************
   End of structures definitions
@@ -69,20 +42,23 @@ auto Q_key = Q.keyFields(); // Get Fields to separate Q key
 
 /* Helpers */
 void G_init();
-void Q_init();
 void G_print();
 void Q_print();
 
+/* Weight of edge to node v, fields of Weights are w1..w5 */
+u32 weight(const Weights &w, u8 v)
+{
+  const u32 ret[] = { w.w1, w.w2, w.w3, w.w4, w.w5 };
+  return ret[v - 1];
+}
+
 int main()
 {
   cout << "Starting Dijkstra algorithm" << endl;
 
-  /* G */
+  /* G and Q */
   G_init();
   G_print();
-
-  /* Q */
-  Q_init();
   Q_print();
 
   /*************************************
@@ -91,59 +67,44 @@ int main()
 
   while(Q.get_power())
   {
-    /* Get first node from Q and delete it */
-    Q_key = Q.min().key;
-    u8 u  = Q_key["u"]; // Index of node
-    Q.del(Q_key);
-    
-    /* Get G_data from Q's "u" */
-    G_data = G.search(u).value;
-    Adj_u  = G_data["Adj[u]"];
-    w_u    = G_data["w[u]"];
+    /* Get node with the least d from Q */
+    u8 u = Q.min().key.u;
+    GraphValue u_val = G.search({ u }).value;
+    Batch batch;
 
-    /* Unset u∈Q */
-    G_data["u∈Q"] = false;
+    /* Unset inQ, u leaves Q */
+    u_val.inQ = false;
+    batch.del(Q.structure(), QueueKey::pack({ u, u_val.d }));
 
-    /* Check out all v's from Adj[u] */
-    for(auto ex : Adj_u.vecData())
+    /* Check out all v's from adj: bit i is node i + 1 */
+    for(u8 v = 1; v <= u_cnt; v++)
     {
-      /* If v in Adj[u] */
-      if(ex.cont)
+      if(!(u_val.adj >> (v - 1) & 1))
       {
-        u8 v          = ex.name;
-        auto G_data_v = G_data;            // Create new data fields for v node
-        G_data_v      = G.search(v).value; // Find v's data
+        continue;
+      }
+      GraphValue v_val = G.search({ v }).value; // Find v's data
 
-        /* v is in Q */
-        if(G_data_v["u∈Q"])
+      /* v is in Q */
+      if(v_val.inQ)
+      {
+        /* Create new length statement */
+        u32 len = u_val.d + weight(u_val.w, v);
+        if( v_val.d > len )
         {
-          /* Delete old u∈Q */
-          Q_key["u"]    = v;
-          Q_key["d[u]"] = G_data_v["d[u]"];
-          Q.del(Q_key);
-
-          /* Create new length statement */
-          data_t len = G_data["d[u]"] + w_u[v];
-          if( G_data_v["d[u]"] > len )
-          {
-            /* Set new data */
-            G_data_v["d[u]"] = len;
-            G_data_v["p[u]"] = u;
-          }
-
-          /* Save v state */
-          G.insert(v, G_data_v);
-
-          /* Insert new u∈Q */
-          Q_key["u"]    = v;
-          Q_key["d[u]"] = G_data_v["d[u]"];
-          Q.insert(Q_key, 0);
+          /* Set new data, v is moved in Q */
+          batch.del(Q.structure(), QueueKey::pack({ v, v_val.d }));
+          v_val.d = len;
+          v_val.p = u;
+          batch.insert(Q.structure(), QueueKey::pack({ v, v_val.d }), {0});
+          batch.insert(G.structure(), GraphKey::pack({ v }), GraphValue::pack(v_val));
         }
       }
     }
 
     /* Save u state */
-    G.insert(u, G_data);
+    batch.insert(G.structure(), GraphKey::pack({ u }), GraphValue::pack(u_val));
+    batch.execute();
 
     G_print();
     Q_print();
@@ -155,92 +116,22 @@ int main()
 }
 
 /*************************************
-  G initialization
-  Need to manual set BitFlow class
-  in cases of few types in init list
+  G and Q initialization
 *************************************/
-void G_init()
+void G_insert(u32 u, u32 adj, Weights w, u32 d)
 {
-  /* u = 1 */
-  Adj_u  = { { 2, true }, { 3, true } };
-  w_u    = { { 2, 2    }, { 3, 7    } };
-  G_data = {
-    { "Adj[u]", Adj_u         },
-    { "w[u]",   w_u           },
-    { "d[u]",   BitFlow(0)    },
-    { "p[u]",   BitFlow(0)    },
-    { "u∈Q",    BitFlow(true) } 
-  };
-  G.insert(1, G_data);
-
-  /* u = 2 */
-  Adj_u  = { { 1, true }, { 3, true }, { 4, true } };
-  w_u    = { { 1, 2    }, { 3, 4    }, { 4, 1    } };
-  G_data = {
-    { "Adj[u]", Adj_u         },
-    { "w[u]",   w_u           },
-    { "d[u]",   BitFlow(INF)  },
-    { "p[u]",   BitFlow(0)    },
-    { "u∈Q",    BitFlow(true) } 
-  };
-  G.insert(2, G_data);
-
-  /* u = 3 */
-  Adj_u  = { { 1, true }, { 2, true }, { 4, true }, { 5, true } };
-  w_u    = { { 1, 7    }, { 2, 4    }, { 4, 2    }, { 5, 7    } };
-  G_data = {
-    { "Adj[u]", Adj_u         },
-    { "w[u]",   w_u           },
-    { "d[u]",   BitFlow(INF)  },
-    { "p[u]",   BitFlow(0)    },
-    { "u∈Q",    BitFlow(true) } 
-  };
-  G.insert(3, G_data);
-
-  /* u = 4 */
-  Adj_u  = { { 2, true }, { 3, true }, { 5, true } };
-  w_u    = { { 2, 1    }, { 3, 2    }, { 5, 6    } };
-  G_data = {
-    { "Adj[u]", Adj_u         },
-    { "w[u]",   w_u           },
-    { "d[u]",   BitFlow(INF)  },
-    { "p[u]",   BitFlow(0)    },
-    { "u∈Q",    BitFlow(true) } 
-  };
-  G.insert(4, G_data);
-
-  /* u = 5 */
-  Adj_u  = { { 3, true }, { 4, true } };
-  w_u    = { { 3, 7    }, { 4, 6    } };
-  G_data = {
-    { "Adj[u]", Adj_u         },
-    { "w[u]",   w_u           },
-    { "d[u]",   BitFlow(INF)  },
-    { "p[u]",   BitFlow(0)    },
-    { "u∈Q",    BitFlow(true) } 
-  };
-  G.insert(5, G_data);
+  G.insert({ u }, { adj, w, d, 0, true });
+  Q.insert({ u, d }, QueueValue{});
 }
 
-/*************************************
-  Q initialization
-*************************************/
-void Q_init()
+void G_init()
 {
-  /* Q first node init */
-  Q.insert(
-    { { "d[u]", 0 },  { "u", 1 } },
-    0
-  );
-
-  /* Q other nodes init */
-  for(u8 u=2; u<=u_cnt; u++)
-  {
-    Q.insert(
-      { { "d[u]", INF },  { "u", u } },
-      0
-    );
-  }
+  /* Bit i of adj is node i + 1 */
+  G_insert(1, 0x06, { 0, 2, 7, 0, 0 }, 0);
+  G_insert(2, 0x0d, { 2, 0, 4, 1, 0 }, INF);
+  G_insert(3, 0x1b, { 7, 4, 0, 2, 7 }, INF);
+  G_insert(4, 0x16, { 0, 1, 2, 0, 6 }, INF);
+  G_insert(5, 0x0c, { 0, 0, 7, 6, 0 }, INF);
 }
 
 /*************************************
@@ -252,9 +143,9 @@ void G_print()
   cout << "G graph is:" << endl;
   for(u8 u=1; u<=u_cnt; u++)
   {
-    pair_t pair =  G.search(u);
-    cout << "\t u = " << to_string(pair.key) <<
-      ":  " << to_string(pair.value, true) << endl;
+    pair_t pair = G.structure().search(GraphKey::pack({ u }));
+    cout << "\t u = " << GraphKey::get_u(pair.key) <<
+      ":  " << dump(GraphValue::descriptor(), pair.value) << endl;
   }
 
   cout << endl;
@@ -268,16 +159,10 @@ void Q_print()
   /* Print out */
   cout << "Q structures keys are:" << endl;
 
-  /* First node */
-  pair_t pair = Q.min();
-  cout << "\t " << to_string(pair.key, true) << endl;
-
-  /* Other nodes */
-  for(u8 u=2; u<=Q.get_power(); u++)
+  for(auto rec = Q.min(); rec.status == OK; rec = Q.next(rec.key))
   {
-    pair = Q.next(pair.key);
-    cout << "\t " << to_string(pair.key, true) << endl;
+    cout << "\t d = " << rec.key.d << ":  u = " << rec.key.u << endl;
   }
 
   cout << endl;
-}
\ No newline at end of file
+}
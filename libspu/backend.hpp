@@ -0,0 +1,104 @@
+/*
+  backend.hpp
+        - backends of Structure template class
+        - BaseStructure and Simulator are backends held by value, so their calls are not virtual
+        - DynamicBackend is type-erased backend over any BaseStructure son
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKEND_HPP
+#define BACKEND_HPP
+
+#include "libspu.h"
+#include "base_structure.h"
+
+#ifdef SPU_SIMULATOR
+#include "../simulator/Simulator.h"
+#endif
+
+namespace SPU
+{
+
+/***************************************
+  Backends held by value
+***************************************/
+
+/* SPU device backend: commands are written to driver */
+using HardwareBackend = BaseStructure;
+
+#ifdef SPU_SIMULATOR
+/* Simulator backend; Simulator is final, so its calls are resolved at compile time */
+using SimBackend = Simulator;
+#endif
+
+
+/***************************************
+  DynamicBackend class declaration
+***************************************/
+
+/* Type-erased backend over given structure or default one of build */
+/* Default structure is owned and deleted with backend, given one is not */
+class DynamicBackend
+{
+private:
+  BaseStructure *base;
+  bool own_base;
+
+public:
+  explicit DynamicBackend(BaseStructure *structure = nullptr) : base(structure), own_base(structure == nullptr)
+  {
+    if (base == nullptr) {
+#ifndef SPU_SIMULATOR
+      base = new BaseStructure();
+#else
+      base = new Simulator();
+#endif
+    }
+  }
+
+  DynamicBackend(const DynamicBackend &) = delete;
+  DynamicBackend& operator=(const DynamicBackend &) = delete;
+
+  ~DynamicBackend()
+  {
+    if (own_base) {
+      delete base;
+    }
+  }
+
+  operator BaseStructure&() { return *base; }
+  /* Methods of structure not forwarded below: scan, slice, erase, count ... */
+  BaseStructure *operator->() { return base; }
+  BaseStructure &operator*()  { return *base; }
+
+  u32 get_power()                                                                 { return base->get_power(); }
+  status_t insert(key_t key, value_t value, flags_t flags = NO_FLAGS)             { return base->insert(key, value, flags); }
+  status_t insert(const BaseStructure::InsertVector &batch, flags_t flags = NO_FLAGS) { return base->insert(batch, flags); }
+  status_t del(key_t key, flags_t flags = NO_FLAGS)                               { return base->del(key, flags); }
+  pair_t search(key_t key, flags_t flags = P_FLAG)                                { return base->search(key, flags); }
+  pair_t min(flags_t flags = P_FLAG)                                              { return base->min(flags); }
+  pair_t max(flags_t flags = P_FLAG)                                              { return base->max(flags); }
+  pair_t next(key_t key, flags_t flags = P_FLAG)                                  { return base->next(key, flags); }
+  pair_t prev(key_t key, flags_t flags = P_FLAG)                                  { return base->prev(key, flags); }
+  pair_t nsm(key_t key, flags_t flags = P_FLAG)                                   { return base->nsm(key, flags); }
+  pair_t ngr(key_t key, flags_t flags = P_FLAG)                                   { return base->ngr(key, flags); }
+  BaseStructure *newStructure()                                                   { return base->newStructure(); }
+};
+
+} /* namespace SPU */
+
+#endif /* BACKEND_HPP */
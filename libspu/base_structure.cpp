@@ -4,6 +4,9 @@
 
 #include "base_structure.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace SPU
 {
     /***************************************
@@ -19,11 +22,13 @@ namespace SPU
         }
     }
 
-    /* Destructor witch DELS SPU structure */
+    /* Destructor witch DELS SPU structure, zero GSID is never given by driver */
     BaseStructure::~BaseStructure()
     {
-        dels_rslt_t result = deleteStructure();
-        power = result.power;
+        if (gsid != gsid_t{ 0 }) {
+            dels_rslt_t result = deleteStructure();
+            power = result.power;
+        }
     }
 
     void BaseStructure::init() {
@@ -60,6 +65,12 @@ namespace SPU
         return this->power;
     }
 
+    /* Deleted pairs since last squeeze */
+    u32 BaseStructure::get_deleted()
+    {
+        return deleted;
+    }
+
     /* Insert command execution */
     status_t BaseStructure::insert(key_t key, value_t value, flags_t flags)
     {
@@ -81,12 +92,33 @@ namespace SPU
         return result.rslt;
     }
 
-    /* Mass vectorized insert command execution */
-    status_t BaseStructure::insert(InsertVector insert_vector, flags_t flags)
+    /* First status of batch results other than OK */
+    static status_t firstError(const BaseStructure::PairVector &results)
+    {
+        for(auto &ex : results)
+        {
+            if(ex.status != OK)
+            {
+                return ex.status;
+            }
+        }
+        return OK;
+    }
+
+    /* Mass vectorized insert: BTCH of SPU_BATCH_MAX commands per driver call */
+    status_t BaseStructure::insert(const InsertVector &insert_vector, flags_t flags)
     {
-        for(auto ex : insert_vector)
+        BatchVector batch;
+        batch.reserve(std::min<size_t>(insert_vector.size(), SPU_BATCH_MAX));
+        for(size_t first = 0; first < insert_vector.size(); first += SPU_BATCH_MAX)
         {
-            status_t status = insert(ex.key, ex.value, flags);
+            size_t count = std::min<size_t>(insert_vector.size() - first, SPU_BATCH_MAX);
+            batch.clear();
+            for(size_t i = first; i < first + count; i++)
+            {
+                batch.push_back({ this, (cmd_t) (INS | flags), insert_vector[i].key, insert_vector[i].value });
+            }
+            status_t status = firstError(execute(batch));
             if(status != OK)
             {
                 return status;
@@ -111,6 +143,9 @@ namespace SPU
         result = fops.execute<del_cmd_t, del_rslt_t>(del);
 
         power = result.power;
+        if (result.rslt == OK) {
+            noteDeleted(1);
+        }
 
         return result.rslt;
     }
@@ -253,6 +288,654 @@ namespace SPU
         return { result.key, result.val, result.rslt };
     }
 
+    /* Squeeze command execution */
+    status_t BaseStructure::squeeze(flags_t flags)
+    {
+        /* Initialize SQ command */
+        sq_cmd_t sq =
+                {
+                        .cmd  = (cmd_t) ( SQ | flags ),
+                        .gsid = gsid
+                };
+        sq_rslt_t result;
+
+        /* Execute SQ command */
+        result = fops.execute<sq_cmd_t, sq_rslt_t>(sq);
+
+        power = result.power;
+        if (result.rslt == OK) {
+            resetDeleted();
+        }
+
+        return result.rslt;
+    }
+
+    /* Structures command execution */
+    status_t BaseStructure::setCommand(cmd_t cmd, BaseStructure &b, BaseStructure &result, flags_t flags)
+    {
+        /* Initialize AND, OR or NOT command */
+        and_cmd_t set =
+                {
+                        .cmd    = (cmd_t) ( cmd | flags ),
+                        .gsid_a = gsid,
+                        .gsid_b = b.gsid,
+                        .gsid_r = result.gsid
+                };
+        and_rslt_t rslt;
+
+        /* Execute structures command */
+        rslt = fops.execute<and_cmd_t, and_rslt_t>(set);
+
+        result.power = rslt.power;
+
+        return rslt.rslt;
+    }
+
+    /* And command execution */
+    status_t BaseStructure::intersect(BaseStructure &b, BaseStructure &result, flags_t flags)
+    {
+        return setCommand(AND, b, result, flags);
+    }
+
+    /* Or command execution */
+    status_t BaseStructure::unite(BaseStructure &b, BaseStructure &result, flags_t flags)
+    {
+        return setCommand(OR, b, result, flags);
+    }
+
+    /* Not command execution */
+    status_t BaseStructure::subtract(BaseStructure &b, BaseStructure &result, flags_t flags)
+    {
+        return setCommand(NOT, b, result, flags);
+    }
+
+    /* Slice command execution */
+    status_t BaseStructure::sliceCommand(cmd_t cmd, key_t key, BaseStructure &result, flags_t flags)
+    {
+        /* Initialize slice command */
+        ls_cmd_t slice =
+                {
+                        .cmd    = (cmd_t) ( cmd | flags ),
+                        .gsid_a = gsid,
+                        .gsid_r = result.gsid,
+                        .key    = key
+                };
+        ls_rslt_t rslt;
+
+        /* Execute slice command */
+        rslt = fops.execute<ls_cmd_t, ls_rslt_t>(slice);
+
+        result.power = rslt.power;
+
+        return rslt.rslt;
+    }
+
+    /* Less slice command execution */
+    status_t BaseStructure::ls(key_t key, BaseStructure &result, flags_t flags)
+    {
+        return sliceCommand(LS, key, result, flags);
+    }
+
+    /* Less or equal slice command execution */
+    status_t BaseStructure::lseq(key_t key, BaseStructure &result, flags_t flags)
+    {
+        return sliceCommand(LSEQ, key, result, flags);
+    }
+
+    /* Greater slice command execution */
+    status_t BaseStructure::gr(key_t key, BaseStructure &result, flags_t flags)
+    {
+        return sliceCommand(GR, key, result, flags);
+    }
+
+    /* Greater or equal slice command execution */
+    status_t BaseStructure::greq(key_t key, BaseStructure &result, flags_t flags)
+    {
+        return sliceCommand(GREQ, key, result, flags);
+    }
+
+    /* Range slice with temporary structure */
+    status_t BaseStructure::slice(key_t from, key_t to, BaseStructure &result)
+    {
+        BaseStructure *tmp = newStructure();
+        status_t status = greq(from, *tmp);
+        if(status == OK)
+        {
+            status = tmp->lseq(to, result);
+        }
+        delete tmp;
+        return status;
+    }
+
+    /* Range cardinality by slice power */
+    u32 BaseStructure::count(key_t from, key_t to)
+    {
+        if(from > to)
+        {
+            return 0;
+        }
+        BaseStructure *tmp = newStructure();
+        u32 ret = slice(from, to, *tmp) == OK ? tmp->get_power() : 0;
+        delete tmp;
+        return ret;
+    }
+
+    /* Batched range scan by one LCM program: SRCH or NGR finds the first key, NEXT loop runs in driver.
+       Loop stops at count pairs, so up to count pairs after to are read and dropped */
+    BaseStructure::PairVector BaseStructure::scan(key_t from, key_t to, u32 count)
+    {
+        PairVector ret;
+        if(count == 0 || from > to)
+        {
+            return ret;
+        }
+
+        const ProgramVector program = {
+            { this,    nullptr, nullptr, SRCH, LCM_OUT,                0,        from,  { 0 } },
+            { nullptr, nullptr, nullptr, JT,   LCM_IF_OK,              4,        { 0 }, { 0 } },
+            { this,    nullptr, nullptr, NGR,  LCM_OUT,                0,        from,  { 0 } },
+            { nullptr, nullptr, nullptr, JT,   LCM_IF_ERR,             LCM_HALT, { 0 }, { 0 } },
+            { this,    nullptr, nullptr, NEXT, LCM_KEY_LAST | LCM_OUT, 0,        { 0 }, { 0 } },
+            { nullptr, nullptr, nullptr, JT,   LCM_IF_OK,              4,        { 0 }, { 0 } }
+        };
+        ProgramResult result = run(program, count, 2 * count + program.size());
+
+        /* Output full (OERR) or step limit (ERR) only cut the loop, pairs found before are valid */
+        for(auto &ex : result.out)
+        {
+            if(ex.status != OK || ex.key > to)
+            {
+                break;
+            }
+            ret.push_back(ex);
+        }
+        return ret;
+    }
+
+    /* Quotient of key by small divisor, long division from the high word */
+    static key_t divide(key_t key, u32 divisor)
+    {
+        key_t ret = { 0 };
+        unsigned long long rest = 0;
+        for(int i = SPU_WEIGHT - 1; i >= 0; i--)
+        {
+            rest = rest << 32 | key[i];
+            ret[i] = (u32) (rest / divisor);
+            rest %= divisor;
+        }
+        return ret;
+    }
+
+    /* Keys of segment lie in [first, last], both are keys of structure.
+       Density is number of keys per key unit near ends, negative if unknown */
+    struct SplitSegment
+    {
+        key_t first;
+        key_t last;
+        long double left;
+        long double right;
+
+        long double estimate() const
+        {
+            if(first == last)
+            {
+                return 1;
+            }
+            if(left < 0 && right < 0)
+            {
+                return HUGE_VALL;
+            }
+            long double density = left < 0 ? right : (right < 0 ? left : (left + right) / 2);
+            return std::max(2.0L, 1 + magnitude(last - first) * density);
+        }
+    };
+
+    /* Split points by NSM and NGR probes without counting: keys around probe give local density,
+       segments with too many estimated keys are probed again at equal key steps */
+    BaseStructure::RangeVector BaseStructure::split(key_t from, key_t to, u32 parts)
+    {
+        RangeVector ret;
+        if(from > to)
+        {
+            return ret;
+        }
+
+        /* Keys bounding range */
+        pair_t first = search(from);
+        if(first.status != OK)
+        {
+            first = ngr(from);
+        }
+        pair_t last = search(to);
+        if(last.status != OK)
+        {
+            last = nsm(to);
+        }
+        if(first.status != OK || last.status != OK || first.key > last.key)
+        {
+            return ret;
+        }
+        if(parts <= 1 || first.key == last.key)
+        {
+            ret.push_back({ from, to });
+            return ret;
+        }
+
+        std::vector<SplitSegment> segments = { { first.key, last.key, -1, -1 } };
+        long double total = 0;
+        for(u32 round = 0; round < SPLIT_ROUNDS; round++)
+        {
+            /* Segments with too many keys */
+            total = 0;
+            for(auto &ex : segments)
+            {
+                long double estimate = ex.estimate();
+                total += estimate < HUGE_VALL ? estimate : 0;
+            }
+            long double fine = std::max(1.0L, total / parts / SPLIT_OVERSAMPLE);
+
+            /* Probes of all heavy segments by one batch: NSM gives key before probe, NGR - key from probe */
+            BatchVector batch;
+            std::vector<std::vector<key_t>> probes(segments.size());
+            for(size_t i = 0; i < segments.size(); i++)
+            {
+                const SplitSegment &ex = segments[i];
+                if(ex.first == ex.last || ex.estimate() <= fine)
+                {
+                    continue;
+                }
+                key_t step = divide(ex.last - ex.first, SPLIT_OVERSAMPLE);
+                if(step == key_t{ 0 })
+                {
+                    step[0] = 1;
+                }
+                key_t probe = ex.first;
+                for(u32 k = 1; k < SPLIT_OVERSAMPLE && probe < ex.last; k++)
+                {
+                    probe = probe + step;
+                    key_t below = probe;
+                    --below;
+                    probes[i].push_back(probe);
+                    batch.push_back({ this, (cmd_t) (NSM | P_FLAG), probe, { 0 } });
+                    batch.push_back({ this, (cmd_t) (NGR | P_FLAG), below, { 0 } });
+                }
+            }
+            if(batch.empty())
+            {
+                break;
+            }
+            PairVector keys = execute(batch);
+
+            /* Probes cut segments at gaps around them, empty parts are dropped */
+            std::vector<SplitSegment> next;
+            size_t at = 0;
+            for(size_t i = 0; i < segments.size(); i++)
+            {
+                SplitSegment cur = segments[i];
+                for(size_t k = 0; k < probes[i].size(); k++, at += 2)
+                {
+                    const pair_t &below = keys[at];
+                    const pair_t &above = keys[at + 1];
+                    if(below.status != OK || above.status != OK)
+                    {
+                        continue;
+                    }
+                    long double density = 1 / magnitude(above.key - below.key);
+                    if(below.key >= cur.first)
+                    {
+                        next.push_back({ cur.first, below.key, cur.left, density });
+                        cur.first = above.key;
+                    }
+                    cur.left = density;
+                }
+                next.push_back(cur);
+            }
+            segments.swap(next);
+        }
+
+        /* Boundary at segment whose middle passes next equal share */
+        key_t begin = from;
+        long double passed = 0;
+        u32 i = 1;
+        for(size_t j = 0; j < segments.size(); j++)
+        {
+            long double estimate = segments[j].estimate();
+            estimate = estimate < HUGE_VALL ? estimate : 0;
+            if(j > 0 && i < parts && passed + estimate / 2 >= total * i / parts)
+            {
+                key_t end = segments[j].first;
+                --end;
+                ret.push_back({ begin, end });
+                begin = segments[j].first;
+                while(i < parts && passed + estimate / 2 >= total * i / parts)
+                {
+                    i++;
+                }
+            }
+            passed += estimate;
+        }
+        ret.push_back({ begin, to });
+        return ret;
+    }
+
+    /* Range erase by scan and BTCH of DEL commands */
+    status_t BaseStructure::erase(key_t from, key_t to, flags_t flags)
+    {
+        const u32 chunk = SPU_BATCH_MAX;
+        while(true)
+        {
+            PairVector pairs = scan(from, to, chunk);
+
+            /* Scanned keys are deleted by one BTCH */
+            BatchVector batch;
+            batch.reserve(pairs.size());
+            for(auto &ex : pairs)
+            {
+                batch.push_back({ this, (cmd_t) (DEL | flags), ex.key, {0} });
+            }
+            status_t status = firstError(execute(batch));
+            if(status != OK)
+            {
+                return status;
+            }
+            if(pairs.size() < chunk)
+            {
+                return OK;
+            }
+        }
+    }
+
+    /* Batch execution with one driver call per SPU_BATCH_MAX commands */
+    BaseStructure::PairVector BaseStructure::execute(const BatchVector &batch)
+    {
+        PairVector ret;
+        ret.reserve(batch.size());
+
+        std::vector<u8> buf;
+        for(size_t first = 0; first < batch.size(); first += SPU_BATCH_MAX)
+        {
+            size_t count = std::min<size_t>(batch.size() - first, SPU_BATCH_MAX);
+            buf.assign(sizeof(btch_cmd_t) + count*sizeof(batch_slot_t), 0);
+
+            /* Encode header and commands */
+            btch_cmd_t   *btch  = (btch_cmd_t *) buf.data();
+            batch_slot_t *slots = (batch_slot_t *) (btch + 1);
+            btch->cmd   = BTCH;
+            btch->count = count;
+            for(size_t i = 0; i < count; i++)
+            {
+                const BatchStruct &ex = batch[first + i];
+                switch(ex.cmd & CMD_MASK)
+                {
+                    case INS:
+                        slots[i].frmt_1 = { ex.cmd, ex.structure->gsid, ex.key, ex.value };
+                        break;
+                    case MIN:
+                    case MAX:
+                    case SQ:
+                        slots[i].frmt_3 = { ex.cmd, ex.structure->gsid };
+                        break;
+                    default:
+                        slots[i].frmt_2 = { ex.cmd, ex.structure->gsid, ex.key };
+                        break;
+                }
+            }
+
+            /* Execute: slots of failed write still hold commands, they are not results */
+            if(fops.execute(buf.data(), buf.size()) == 0)
+            {
+                ret.insert(ret.end(), count, pair_t(ERR));
+                continue;
+            }
+
+            /* Decode results */
+            for(size_t i = 0; i < count; i++)
+            {
+                const BatchStruct &ex = batch[first + i];
+                if(!(ex.cmd & P_FLAG))
+                {
+                    ret.push_back(pair_t(slots[i].rslt_0.rslt));
+                }
+                else if((ex.cmd & CMD_MASK) == INS || (ex.cmd & CMD_MASK) == SQ)
+                {
+                    ex.structure->power = slots[i].rslt_1.power;
+                    ret.push_back(pair_t(slots[i].rslt_1.rslt));
+                }
+                else
+                {
+                    ex.structure->power = slots[i].rslt_2.power;
+                    ret.push_back({ slots[i].rslt_2.key, slots[i].rslt_2.val, slots[i].rslt_2.rslt });
+                }
+
+                /* Deletes are counted and reset by squeeze as by single commands */
+                if(ret.back().status == OK && (ex.cmd & CMD_MASK) == DEL)
+                {
+                    ex.structure->noteDeleted(1);
+                }
+                else if(ret.back().status == OK && (ex.cmd & CMD_MASK) == SQ)
+                {
+                    ex.structure->resetDeleted();
+                }
+            }
+        }
+        return ret;
+    }
+
+    /* LCM program execution with one driver call */
+    BaseStructure::ProgramResult BaseStructure::run(const ProgramVector &program, u32 out_max, u32 max_steps)
+    {
+        /* Missing operands would be sent as structure 0, such program is not submitted */
+        for(auto &ex : program)
+        {
+            if((ex.cmd & CMD_MASK) != JT && !valid(ex))
+            {
+                return { ERR, 0, PairVector() };
+            }
+        }
+
+        /* Structure table of program */
+        std::vector<BaseStructure *> strs;
+        auto index = [&strs](BaseStructure *str) -> u8 {
+            if(str == nullptr)
+            {
+                return 0;
+            }
+            auto it = std::find(strs.begin(), strs.end(), str);
+            if(it != strs.end())
+            {
+                return it - strs.begin();
+            }
+            strs.push_back(str);
+            return strs.size() - 1;
+        };
+        std::vector<lcm_instr_t> code;
+        code.reserve(program.size());
+        for(auto &ex : program)
+        {
+            code.push_back({ ex.cmd, ex.opt, index(ex.structure), index(ex.b), index(ex.result), ex.target, ex.key, ex.value });
+        }
+
+        if(program.size() > LCM_SIZE || strs.size() > SPU_STR_NUM)
+        {
+            return interpret(program, out_max, max_steps);
+        }
+
+        /* Encode header, structures and instructions */
+        std::vector<u8> buf(sizeof(prgm_cmd_t) + strs.size()*sizeof(lcm_str_t) +
+                            code.size()*sizeof(lcm_instr_t) + out_max*sizeof(rsltfrmt_2), 0);
+        prgm_cmd_t  *prgm  = (prgm_cmd_t *) buf.data();
+        lcm_str_t   *table = (lcm_str_t *) (prgm + 1);
+        lcm_instr_t *instr = (lcm_instr_t *) (table + strs.size());
+        rsltfrmt_2  *out   = (rsltfrmt_2 *) (instr + code.size());
+        *prgm = { PRGM, (u32) code.size(), (u32) strs.size(), out_max, max_steps };
+        for(size_t i = 0; i < strs.size(); i++)
+        {
+            table[i].gsid  = strs[i]->gsid;
+            table[i].power = strs[i]->power;
+        }
+        std::copy(code.begin(), code.end(), instr);
+
+        /* Execute */
+        if(fops.execute(buf.data(), buf.size()) == 0)
+        {
+            return { ERR, 0, PairVector() };
+        }
+
+        /* Decode results */
+        prgm_rslt_t *rslt = (prgm_rslt_t *) buf.data();
+        ProgramResult ret = { rslt->rslt, rslt->steps, PairVector() };
+        for(u32 i = 0; i < rslt->out_count && i < out_max; i++)
+        {
+            ret.out.push_back({ out[i].key, out[i].val, out[i].rslt });
+        }
+        for(size_t i = 0; i < strs.size(); i++)
+        {
+            strs[i]->power = table[i].power;
+            if(table[i].squeezed)
+            {
+                strs[i]->resetDeleted();
+            }
+            strs[i]->noteDeleted(table[i].deleted);
+        }
+        return ret;
+    }
+
+    /* LCM program interpretation by structure methods with the same semantics as in driver */
+    BaseStructure::ProgramResult BaseStructure::interpret(const ProgramVector &program, u32 out_max, u32 max_steps)
+    {
+        ProgramResult ret = { OK, 0, PairVector() };
+        pair_t last({ 0 }, { 0 }, OK);
+        u32 pc = 0;
+
+        while(pc < program.size())
+        {
+            if(ret.steps == max_steps)
+            {
+                ret.status = ERR;
+                break;
+            }
+            ret.steps++;
+
+            const ProgramStruct &ex = program[pc];
+            cmd_t cmd     = ex.cmd & CMD_MASK;
+            flags_t flags = (ex.cmd & ~CMD_MASK) | P_FLAG;
+
+            /* Jumps are resolved by last status */
+            if(cmd == JT)
+            {
+                bool jump = true;
+                if(ex.opt & LCM_IF_OK)
+                {
+                    jump = last.status == OK;
+                }
+                else if(ex.opt & LCM_IF_ERR)
+                {
+                    jump = last.status != OK;
+                }
+                pc = jump ? ex.target : pc + 1;
+                continue;
+            }
+
+            /* Command with key and value of instruction or last found pair */
+            ProgramStruct command = ex;
+            command.cmd   = cmd | flags;
+            command.key   = ex.opt & LCM_KEY_LAST ? last.key   : ex.key;
+            command.value = ex.opt & LCM_VAL_LAST ? last.value : ex.value;
+            if(!valid(command) || cmd == ADDS || cmd == DELS || cmd == PRGM || cmd == BTCH)
+            {
+                ret.status = ERR;
+                break;
+            }
+
+            pair_t pair = dispatch(command);
+
+            last.status = pair.status;
+            bool found = cmd == SRCH || cmd == MIN || cmd == MAX || cmd == NEXT || cmd == PREV || cmd == NSM || cmd == NGR;
+            if(found && pair.status == OK)
+            {
+                last = pair;
+                if(ex.opt & LCM_OUT)
+                {
+                    if(ret.out.size() == out_max)
+                    {
+                        ret.status = OERR;
+                        break;
+                    }
+                    ret.out.push_back(pair);
+                }
+            }
+            pc++;
+        }
+        return ret;
+    }
+
+    /* One batch command execution by structure methods */
+    pair_t BaseStructure::dispatch(const BatchStruct &command)
+    {
+        BaseStructure *str = command.structure;
+        flags_t flags      = command.cmd & ~CMD_MASK;
+        switch(command.cmd & CMD_MASK)
+        {
+            case INS:  return pair_t(str->insert(command.key, command.value, flags));
+            case DEL:  return pair_t(str->del(command.key, flags));
+            case SRCH: return str->search(command.key, flags);
+            case MIN:  return str->min(flags);
+            case MAX:  return str->max(flags);
+            case NEXT: return str->next(command.key, flags);
+            case PREV: return str->prev(command.key, flags);
+            case NSM:  return str->nsm(command.key, flags);
+            case NGR:  return str->ngr(command.key, flags);
+            case SQ:   return pair_t(str->squeeze(flags));
+            default:   return pair_t(ERR);
+        }
+    }
+
+    /* Instruction has every structure its command needs */
+    bool BaseStructure::valid(const ProgramStruct &command)
+    {
+        cmd_t cmd = command.cmd & CMD_MASK;
+        bool sets = cmd == AND || cmd == OR || cmd == NOT;
+        bool cuts = cmd == LS || cmd == LSEQ || cmd == GR || cmd == GREQ;
+        return command.structure != nullptr && ( !sets || command.b != nullptr ) &&
+               ( !(sets || cuts) || command.result != nullptr );
+    }
+
+    /* One command of program execution by structure methods, set and slice commands included */
+    pair_t BaseStructure::dispatch(const ProgramStruct &command)
+    {
+        BaseStructure *str = command.structure;
+        flags_t flags      = command.cmd & ~CMD_MASK;
+        switch(command.cmd & CMD_MASK)
+        {
+            case AND:  return pair_t(str->intersect(*command.b, *command.result, flags));
+            case OR:   return pair_t(str->unite    (*command.b, *command.result, flags));
+            case NOT:  return pair_t(str->subtract (*command.b, *command.result, flags));
+            case LS:   return pair_t(str->ls  (command.key, *command.result, flags));
+            case LSEQ: return pair_t(str->lseq(command.key, *command.result, flags));
+            case GR:   return pair_t(str->gr  (command.key, *command.result, flags));
+            case GREQ: return pair_t(str->greq(command.key, *command.result, flags));
+            default:   return dispatch(BatchStruct{ str, command.cmd, command.key, command.value });
+        }
+    }
+
+    /* New empty SPU structure */
+    BaseStructure *BaseStructure::newStructure()
+    {
+        return new BaseStructure();
+    }
+
+    /* Copy by OR with empty structure: the new structure is both operand B and result */
+    BaseStructure *BaseStructure::clone()
+    {
+        BaseStructure *ret = newStructure();
+        if(unite(*ret, *ret) != OK)
+        {
+            delete ret;
+            throw CouldNotCreateStructure();
+        }
+        return ret;
+    }
+
     gsid_t BaseStructure::get_gsid() {
         return gsid;
     }
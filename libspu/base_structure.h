@@ -33,6 +33,12 @@
 namespace SPU
 {
 
+/* Estimated segments per range of split, a heavy segment is probed at SPLIT_OVERSAMPLE equal steps */
+#define SPLIT_OVERSAMPLE 4
+
+/* Rounds of probing heavy segments by split, each is one call to SPU */
+#define SPLIT_ROUNDS 32
+
 /***************************************
   BaseStructure class declaration
 ***************************************/
@@ -47,11 +53,53 @@ public:
     value_t value;
   };
   using InsertVector = std::vector<InsertStruct>;
+  using PairVector   = std::vector<pair_t>;
+
+  /* Key range [from, to] */
+  struct RangeStruct
+  {
+    key_t from;
+    key_t to;
+  };
+  using RangeVector = std::vector<RangeStruct>;
+
+  /* Command of batch for any structure */
+  struct BatchStruct
+  {
+    BaseStructure *structure;
+    cmd_t   cmd;                // Command with flags
+    key_t   key;
+    value_t value;
+  };
+  using BatchVector = std::vector<BatchStruct>;
+
+  /* Instruction of LCM program over any structures */
+  struct ProgramStruct
+  {
+    BaseStructure *structure;   // Structure A
+    BaseStructure *b;           // Structure B of AND, OR, NOT
+    BaseStructure *result;      // Structure R of AND, OR, NOT and slices
+    cmd_t   cmd;                // Command with flags or JT
+    u8      opt;                // LCM options
+    u32     target;             // JT target instruction
+    key_t   key;
+    value_t value;
+  };
+  using ProgramVector = std::vector<ProgramStruct>;
+
+  /* Result of LCM program */
+  struct ProgramResult
+  {
+    status_t   status;          // OK if halted, ERR on bad instruction or step limit, OERR on full output
+    u32        steps;           // Executed instructions and jumps
+    PairVector out;             // Pairs found by instructions with LCM_OUT
+  };
 
 private:
   gsid_t gsid = { 0 };       // Global Structure ID
   Fileops fops;              // File operations provider
   u32 power;                 // Current structure power
+  u32 deleted = 0;           // Deleted pairs since last squeeze
 
 public:
   explicit BaseStructure(bool initialize=true);
@@ -59,12 +107,15 @@ public:
 
   gsid_t get_gsid();
   virtual u32 get_power();
+  /// число пар, удаленных после последнего сжатия (SQ)
+  u32 get_deleted();
 
   void init();
 
   /// выполняет поиск значения, связанного с ключом
   virtual status_t insert(key_t key, value_t value, flags_t flags = NO_FLAGS);
-  status_t insert (InsertVector insert_vector, flags_t flags = NO_FLAGS);
+  /// пакетная вставка пар ключ-значение
+  virtual status_t insert(const InsertVector &insert_vector, flags_t flags = NO_FLAGS);
   /// выполняет поиск указанного ключа и удаляет его из структуры данных
   virtual status_t del(key_t key, flags_t flags = NO_FLAGS);
   /// выполняет поиск значения, связанного с ключом
@@ -89,8 +140,76 @@ public:
   /// Операции могут быть использованы для эвристических вычислений,
   /// где интерполяция данных используется вместо точных вычислений (например, кластеризация или агрегация).
   virtual pair_t ngr(key_t key, flags_t flags = P_FLAG);
+  /// дефрагментирует блоки памяти DSM, занятые структурой (команда SQ)
+  virtual status_t squeeze(flags_t flags = P_FLAG);
+
+  /// срезы извлекают подмножество ключей структуры в структуру result.
+  /// Содержимое result замещается, мощность среза возвращает result.get_power()
+  virtual status_t ls  (key_t key, BaseStructure &result, flags_t flags = P_FLAG);
+  virtual status_t lseq(key_t key, BaseStructure &result, flags_t flags = P_FLAG);
+  virtual status_t gr  (key_t key, BaseStructure &result, flags_t flags = P_FLAG);
+  virtual status_t greq(key_t key, BaseStructure &result, flags_t flags = P_FLAG);
+  /// команды AND, OR, NOT записывают в result пересечение, объединение или разность
+  /// ключей текущей структуры и структуры b. Значения берутся из текущей структуры
+  virtual status_t intersect(BaseStructure &b, BaseStructure &result, flags_t flags = P_FLAG);
+  virtual status_t unite    (BaseStructure &b, BaseStructure &result, flags_t flags = P_FLAG);
+  virtual status_t subtract (BaseStructure &b, BaseStructure &result, flags_t flags = P_FLAG);
+
+  /// извлекает ключи из диапазона [from, to] в структуру result (GREQ и LSEQ через временную структуру)
+  status_t slice(key_t from, key_t to, BaseStructure &result);
+
+  /// количество ключей в диапазоне [from, to] как мощность среза во временную структуру
+  virtual u32 count(key_t from, key_t to);
+
+  /// пакетное чтение не более count пар с ключами из диапазона [from, to] по возрастанию ключа
+  /// одной программой LCM (цикл NEXT выполняется драйвером)
+  virtual PairVector scan(key_t from, key_t to, u32 count);
+  /// делит [from, to] на не более чем parts смежных диапазонов с близким числом ключей.
+  /// Число ключей оценивается без срезов по расстояниям между ключами, найденными NSM и NGR
+  /// в равноотстоящих точках; отрезки с избытком ключей снова делятся равными шагами.
+  /// Пустой диапазон не возвращается
+  virtual RangeVector split(key_t from, key_t to, u32 parts);
+  /// чтения структуры можно выполнять из нескольких потоков одновременно.
+  /// Драйвер не упорядочивает записи в файл устройства: у СП - false
+  virtual bool concurrent() { return false; }
+  /// удаляет все ключи из диапазона [from, to]
+  virtual status_t erase(key_t from, key_t to, flags_t flags = NO_FLAGS);
+
+  /// выполняет пакет команд над любыми структурами за одно обращение к СП.
+  /// Результаты возвращаются в порядке команд
+  virtual PairVector execute(const BatchVector &batch);
+
+  /// выполняет программу LCM за одно обращение к СП: команды и переходы JT выполняются
+  /// без возврата в пользовательское пространство. Программа длиннее LCM_SIZE или с числом
+  /// структур больше SPU_STR_NUM выполняется интерпретатором на хосте. Программа, в которой у команды
+  /// нет структуры-операнда, не отправляется в СП: результат ERR, как и при ошибке записи в драйвер
+  virtual ProgramResult run(const ProgramVector &program, u32 out_max, u32 max_steps);
+
+  /// создает новую пустую структуру того же типа (для временных структур)
+  virtual BaseStructure *newStructure();
+  /// создает копию структуры одной командой OR с новой пустой структурой.
+  /// Нехватка памяти СП для копии - исключение CouldNotCreateStructure
+  virtual BaseStructure *clone();
 
 protected:
+  /// выполняет одну команду пакета методами её структуры
+  static pair_t dispatch(const BatchStruct &command);
+  /// выполняет одну команду программы, включая команды над множествами и срезы
+  static pair_t dispatch(const ProgramStruct &command);
+  static bool valid(const ProgramStruct &command);
+  /// интерпретатор LCM: выполняет программу методами её структур
+  static ProgramResult interpret(const ProgramVector &program, u32 out_max, u32 max_steps);
+
+  status_t setCommand(cmd_t cmd, BaseStructure &b, BaseStructure &result, flags_t flags);
+  status_t sliceCommand(cmd_t cmd, key_t key, BaseStructure &result, flags_t flags);
+
+  /// структура уже удалена производным классом: деструктор не выполняет DELS
+  void detach() { gsid = { 0 }; }
+
+  /// учет удалений для планировщика сжатия
+  void noteDeleted(u32 count) { deleted += count; }
+  void resetDeleted()         { deleted = 0; }
+
   virtual adds_rslt_t createStructure();
   virtual dels_rslt_t deleteStructure();
 };
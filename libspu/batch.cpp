@@ -0,0 +1,90 @@
+/*
+  batch.cpp
+        - batch class implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batch.h"
+
+namespace SPU
+{
+    /***************************************
+      Batch class implementation
+    ***************************************/
+
+    size_t Batch::push(BaseStructure &structure, cmd_t cmd, key_t key, value_t value)
+    {
+        commands.push_back({ &structure, cmd, key, value });
+        return commands.size() - 1;
+    }
+
+    size_t Batch::insert(BaseStructure &structure, key_t key, value_t value, flags_t flags)
+    {
+        return push(structure, INS | flags, key, value);
+    }
+
+    size_t Batch::del(BaseStructure &structure, key_t key, flags_t flags)
+    {
+        return push(structure, DEL | flags, key);
+    }
+
+    size_t Batch::search(BaseStructure &structure, key_t key, flags_t flags)
+    {
+        return push(structure, SRCH | flags, key);
+    }
+
+    size_t Batch::min(BaseStructure &structure, flags_t flags)
+    {
+        return push(structure, MIN | flags);
+    }
+
+    size_t Batch::max(BaseStructure &structure, flags_t flags)
+    {
+        return push(structure, MAX | flags);
+    }
+
+    size_t Batch::next(BaseStructure &structure, key_t key, flags_t flags)
+    {
+        return push(structure, NEXT | flags, key);
+    }
+
+    size_t Batch::prev(BaseStructure &structure, key_t key, flags_t flags)
+    {
+        return push(structure, PREV | flags, key);
+    }
+
+    size_t Batch::nsm(BaseStructure &structure, key_t key, flags_t flags)
+    {
+        return push(structure, NSM | flags, key);
+    }
+
+    size_t Batch::ngr(BaseStructure &structure, key_t key, flags_t flags)
+    {
+        return push(structure, NGR | flags, key);
+    }
+
+    /* Structure of the first command selects the way of execution (SPU or simulator) */
+    BaseStructure::PairVector Batch::execute()
+    {
+        if (commands.empty()) {
+            return BaseStructure::PairVector();
+        }
+        BaseStructure::PairVector ret = commands.front().structure->execute(commands);
+        commands.clear();
+        return ret;
+    }
+}
@@ -0,0 +1,67 @@
+/*
+  batch.h
+        - batch class declaration
+        - batch collects SPU commands for any structures and executes them with one call to SPU
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "libspu.h"
+#include "base_structure.h"
+
+namespace SPU
+{
+
+/***************************************
+  Batch class declaration
+***************************************/
+
+/* Batch of SPU commands */
+class Batch
+{
+private:
+  BaseStructure::BatchVector commands;
+
+  size_t push(BaseStructure &structure, cmd_t cmd, key_t key = {0}, value_t value = {0});
+
+public:
+  Batch() = default;
+
+  /// Каждый метод добавляет команду в пакет и возвращает индекс её результата
+  size_t insert(BaseStructure &structure, key_t key, value_t value, flags_t flags = NO_FLAGS);
+  size_t del   (BaseStructure &structure, key_t key, flags_t flags = NO_FLAGS);
+  size_t search(BaseStructure &structure, key_t key, flags_t flags = P_FLAG);
+  size_t min   (BaseStructure &structure, flags_t flags = P_FLAG);
+  size_t max   (BaseStructure &structure, flags_t flags = P_FLAG);
+  size_t next  (BaseStructure &structure, key_t key, flags_t flags = P_FLAG);
+  size_t prev  (BaseStructure &structure, key_t key, flags_t flags = P_FLAG);
+  size_t nsm   (BaseStructure &structure, key_t key, flags_t flags = P_FLAG);
+  size_t ngr   (BaseStructure &structure, key_t key, flags_t flags = P_FLAG);
+
+  size_t size() const { return commands.size(); }
+  bool empty() const  { return commands.empty(); }
+  void clear()        { commands.clear(); }
+
+  /// выполняет пакет и очищает его
+  BaseStructure::PairVector execute();
+};
+
+} /* namespace SPU */
+
+#endif /* BATCH_H */
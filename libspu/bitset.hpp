@@ -0,0 +1,201 @@
+/*
+  bitset.hpp
+        - bitset class for bitmask fields of data_t
+        - popcount and iteration over set bits cost proportional to set bits, not to width
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITSET_HPP
+#define BITSET_HPP
+
+#include "libspu.h"
+
+#include <iterator>
+
+namespace SPU
+{
+
+/* Bit count of data_t */
+#define BITSET_MAX_WIDTH ( SPU_WEIGHT * 32 )
+
+/* Bitset of `width` bits in data_t words, bit 0 is the least significant bit of word 0 */
+/* Bits above width are always zero */
+class Bitset
+{
+private:
+  data_t bits;
+  u32 width;
+
+  /* Clears bits above width */
+  void trim()
+  {
+    for(u32 i = 0; i < SPU_WEIGHT; i++)
+    {
+      u32 low = i * 32;
+      if(width <= low)
+      {
+        bits[i] = 0;
+      }
+      else if(width < low + 32)
+      {
+        bits[i] &= ~( ~0u << (width - low) );
+      }
+    }
+  }
+
+public:
+  /* Iterator over indexes of set bits: the lowest bit is found by ctz (tzcnt) */
+  /* and cleared by w & (w - 1) (blsr) */
+  class const_iterator
+  {
+  private:
+    const data_t *bits;
+    u32 word;
+    u32 rest;     // Not yet visited bits of current word
+
+    void skip()
+    {
+      while(rest == 0 && ++word < SPU_WEIGHT)
+      {
+        rest = (*bits)[word];
+      }
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = u32;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const u32 *;
+    using reference         = u32;
+
+    const_iterator(const data_t *data, u32 start) : bits(data), word(start), rest(0)
+    {
+      if(word < SPU_WEIGHT)
+      {
+        rest = (*bits)[word];
+        skip();
+      }
+    }
+
+    u32 operator*() const { return word * 32 + __builtin_ctz(rest); }
+
+    const_iterator& operator++()
+    {
+      rest &= rest - 1;
+      skip();
+      return *this;
+    }
+    const_iterator operator++(int) { const_iterator ret = *this; ++*this; return ret; }
+
+    bool operator==(const const_iterator &other) const { return word == other.word && rest == other.rest; }
+    bool operator!=(const const_iterator &other) const { return !(*this == other); }
+  };
+
+  /* Constructors */
+  explicit Bitset(u32 bits_width = BITSET_MAX_WIDTH) : bits({0}),
+    width(bits_width < BITSET_MAX_WIDTH ? bits_width : BITSET_MAX_WIDTH) {}
+  Bitset(data_t data, u32 bits_width) : bits(data),
+    width(bits_width < BITSET_MAX_WIDTH ? bits_width : BITSET_MAX_WIDTH) { trim(); }
+
+  u32 size() const { return width; }
+
+  /* Single bits */
+  bool test(u32 idx) const { return idx < width && ( bits[idx / 32] >> (idx % 32) ) & 1; }
+  Bitset& set(u32 idx, bool value = true)
+  {
+    if(idx < width)
+    {
+      if(value) { bits[idx / 32] |=   1u << (idx % 32);  }
+      else      { bits[idx / 32] &= ~(1u << (idx % 32)); }
+    }
+    return *this;
+  }
+  Bitset& reset(u32 idx) { return set(idx, false); }
+
+  /* Count of set bits */
+  u32 count() const
+  {
+    u32 ret = 0;
+    for(u32 i = 0; i < SPU_WEIGHT; i++)
+    {
+      ret += __builtin_popcount(bits[i]);
+    }
+    return ret;
+  }
+
+  bool any() const
+  {
+    for(u32 i = 0; i < SPU_WEIGHT; i++)
+    {
+      if(bits[i]) { return true; }
+    }
+    return false;
+  }
+  bool none() const { return !any(); }
+
+  /* Index of the lowest set bit or width when none */
+  u32 first() const
+  {
+    const_iterator it = begin();
+    return it == end() ? width : *it;
+  }
+
+  /* Set bits iteration */
+  const_iterator begin() const { return const_iterator(&bits, 0); }
+  const_iterator end()   const { return const_iterator(&bits, SPU_WEIGHT); }
+
+  /* Word-wise operations; width of result is width of left operand */
+  Bitset& operator&=(const Bitset &other)
+  {
+    for(u32 i = 0; i < SPU_WEIGHT; i++) { bits[i] &= other.bits[i]; }
+    return *this;
+  }
+  Bitset& operator|=(const Bitset &other)
+  {
+    for(u32 i = 0; i < SPU_WEIGHT; i++) { bits[i] |= other.bits[i]; }
+    trim();
+    return *this;
+  }
+  Bitset& operator^=(const Bitset &other)
+  {
+    for(u32 i = 0; i < SPU_WEIGHT; i++) { bits[i] ^= other.bits[i]; }
+    trim();
+    return *this;
+  }
+  /* Clears bits set in other */
+  Bitset& operator-=(const Bitset &other)
+  {
+    for(u32 i = 0; i < SPU_WEIGHT; i++) { bits[i] &= ~other.bits[i]; }
+    return *this;
+  }
+
+  friend Bitset operator&(Bitset a, const Bitset &b) { return a &= b; }
+  friend Bitset operator|(Bitset a, const Bitset &b) { return a |= b; }
+  friend Bitset operator^(Bitset a, const Bitset &b) { return a ^= b; }
+  friend Bitset operator-(Bitset a, const Bitset &b) { return a -= b; }
+
+  bool operator==(const Bitset &other) const { return bits == other.bits; }
+  bool operator!=(const Bitset &other) const { return bits != other.bits; }
+
+  /* Transform operators */
+  operator data_t() const { return bits; }
+  operator BitFlow() const { return BitFlow(bits); }
+};
+
+} /* namespace SPU */
+
+#endif /* BITSET_HPP */
@@ -0,0 +1,128 @@
+/*
+  clustering.hpp
+        - one-dimensional clustering of structure keys by gaps
+        - cluster boundaries are found by NSM jumps, not by visiting every key
+        - KeyT is unsigned numeric type of keys
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLUSTERING_HPP
+#define CLUSTERING_HPP
+
+#include "libspu.h"
+#include "base_structure.h"
+#include "neighbours.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace SPU
+{
+
+/* Cluster of keys: extent and count of keys */
+struct cluster_t
+{
+  key_t first;
+  key_t last;
+  u32   count;
+};
+using ClusterVector = std::vector<cluster_t>;
+
+
+/* Last key of cluster containing key `from` */
+/* Every step jumps by NSM to the greatest key within `gap` of the current one */
+template <typename KeyT>
+KeyT clusterEnd(BaseStructure &structure, KeyT from, KeyT gap)
+{
+  KeyT last = from;
+  while(true)
+  {
+    KeyT reach = last + gap;
+    pair_t found = (reach < last || reach + 1 < reach) ? structure.max() : structure.nsm(encode<KeyT>(reach + 1));
+    if(found.status != OK)
+    {
+      return last;
+    }
+
+    KeyT key = decodeKey<KeyT>(found.key);
+    if(!(key > last))
+    {
+      return last; // No key in (last, last + gap]
+    }
+    last = key;
+  }
+}
+
+/* Clusters of keys separated by gaps larger than `gap` */
+/* Keys are counted by slice cardinality when `count` is set */
+template <typename KeyT>
+ClusterVector clusters(BaseStructure &structure, KeyT gap, bool count = true)
+{
+  ClusterVector ret;
+  pair_t pair = structure.min();
+  while(pair.status == OK)
+  {
+    KeyT first = decodeKey<KeyT>(pair.key);
+    KeyT last  = clusterEnd(structure, first, gap);
+
+    cluster_t cluster = { pair.key, encode<KeyT>(last), 0 };
+    if(count)
+    {
+      cluster.count = structure.count(cluster.first, cluster.last);
+    }
+    ret.push_back(cluster);
+
+    /* First key of next cluster */
+    pair = structure.ngr(cluster.last);
+  }
+  return ret;
+}
+
+/* Every cluster is sliced into its own new structure of parts; caller owns the structures */
+/* On SPU only SPU_STR_NUM structures may exist, so CouldNotCreateStructure may be thrown */
+/* Parts are owned here until all slices succeed: error status or exception leaves parts empty */
+template <typename KeyT>
+status_t segment(BaseStructure &structure, KeyT gap, std::vector<BaseStructure *> &parts, ClusterVector *found = nullptr)
+{
+  parts.clear();
+  ClusterVector cls = clusters(structure, gap, false);
+  std::vector<std::unique_ptr<BaseStructure>> owned;
+  for(auto &ex : cls)
+  {
+    owned.emplace_back(structure.newStructure());
+    status_t status = structure.slice(ex.first, ex.last, *owned.back());
+    if(status != OK)
+    {
+      return status;
+    }
+    ex.count = owned.back()->get_power();
+  }
+
+  for(auto &ex : owned)
+  {
+    parts.push_back(ex.release());
+  }
+  if(found)
+  {
+    *found = cls;
+  }
+  return OK;
+}
+
+} /* namespace SPU */
+
+#endif /* CLUSTERING_HPP */
@@ -0,0 +1,71 @@
+/*
+  cursor.cpp
+        - cursor class implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cursor.h"
+
+namespace SPU
+{
+    key_t lastKey()
+    {
+        key_t ret;
+        for (u8 i = 0; i < SPU_WEIGHT; i++) {
+            ret[i] = ~0u;
+        }
+        return ret;
+    }
+
+    /***************************************
+      Cursor class implementation
+    ***************************************/
+
+    Cursor::Cursor(BaseStructure &str, key_t first, key_t last, u32 batch) :
+            structure(&str), from(first), to(last), chunk(batch ? batch : 1), pos(0), done(first > last)
+    {
+    }
+
+    void Cursor::fetch()
+    {
+        buf = structure->scan(from, to, chunk);
+        pos = 0;
+
+        /* Short batch or the last key means end of range */
+        if (buf.size() < chunk || buf.back().key == to) {
+            done = true;
+        } else {
+            from = buf.back().key;
+            ++from;
+        }
+    }
+
+    bool Cursor::next(pair_t &pair)
+    {
+        if (pos == buf.size()) {
+            if (done) {
+                return false;
+            }
+            fetch();
+            if (buf.empty()) {
+                return false;
+            }
+        }
+        pair = buf[pos++];
+        return true;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+  cursor.h
+        - cursor class declaration
+        - cursor iterates over a key range of structure reading pairs by batched scans
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include "libspu.h"
+#include "base_structure.h"
+
+namespace SPU
+{
+
+/* Key with all bits set - the last possible key */
+key_t lastKey();
+
+/***************************************
+  Cursor class declaration
+***************************************/
+
+/* Forward iterator over keys [from, to] of structure */
+class Cursor
+{
+private:
+  BaseStructure *structure;
+  key_t from;                       // First key of the next batch
+  key_t to;
+  u32 chunk;                        // Pairs in one batch
+  BaseStructure::PairVector buf;    // Current batch
+  size_t pos;
+  bool done;                        // No more batches
+
+  void fetch();
+
+public:
+  explicit Cursor(BaseStructure &str, key_t first = {0}, key_t last = lastKey(), u32 batch = SPU_BATCH_MAX);
+
+  /// возвращает следующую пару, false в конце диапазона
+  bool next(pair_t &pair);
+};
+
+} /* namespace SPU */
+
+#endif /* CURSOR_H */
@@ -14,12 +14,13 @@ using namespace std;
 
 namespace SPU
 {
+  /// сравнение начинается со старшего элемента, т.е. контейнеры упорядочены как числа
   template<class T>
   int cmpContainers(T &c1, T &c2)
   {
-    for(u8 i=0; i < arraySize(c1); i++) {
-      if (c1[i] != c2[i]) {
-        return c1[i] < c2[i] ? -1 : 1;
+    for(u8 i = arraySize(c1); i > 0; i--) {
+      if (c1[i-1] != c2[i-1]) {
+        return c1[i-1] < c2[i-1] ? -1 : 1;
       }
     }
     return 0;
@@ -49,8 +50,12 @@ namespace SPU
   template <class T>
   T & incContainer (T &c1)
   {
-    // FIXME инкремирует для последнего элемента
-    ++c1[arraySize(c1) - 1];
+    // перенос идет от младшего элемента к старшему
+    for (u8 i = 0; i < arraySize(c1); i++) {
+      if (++c1[i] != 0) {
+        break;
+      }
+    }
     return c1;
   }
 
@@ -58,8 +63,12 @@ namespace SPU
   template <class T>
   T & decContainer (T &c1)
   {
-    // FIXME декремирует для последнего элемента
-    --c1[arraySize(c1) - 1];
+    // заем идет от младшего элемента к старшему
+    for (u8 i = 0; i < arraySize(c1); i++) {
+      if (c1[i]-- != 0) {
+        break;
+      }
+    }
     return c1;
   }
 
@@ -145,6 +154,9 @@ namespace SPU
   /* Iterates and invokes shift with left part */
   data_t operator>> (const data_t &cont, const u8 &shift);
 
+  /// Ключ как число для оценок плотности и интерполяции
+  long double magnitude(const data_t &cont);
+
 
 }
 
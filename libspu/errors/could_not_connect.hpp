@@ -0,0 +1,41 @@
+/*
+  errors/could_not_connect.hpp
+        - error when SPU server could not be connected
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COULD_NOT_CONNECT_HPP
+#define COULD_NOT_CONNECT_HPP
+
+#include <stdexcept>
+#include <string>
+
+namespace SPU
+{
+
+/* Exception throws when SPU server could not be resolved or connected by socket */
+struct CouldNotConnect : public std::exception
+{
+  const char * what () const throw ()
+    {
+      return "Could not connect to SPU server";
+    }
+};
+
+} /* namespace SPU */
+
+#endif /* COULD_NOT_CONNECT_HPP */
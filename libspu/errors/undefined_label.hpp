@@ -0,0 +1,41 @@
+/*
+  undefined_label.hpp
+        - exception when LCM program jumps to label which was not defined
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UNDEFINED_LABEL_HPP
+#define UNDEFINED_LABEL_HPP
+
+#include <stdexcept>
+#include <string>
+
+namespace SPU
+{
+
+/* Exception throws when program jump has no label to resolve */
+struct UndefinedLabel : public std::exception
+{
+  const char * what () const throw ()
+    {
+      return "LCM program jumps to undefined label";
+    }
+};
+
+} /* namespace SPU */
+
+#endif /* UNDEFINED_LABEL_HPP */
@@ -0,0 +1,276 @@
+/*
+  external_sort.hpp
+        - sort of large key sets by SPU structures
+        - keys are bulk inserted into shard structures, equal keys are counted in values
+        - sorted keys are emitted by batched scans and k-way merge of shards
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EXTERNAL_SORT_HPP
+#define EXTERNAL_SORT_HPP
+
+#include "libspu.h"
+#include "base_structure.h"
+#include "batch.h"
+#include "cursor.h"
+#include "map.hpp"
+#include "errors/could_not_create_structure.hpp"
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef SPU_SIMULATOR
+#include "../simulator/Simulator.h"
+#endif
+
+namespace SPU
+{
+
+/* Default maximum count of distinct keys in one shard structure */
+#define SORT_SHARD_KEYS (1u << 24)
+
+/* Default count of keys in one bulk insert */
+#define SORT_BATCH_SIZE 4096
+
+/***************************************
+  ExternalSort template class declaration
+***************************************/
+
+/* Sort of keys by SPU structures; keys are packed by order-preserving KeyCodec */
+/* Shards are filled one by one. When no more structures can be created, */
+/* the last shard is spilled to a sorted run on host and filled again */
+template <typename K>
+class ExternalSort
+{
+public:
+  using Codec = KeyCodec<K>;
+
+private:
+  using Run = std::vector<std::pair<key_t, u32>>;   // Sorted keys with counts
+
+  std::vector<BaseStructure *> shards;
+  std::vector<Run> runs;
+  std::vector<K> pending;                           // Pushed but not yet inserted keys
+  u32 shard_keys;
+  u32 max_shards;
+  u32 batch_size;
+  unsigned long long total;
+
+  BaseStructure *createShard()
+  {
+    if (shards.empty())
+    {
+#ifndef SPU_SIMULATOR
+      return new BaseStructure();
+#else
+      return new Simulator();
+#endif
+    }
+    return shards.front()->newStructure();
+  }
+
+  /* Moves keys of the last shard to host run and replaces it by empty structure */
+  void spill()
+  {
+    BaseStructure *shard = shards.back();
+    Run run;
+    run.reserve(shard->get_power());
+    Cursor cursor(*shard, {0}, lastKey(), SPU_BATCH_MAX);
+    pair_t pair;
+    while (cursor.next(pair))
+    {
+      run.push_back({ pair.key, pair.value[0] });
+    }
+    runs.push_back(std::move(run));
+
+    delete shard;
+    shards.pop_back();
+    shards.push_back(createShard());
+  }
+
+  /* Shard for `count` more distinct keys */
+  BaseStructure &shardFor(u32 count)
+  {
+    if (!shards.empty() && shards.back()->get_power() + count <= shard_keys)
+    {
+      return *shards.back();
+    }
+    if (shards.size() < max_shards)
+    {
+      try
+      {
+        shards.push_back(createShard());
+        return *shards.back();
+      }
+      catch (CouldNotCreateStructure &) {}
+    }
+    spill();
+    return *shards.back();
+  }
+
+public:
+  explicit ExternalSort(u32 shard_limit = SORT_SHARD_KEYS, u32 shard_count = SPU_STR_NUM - 1,
+                        u32 batch = SORT_BATCH_SIZE) :
+    shard_keys(shard_limit ? shard_limit : 1), max_shards(shard_count ? shard_count : 1),
+    batch_size(batch ? batch : 1), total(0)
+  {
+    pending.reserve(batch_size);
+  }
+
+  ExternalSort(const ExternalSort &) = delete;
+  ExternalSort& operator=(const ExternalSort &) = delete;
+
+  ~ExternalSort()
+  {
+    for (auto ex : shards)
+    {
+      delete ex;
+    }
+  }
+
+  unsigned long long size() { return total; }
+  /// число структур и перенесенных на хост отрезков
+  size_t shardCount() { return shards.size(); }
+  size_t runCount()   { return runs.size(); }
+
+  /// добавляет ключ в пакет, пакет вставляется в СП при заполнении
+  void push(const K &key)
+  {
+    pending.push_back(key);
+    total++;
+    if (pending.size() >= batch_size)
+    {
+      flush();
+    }
+  }
+
+  /// вставляет накопленный пакет: равные ключи пакета считаются на хосте,
+  /// счетчики уже вставленных ключей читаются одним пакетом SRCH
+  void flush()
+  {
+    if (pending.empty())
+    {
+      return;
+    }
+
+    std::unordered_map<K, u32> counts;
+    for (auto &ex : pending)
+    {
+      counts[ex]++;
+    }
+    pending.clear();
+
+    BaseStructure &shard = shardFor(counts.size());
+    BaseStructure::InsertVector batch;
+    batch.reserve(counts.size());
+    for (auto &ex : counts)
+    {
+      value_t value = {0};
+      value[0] = ex.second;
+      batch.push_back({ Codec::encode(ex.first), value });
+    }
+
+    if (shard.get_power() > 0)
+    {
+      Batch search;
+      for (auto &ex : batch)
+      {
+        search.search(shard, ex.key);
+      }
+      BaseStructure::PairVector found = search.execute();
+      for (size_t i = 0; i < batch.size(); i++)
+      {
+        if (found[i].status == OK)
+        {
+          batch[i].value[0] += found[i].value[0];
+        }
+      }
+    }
+    shard.insert(batch);
+  }
+
+  /// передает ключи по возрастанию в out; каждый ключ повторяется столько раз, сколько был добавлен
+  template <class Out>
+  void emit(Out out)
+  {
+    flush();
+
+    /* Sources are shard cursors first and host runs after them */
+    std::vector<Cursor> cursors;
+    cursors.reserve(shards.size());
+    for (auto ex : shards)
+    {
+      cursors.emplace_back(*ex, key_t{0}, lastKey(), SPU_BATCH_MAX);
+    }
+    std::vector<size_t> run_pos(runs.size(), 0);
+
+    using Head = std::pair<pair_t, size_t>;
+    auto greater = [](const Head &a, const Head &b) { return a.first.key > b.first.key; };
+    std::priority_queue<Head, std::vector<Head>, decltype(greater)> heap(greater);
+
+    auto pull = [&](size_t src)
+    {
+      pair_t pair;
+      if (src < cursors.size())
+      {
+        if (cursors[src].next(pair)) { heap.push({ pair, src }); }
+        return;
+      }
+      size_t run = src - cursors.size();
+      if (run_pos[run] < runs[run].size())
+      {
+        auto &ex = runs[run][run_pos[run]++];
+        pair.key = ex.first;
+        pair.value = {0};
+        pair.value[0] = ex.second;
+        heap.push({ pair, src });
+      }
+    };
+
+    for (size_t i = 0; i < cursors.size() + runs.size(); i++)
+    {
+      pull(i);
+    }
+    while (!heap.empty())
+    {
+      Head head = heap.top();
+      heap.pop();
+      K key = Codec::decode(head.first.key);
+      for (u32 i = 0; i < head.first.value[0]; i++)
+      {
+        out(key);
+      }
+      pull(head.second);
+    }
+  }
+
+  /// все ключи по возрастанию
+  std::vector<K> sorted()
+  {
+    std::vector<K> ret;
+    ret.reserve(total);
+    emit([&ret](const K &key) { ret.push_back(key); });
+    return ret;
+  }
+};
+
+} /* namespace SPU */
+
+#endif /* EXTERNAL_SORT_HPP */
@@ -23,6 +23,8 @@
 
 #include "libspu.h"
 #include "fields_containers.hpp"
+#include "bitset.hpp"
+#include "fields_view.hpp"
 
 namespace SPU
 {
@@ -112,6 +114,12 @@ public:
   const BitFlow& operator[](NameT name) const { return data[name]; }
         BitFlow& operator[](NameT name)       { return data[name]; }
 
+  /* Field as bitset of field length */
+  Bitset bitset(NameT name)
+  {
+    return Bitset(data[name], length.find_data_by_name(name));
+  }
+
 };
 
 } /* namespace SPU */
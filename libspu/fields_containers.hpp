@@ -33,12 +33,24 @@ namespace SPU
 template <typename NameT>
 class Fields;
 
+/* FieldsView class declaration */
+template <typename NameT>
+class FieldsView;
+
+/* Absolute position of field in data_t */
+struct field_pos_t
+{
+  u32 offset;   // Offset from the least significant bit
+  u32 width;
+};
+
 /* Fields abstract data container */
 template <typename NameT = u8, typename ContentT = u32>
 class FieldsContainer
 {
   /* Friend */
   friend class Fields<NameT>;
+  friend class FieldsView<NameT>;
 
 protected:
   /* Content types */
@@ -62,6 +74,8 @@ protected:
     throw DidNotFoundDataByName<NameT>(ClName, name);
   }
 
+  inline ContentVector& content() { return cont_vec; }
+
 private:
   ContentVector cont_vec; // Content vector
   std::string ClName; // Class name to inform DidNotFoundDataByName error
@@ -94,7 +108,7 @@ private:
   /* Mask creator */
   inline data_t mask(u8& length)
   {
-    unsigned long long ret = ~( (-1) << length );
+    unsigned long long ret = length >= 64 ? ~0ULL : ~( ~0ULL << length );
     return BitFlow(ret);
   }
 
@@ -107,6 +121,38 @@ public:
   /* Subscript operators witch returns mask */
   const data_t operator[](NameT name) const { return mask(Parent::find_data_by_name(name)); }
         data_t operator[](NameT name)       { return mask(Parent::find_data_by_name(name)); }
+
+  /* Offset of field from the least significant bit of data */
+  u32 offset(NameT name)
+  {
+    u32 ret = 0;
+    for(auto &ex : Parent::content())
+    {
+      if(ex.name == name)
+      {
+        return ret;
+      }
+      ret += ex.cont;
+    }
+    throw DidNotFoundDataByName<NameT>("length", name);
+  }
+
+  /* Offset and length of field */
+  field_pos_t position(NameT name)
+  {
+    return { offset(name), Parent::find_data_by_name(name) };
+  }
+
+  /* Summary length of all fields */
+  u32 width()
+  {
+    u32 ret = 0;
+    for(auto &ex : Parent::content())
+    {
+      ret += ex.cont;
+    }
+    return ret;
+  }
 };
 
 
@@ -0,0 +1,158 @@
+/*
+  fields_view.hpp
+        - zero-copy view of Fields layout over data_t
+        - nested layouts are views with absolute offset into the parent data_t
+        - fields are extracted and deposited by words without unpacking the whole layout
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FIELDS_VIEW_HPP
+#define FIELDS_VIEW_HPP
+
+#include "libspu.h"
+#include "fields_containers.hpp"
+#include "bitset.hpp"
+#include "width.hpp"
+
+namespace SPU
+{
+
+/***************************************
+  Field extraction helpers
+***************************************/
+
+/* Field bits as data_t shifted to bit 0 */
+inline data_t extractData(const data_t &data, field_pos_t pos)
+{
+  data_t ret = {0};
+  for(u32 done = 0; done < pos.width && pos.offset + done < SPU_WEIGHT * 32; )
+  {
+    u32 src = (pos.offset + done) / 32, src_shift = (pos.offset + done) % 32;
+    u32 dst = done / 32,                dst_shift = done % 32;
+    u32 cnt = 32 - (src_shift > dst_shift ? src_shift : dst_shift);
+    if(cnt > pos.width - done) { cnt = pos.width - done; }
+
+    u32 mask = cnt == 32 ? ~0u : ( (1u << cnt) - 1 );
+    ret[dst] |= ( (data[src] >> src_shift) & mask ) << dst_shift;
+    done += cnt;
+  }
+  return ret;
+}
+
+/* Field up to 64 bits */
+inline unsigned long long extract(const data_t &data, field_pos_t pos)
+{
+  return Words<SPU_WEIGHT>::extract(data.cont, pos.offset, pos.width);
+}
+
+/* Writes low bits of value into field, other bits of data are kept */
+inline void depositData(data_t &data, field_pos_t pos, const data_t &value)
+{
+  for(u32 done = 0; done < pos.width && pos.offset + done < SPU_WEIGHT * 32; )
+  {
+    u32 dst = (pos.offset + done) / 32, dst_shift = (pos.offset + done) % 32;
+    u32 src = done / 32,                src_shift = done % 32;
+    u32 cnt = 32 - (src_shift > dst_shift ? src_shift : dst_shift);
+    if(cnt > pos.width - done) { cnt = pos.width - done; }
+
+    u32 mask = cnt == 32 ? ~0u : ( (1u << cnt) - 1 );
+    data[dst] = ( data[dst] & ~(mask << dst_shift) ) | ( ( (value[src] >> src_shift) & mask ) << dst_shift );
+    done += cnt;
+  }
+}
+
+inline void deposit(data_t &data, field_pos_t pos, unsigned long long value)
+{
+  Words<SPU_WEIGHT>::deposit(data.cont, pos.offset, pos.width, value);
+}
+
+
+/***************************************
+  FieldsView template class declaration
+***************************************/
+
+/* View of layout placed at `base` bit of data; neither data nor layout is copied */
+/* Both have to outlive the view */
+template <typename NameT = u8>
+class FieldsView
+{
+private:
+  data_t *data;
+  FieldsLength<NameT> *length;
+  u32 base;
+
+public:
+  FieldsView(data_t &fields_data, FieldsLength<NameT> &fields_length, u32 offset = 0) :
+    data(&fields_data), length(&fields_length), base(offset) {}
+
+  /* Absolute position of field in data */
+  field_pos_t position(NameT name)
+  {
+    field_pos_t ret = length->position(name);
+    ret.offset += base;
+    return ret;
+  }
+
+  /* Nested layout of field as view into the same data */
+  template <typename SubNameT>
+  FieldsView<SubNameT> view(NameT name, FieldsLength<SubNameT> &sub_length)
+  {
+    return FieldsView<SubNameT>(*data, sub_length, base + length->offset(name));
+  }
+
+  /* Field access by name */
+  unsigned long long get(NameT name)          { return extract(*data, position(name)); }
+  data_t getData(NameT name)                  { return extractData(*data, position(name)); }
+  Bitset bitset(NameT name)                   { field_pos_t pos = position(name); return Bitset(extractData(*data, pos), pos.width); }
+  void set(NameT name, unsigned long long value) { deposit(*data, position(name), value); }
+  void set(NameT name, const data_t &value)   { depositData(*data, position(name), value); }
+
+  /* Field access by cached position */
+  unsigned long long get(field_pos_t pos)          { return extract(*data, pos); }
+  void set(field_pos_t pos, unsigned long long value) { deposit(*data, pos, value); }
+
+  /* Writes all fields of fields data like Fields does: fields missing in data are kept, */
+  /* data not in layout is skipped */
+  FieldsView& assign(const FieldsData<NameT> &fields)
+  {
+    for(auto &ex : fields.cont_vec)
+    {
+      try
+      {
+        depositData(*data, position(ex.name), ex.cont);
+      }
+      catch(DidNotFoundDataByName<NameT>&) {}
+    }
+    return *this;
+  }
+
+  /* Whole layout as data shifted to bit 0 */
+  operator data_t() { return extractData(*data, { base, length->width() }); }
+};
+
+/* Packs fields data by layout into data_t */
+template <typename NameT>
+data_t pack(FieldsLength<NameT> &length, const FieldsData<NameT> &fields)
+{
+  data_t ret = {0};
+  FieldsView<NameT>(ret, length).assign(fields);
+  return ret;
+}
+
+} /* namespace SPU */
+
+#endif /* FIELDS_VIEW_HPP */
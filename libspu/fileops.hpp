@@ -21,6 +21,9 @@
 #ifndef FILEOPS_HPP
 #define FILEOPS_HPP
 
+#include "transport.h"
+
+#include <mutex>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -35,21 +38,30 @@ namespace SPU
 class Fileops
 {
 private:
-  int descriptor = 0; // Driver File Descriptor to connect SPU
+  const char *name;       // Driver file name
+  int descriptor = -1;    // Driver File Descriptor to connect SPU
+  std::once_flag opened;
+
+  /* Device is opened on first command, so simulator structures make no system calls */
+  /* Commands of one structure may come from several threads, the device is opened once */
+  int device()
+  {
+    std::call_once(opened, [this] { descriptor = open(name, O_RDWR); });
+    return descriptor;
+  }
 
 public:
 
   /* Constructor */
-  Fileops(const char* filename)
+  Fileops(const char* filename) : name(filename)
   {
-    descriptor = open(filename, O_RDWR);
   }
 
 
   /* Destructor */
   ~Fileops()
   {
-    if(descriptor)
+    if(descriptor >= 0)
     {
       close(descriptor);
     }
@@ -57,13 +69,37 @@ public:
 
 
   /* Template method witch executes given format */
+  /* Result is written over command: buffer holds the longer of them (format 2 result is longer on wide boards) */
   template<typename CmdFrmt, typename RsltFrmt>
   RsltFrmt execute(CmdFrmt &cmd)
   {
-    void* buf    = &cmd;
+    union
+    {
+      CmdFrmt cmd;
+      RsltFrmt rslt;
+    } buf;
+    buf.cmd = cmd;
+
+    if(Transport *transport = Transport::global())
+    {
+      transport->execute(&buf.cmd, &buf.rslt);
+      return buf.rslt;
+    }
     size_t count = sizeof(CmdFrmt);
-    count        = write(descriptor, buf, count);
-    return *(RsltFrmt *)buf;
+    count        = write(device(), &buf, count);
+    return buf.rslt;
+  }
+
+
+  /* Executes raw buffer in place (BTCH header with batch slots) */
+  size_t execute(void *buf, size_t count)
+  {
+    if(Transport *transport = Transport::global())
+    {
+      return transport->execute(buf, count);
+    }
+    ssize_t ret = write(device(), buf, count);
+    return ret < 0 ? 0 : ret;
   }
 };
 
@@ -0,0 +1,255 @@
+/*
+  histogram.cpp
+        - key distribution histogram class implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "histogram.h"
+
+#include <algorithm>
+
+namespace SPU
+{
+    /***************************************
+      Histogram class implementation
+    ***************************************/
+
+    Histogram::Histogram(BaseStructure &str, u32 buckets) : structure(&str), size(buckets ? buckets : 1)
+    {
+    }
+
+    u32 Histogram::depth() const
+    {
+        return std::max(1u, sum / size);
+    }
+
+    size_t Histogram::find(key_t key) const
+    {
+        auto it = std::upper_bound(list.begin(), list.end(), key,
+                                   [](const key_t &k, const Bucket &b) { return k < b.from; });
+        return it == list.begin() ? list.size() : it - list.begin() - 1;
+    }
+
+    void Histogram::divide(size_t index)
+    {
+        Bucket bucket = list[index];
+        u32 parts = (bucket.count + depth() - 1) / depth();
+        if(parts < 2 || bucket.from == bucket.to)
+        {
+            return;
+        }
+
+        BucketVector pieces;
+        for(auto &ex : structure->split(bucket.from, bucket.to, parts))
+        {
+            pieces.push_back({ ex.from, ex.to, structure->count(ex.from, ex.to) });
+        }
+        if(pieces.size() < 2)
+        {
+            return;
+        }
+
+        /* Count of bucket was estimated by observed changes, counts of parts are exact */
+        sum -= bucket.count;
+        for(auto &ex : pieces)
+        {
+            sum += ex.count;
+        }
+        list.erase(list.begin() + index);
+        list.insert(list.begin() + index, pieces.begin(), pieces.end());
+    }
+
+    void Histogram::merge()
+    {
+        while(list.size() > size)
+        {
+            size_t best = 0;
+            for(size_t i = 1; i + 1 < list.size(); i++)
+            {
+                if(list[i].count + list[i + 1].count < list[best].count + list[best + 1].count)
+                {
+                    best = i;
+                }
+            }
+            list[best].to     = list[best + 1].to;
+            list[best].count += list[best + 1].count;
+            list.erase(list.begin() + best + 1);
+        }
+    }
+
+    /* Ends are tightened to keys of structure, so interpolation of edge buckets sees real key spread */
+    void Histogram::build(key_t from, key_t to)
+    {
+        list.clear();
+        sum = 0;
+        for(auto &ex : structure->split(from, to, size))
+        {
+            list.push_back({ ex.from, ex.to, structure->count(ex.from, ex.to) });
+            sum += list.back().count;
+        }
+        if(list.empty())
+        {
+            return;
+        }
+
+        pair_t first = structure->search(list.front().from);
+        if(first.status != OK)
+        {
+            first = structure->ngr(list.front().from);
+        }
+        pair_t last = structure->search(list.back().to);
+        if(last.status != OK)
+        {
+            last = structure->nsm(list.back().to);
+        }
+        if(first.status == OK && first.key <= list.front().to)
+        {
+            list.front().from = first.key;
+        }
+        if(last.status == OK && last.key >= list.back().from)
+        {
+            list.back().to = last.key;
+        }
+
+        /* Probe estimates are refined: heavy buckets are split by their counts */
+        for(size_t i = list.size(); i > 0; i--)
+        {
+            if(list[i - 1].count > HIST_SPLIT_RATIO * depth())
+            {
+                divide(i - 1);
+            }
+        }
+        merge();
+    }
+
+    void Histogram::inserted(key_t key, u32 power_before, u32 power_after)
+    {
+        /* Buckets keep no keys, so replaced value is told from new key by power only */
+        if(power_after <= power_before)
+        {
+            return;
+        }
+        sum++;
+        if(list.empty())
+        {
+            list.push_back({ key, key, 1 });
+            return;
+        }
+
+        /* Key between buckets or out of them widens bucket on the left */
+        size_t index = find(key);
+        if(index == list.size())
+        {
+            index = 0;
+            list.front().from = key;
+        }
+        else if(key > list[index].to)
+        {
+            list[index].to = key;
+        }
+        list[index].count++;
+
+        if(list[index].count > HIST_SPLIT_RATIO * depth())
+        {
+            divide(index);
+            merge();
+        }
+    }
+
+    void Histogram::deleted(key_t key, u32 power_before, u32 power_after)
+    {
+        if(power_after >= power_before)
+        {
+            return;
+        }
+        size_t index = find(key);
+        if(index >= list.size() || key > list[index].to || list[index].count == 0)
+        {
+            return;
+        }
+        list[index].count--;
+        sum--;
+
+        /* Light bucket joins lighter neighbour, the deepest bucket is split instead */
+        if(list.size() > 1 && list[index].count * HIST_SPLIT_RATIO < depth())
+        {
+            size_t left = index;
+            if(index == 0 || (index + 1 < list.size() && list[index + 1].count < list[index - 1].count))
+            {
+                left = index + 1;
+            }
+            list[left - 1].to     = list[left].to;
+            list[left - 1].count += list[left].count;
+            list.erase(list.begin() + left);
+
+            auto deepest = std::max_element(list.begin(), list.end(),
+                                            [](const Bucket &a, const Bucket &b) { return a.count < b.count; });
+            divide(deepest - list.begin());
+            merge();
+        }
+    }
+
+    double Histogram::estimate(key_t from, key_t to) const
+    {
+        long double ret = 0;
+        size_t begin = find(from);
+        for(size_t i = begin < list.size() ? begin : 0; i < list.size() && list[i].from <= to; i++)
+        {
+            const Bucket &ex = list[i];
+            if(ex.to < from)
+            {
+                continue;
+            }
+            if(from <= ex.from && ex.to <= to)
+            {
+                ret += ex.count;
+                continue;
+            }
+            key_t lo = std::max(from, ex.from);
+            key_t hi = std::min(to, ex.to);
+            ret += ex.count * (magnitude(hi - lo) + 1) / (magnitude(ex.to - ex.from) + 1);
+        }
+        return (double) ret;
+    }
+
+    /* Range ends where cumulative depth passes next equal share, keys between buckets go to the left range */
+    BaseStructure::RangeVector Histogram::ranges(u32 parts) const
+    {
+        BaseStructure::RangeVector ret;
+        if(list.empty())
+        {
+            return ret;
+        }
+        parts = parts ? parts : 1;
+
+        key_t begin = list.front().from;
+        unsigned long long passed = 0;
+        for(size_t i = 0; i + 1 < list.size() && ret.size() + 1 < parts; i++)
+        {
+            passed += list[i].count;
+            if(passed * parts >= (unsigned long long) sum * (ret.size() + 1))
+            {
+                key_t end = list[i + 1].from;
+                --end;
+                ret.push_back({ begin, end });
+                begin = list[i + 1].from;
+            }
+        }
+        ret.push_back({ begin, list.back().to });
+        return ret;
+    }
+}
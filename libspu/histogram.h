@@ -0,0 +1,98 @@
+/*
+  histogram.h
+        - key distribution histogram class declaration
+        - equi-depth buckets from NSM and NGR probes of split(), depths are refined by range counts
+        - buckets are maintained by observed inserts and deletes: heavy bucket is split, light neighbours merge
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "libspu.h"
+#include "base_structure.h"
+#include "cursor.h"
+
+#include <vector>
+
+namespace SPU
+{
+
+/* Default number of buckets */
+#define HIST_BUCKETS 64
+
+/* Bucket deeper than HIST_SPLIT_RATIO average depths is split */
+#define HIST_SPLIT_RATIO 2
+
+/***************************************
+  Histogram class declaration
+***************************************/
+
+/* Equi-depth histogram of structure keys */
+class Histogram
+{
+public:
+  /* Keys [from, to] hold count pairs, buckets go by key and do not overlap */
+  struct Bucket
+  {
+    key_t from;
+    key_t to;
+    u32   count;
+  };
+  using BucketVector = std::vector<Bucket>;
+
+private:
+  BaseStructure *structure;
+  u32 size;                         // Buckets after build and rebalance
+  BucketVector list;
+  u32 sum = 0;                      // Pairs in buckets
+
+  u32 depth() const;
+  /// номер последней корзины, которая начинается не позже key, или size() - такой нет
+  size_t find(key_t key) const;
+  /// делит корзину на части средней глубины по точкам split() и подсчитывает их
+  void divide(size_t index);
+  /// сливает соседние корзины с наименьшей суммой, пока корзин больше size
+  void merge();
+
+public:
+  explicit Histogram(BaseStructure &str, u32 buckets = HIST_BUCKETS);
+
+  /// строит гистограмму ключей [from, to]: границы - split() структуры, глубины - count().
+  /// Корзины глубже HIST_SPLIT_RATIO средних делятся заново
+  void build(key_t from = {0}, key_t to = lastKey());
+
+  /// учитывает INS или DEL ключа, выполненные приложением, по мощности структуры до и после команды.
+  /// Замена значения и DEL отсутствующего ключа мощность не меняют и не учитываются.
+  /// Ключ вне корзин расширяет ближайшую корзину
+  void inserted(key_t key, u32 power_before, u32 power_after);
+  void deleted(key_t key, u32 power_before, u32 power_after);
+
+  const BucketVector &buckets() const { return list; }
+  u32 total() const { return sum; }
+
+  /// оценка числа ключей [from, to]: внутри корзины ключи считаются равномерными
+  double estimate(key_t from, key_t to) const;
+
+  /// смежные диапазоны с близким числом ключей для сегментирования и ParallelScan::forEach().
+  /// Границы проходят по границам корзин
+  BaseStructure::RangeVector ranges(u32 parts) const;
+};
+
+} /* namespace SPU */
+
+#endif /* HISTOGRAM_H */
@@ -0,0 +1,376 @@
+/*
+  inverted_index.cpp
+        - inverted index class implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "inverted_index.h"
+#include "errors/could_not_create_structure.hpp"
+#include "set_kernels.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace SPU
+{
+    /***************************************
+      InvertedIndex::Result class implementation
+    ***************************************/
+
+    InvertedIndex::Result::Result(BaseStructure *structure, u32 batch) :
+            docs(structure), cursor(new Cursor(*structure, {0}, SPU::lastKey(), batch)), pos(0), status(OK)
+    {
+    }
+
+    InvertedIndex::Result::Result(const DocVector &found, status_t status) :
+            docs(nullptr), cursor(nullptr), host(found), pos(0), status(status)
+    {
+    }
+
+    InvertedIndex::Result::Result(Result &&obj) :
+            docs(obj.docs), cursor(obj.cursor), host(std::move(obj.host)), pos(obj.pos), status(obj.status)
+    {
+        obj.docs = nullptr;
+        obj.cursor = nullptr;
+    }
+
+    InvertedIndex::Result::~Result()
+    {
+        delete cursor;
+        delete docs;
+    }
+
+    bool InvertedIndex::Result::next(doc_t &doc)
+    {
+        if (cursor == nullptr) {
+            if (pos == host.size()) {
+                return false;
+            }
+            doc = host[pos++];
+            return true;
+        }
+
+        pair_t pair;
+        if (!cursor->next(pair)) {
+            return false;
+        }
+        doc = pair.key[0];
+        return true;
+    }
+
+    InvertedIndex::DocVector InvertedIndex::Result::rest()
+    {
+        DocVector ret;
+        doc_t doc;
+        while (next(doc)) {
+            ret.push_back(doc);
+        }
+        return ret;
+    }
+
+    u32 InvertedIndex::Result::size()
+    {
+        return docs ? docs->get_power() : host.size();
+    }
+
+    bool InvertedIndex::Result::on_host()
+    {
+        return docs == nullptr;
+    }
+
+    status_t InvertedIndex::Result::get_status()
+    {
+        return status;
+    }
+
+
+    /***************************************
+      InvertedIndex class implementation
+    ***************************************/
+
+    InvertedIndex::InvertedIndex(BaseStructure *structure, u32 batch, u32 temporaries, u32 terms) :
+            base(structure),
+            key_fields({
+                { "doc",  II_DOC_BITS  },
+                { "term", II_TERM_BITS }
+            }),
+            batch_size(batch ? batch : 1),
+            max_temporaries(temporaries),
+            max_terms(terms)
+    {
+    }
+
+    InvertedIndex::~InvertedIndex()
+    {
+        for (auto &ex : term_docs) {
+            delete ex.second;
+        }
+    }
+
+    key_t InvertedIndex::makeKey(term_t term, doc_t doc)
+    {
+        key_fields["doc"]  = doc;
+        key_fields["term"] = term;
+        return key_fields;
+    }
+
+    InvertedIndex::term_t InvertedIndex::termOf(key_t key)
+    {
+        key_fields = BitFlow(key);
+        return key_fields["term"];
+    }
+
+    InvertedIndex::doc_t InvertedIndex::docOf(key_t key)
+    {
+        key_fields = BitFlow(key);
+        return key_fields["doc"];
+    }
+
+    key_t InvertedIndex::termBegin(term_t term)
+    {
+        return makeKey(term, 0);
+    }
+
+    key_t InvertedIndex::termEnd(term_t term)
+    {
+        return makeKey(term, (doc_t) ((1ULL << II_DOC_BITS) - 1));
+    }
+
+    key_t InvertedIndex::docKey(doc_t doc)
+    {
+        key_t ret = {0};
+        ret[0] = doc;
+        return ret;
+    }
+
+    BaseStructure *InvertedIndex::termDocs(term_t term, bool create)
+    {
+        auto it = term_docs.find(term);
+        if (it != term_docs.end()) {
+            return it->second;
+        }
+        /* Structure of a term with postings would miss them, such term stays on host */
+        if (!create || term_docs.size() >= max_terms || count(term) != 0) {
+            return nullptr;
+        }
+        try {
+            return term_docs[term] = base->newStructure();
+        } catch (CouldNotCreateStructure &) {
+            /* SPU structures are run out by other users */
+            max_terms = term_docs.size();
+            return nullptr;
+        }
+    }
+
+    void InvertedIndex::push(Batch &batch, cmd_t cmd, term_t term, doc_t doc, value_t value)
+    {
+        /* Posting is written to the base and to the kept structure of its term in one batch */
+        BaseStructure *docs = termDocs(term, cmd == INS);
+        if (cmd == INS) {
+            batch.insert(*base, makeKey(term, doc), value);
+            if (docs != nullptr) {
+                batch.insert(*docs, docKey(doc), value);
+            }
+        } else {
+            batch.del(*base, makeKey(term, doc));
+            if (docs != nullptr) {
+                batch.del(*docs, docKey(doc));
+            }
+        }
+    }
+
+    status_t InvertedIndex::flush(Batch &batch)
+    {
+        status_t status = OK;
+        for (auto &ex : batch.execute()) {
+            status |= ex.status;
+        }
+        return status;
+    }
+
+    status_t InvertedIndex::add(term_t term, doc_t doc, value_t value)
+    {
+        Batch batch;
+        push(batch, INS, term, doc, value);
+        return flush(batch);
+    }
+
+    status_t InvertedIndex::add(const PostingVector &postings)
+    {
+        Batch batch;
+        status_t status = OK;
+        for (auto &ex : postings) {
+            push(batch, INS, ex.term, ex.doc, ex.value);
+            if (batch.size() >= batch_size) {
+                status |= flush(batch);
+            }
+        }
+        if (!batch.empty()) {
+            status |= flush(batch);
+        }
+        return status;
+    }
+
+    status_t InvertedIndex::remove(term_t term, doc_t doc)
+    {
+        Batch batch;
+        push(batch, DEL, term, doc, {0});
+        return flush(batch);
+    }
+
+    status_t InvertedIndex::remove(term_t term)
+    {
+        auto it = term_docs.find(term);
+        if (it != term_docs.end()) {
+            delete it->second;
+            term_docs.erase(it);
+        }
+        return base->erase(termBegin(term), termEnd(term));
+    }
+
+    u32 InvertedIndex::count(term_t term)
+    {
+        return base->count(termBegin(term), termEnd(term));
+    }
+
+    status_t InvertedIndex::extract(term_t term, BaseStructure &result)
+    {
+        return base->slice(termBegin(term), termEnd(term), result);
+    }
+
+    InvertedIndex::TermVector InvertedIndex::byCount(const TermVector &terms, bool &empty)
+    {
+        std::vector<std::pair<u32, term_t>> counted;
+        counted.reserve(terms.size());
+        empty = false;
+        for (auto &ex : terms) {
+            u32 cnt = count(ex);
+            if (cnt == 0) {
+                empty = true;
+                return {};
+            }
+            counted.push_back({ cnt, ex });
+        }
+        std::sort(counted.begin(), counted.end());
+
+        TermVector ret;
+        ret.reserve(counted.size());
+        for (auto &ex : counted) {
+            ret.push_back(ex.second);
+        }
+        return ret;
+    }
+
+    InvertedIndex::DocVector InvertedIndex::postings(term_t term)
+    {
+        DocVector ret;
+        Cursor cursor(*base, termBegin(term), termEnd(term), batch_size);
+        pair_t pair;
+        while (cursor.next(pair)) {
+            ret.push_back(docOf(pair.key));
+        }
+        return ret;
+    }
+
+    InvertedIndex::Result InvertedIndex::evaluate(cmd_t cmd, const TermVector &terms)
+    {
+        /* Terms without kept structures are merged on host */
+        std::vector<BaseStructure *> operands;
+        operands.reserve(terms.size());
+        for (auto &ex : terms) {
+            BaseStructure *docs = termDocs(ex, false);
+            if (docs == nullptr || max_temporaries < 2) {
+                return evaluateOnHost(cmd, terms);
+            }
+            operands.push_back(docs);
+        }
+
+        /* At most two temporaries are alive: accumulator and result of command */
+        BaseStructure *acc = nullptr;
+        BaseStructure *out = nullptr;
+        try {
+            if (operands.size() == 1) {
+                acc = operands[0]->clone();
+            }
+            for (size_t i = 1; i < operands.size(); i++) {
+                if (cmd == AND && acc != nullptr && acc->get_power() == 0) {
+                    break;
+                }
+                BaseStructure &a = acc != nullptr ? *acc : *operands[0];
+                out = base->newStructure();
+                status_t status = cmd == AND ? a.intersect(*operands[i], *out) : a.unite(*operands[i], *out);
+                delete acc;
+                acc = out;
+                out = nullptr;
+                if (status != OK) {
+                    delete acc;
+                    return Result(DocVector(), status);
+                }
+            }
+        } catch (CouldNotCreateStructure &) {
+            /* SPU structures are run out by other users */
+            delete acc;
+            delete out;
+            return evaluateOnHost(cmd, terms);
+        }
+        return Result(acc, batch_size);
+    }
+
+    InvertedIndex::Result InvertedIndex::evaluateOnHost(cmd_t cmd, const TermVector &terms)
+    {
+        DocVector acc = postings(terms[0]);
+        for (size_t i = 1; i < terms.size(); i++) {
+            if (cmd == AND && acc.empty()) {
+                break;
+            }
+            DocVector operand = postings(terms[i]);
+            std::vector<u32> pos(cmd == AND ? acc.size() : acc.size() + operand.size());
+            size_t count = cmd == AND ? setIntersect(acc.data(), acc.size(), operand.data(), operand.size(), pos.data())
+                                      : setUnite(acc.data(), acc.size(), operand.data(), operand.size(), pos.data());
+            DocVector out(count);
+            for (size_t k = 0; k < count; k++) {
+                out[k] = pos[k] & SET_FROM_B ? operand[pos[k] & ~SET_FROM_B] : acc[pos[k]];
+            }
+            acc.swap(out);
+        }
+        return Result(acc);
+    }
+
+    InvertedIndex::Result InvertedIndex::all(const TermVector &terms)
+    {
+        /* Rarest terms go first, so the accumulator only shrinks */
+        bool empty;
+        TermVector order = byCount(terms, empty);
+        if (empty || order.empty()) {
+            return Result(DocVector());
+        }
+        return evaluate(AND, order);
+    }
+
+    InvertedIndex::Result InvertedIndex::any(const TermVector &terms)
+    {
+        if (terms.empty()) {
+            return Result(DocVector());
+        }
+        return evaluate(OR, terms);
+    }
+
+    u32 InvertedIndex::get_power()
+    {
+        return base->get_power();
+    }
+}
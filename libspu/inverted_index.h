@@ -0,0 +1,164 @@
+/*
+  inverted_index.h
+        - inverted index class declaration
+        - postings of all terms are stored in one SPU structure with key (term id, doc id)
+        - conjunctive and disjunctive queries are evaluated by AND and OR of SPU structures
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INVERTED_INDEX_H
+#define INVERTED_INDEX_H
+
+#include "libspu.h"
+#include "fields.hpp"
+#include "base_structure.h"
+#include "backend.hpp"
+#include "cursor.h"
+#include "batch.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace SPU
+{
+
+/* Width of key fields: doc id is the low part of key, term id is the high part */
+#define II_DOC_BITS  ( SPU_WEIGHT > 1 ? 32 : 16 )
+#define II_TERM_BITS ( SPU_WEIGHT > 1 ? 32 : 16 )
+
+/* Default count of postings in one insert or scan batch */
+#define II_BATCH_SIZE 256
+
+/* Default limit of temporary structures of one query: accumulator and result of command */
+#define II_MAX_TEMPORARIES 2
+
+/* Default limit of kept doc keyed structures of terms */
+/* The index itself and temporaries of a query take the rest of SPU_STR_NUM structures */
+#define II_MAX_TERM_STRUCTURES ( SPU_STR_NUM - 1 - II_MAX_TEMPORARIES )
+
+/***************************************
+  InvertedIndex class declaration
+***************************************/
+
+/* Inverted index of documents by terms on top of one SPU structure */
+class InvertedIndex
+{
+public:
+  using term_t = u32;
+  using doc_t  = u32;
+  using TermVector = std::vector<term_t>;
+  using DocVector  = std::vector<doc_t>;
+
+  struct Posting
+  {
+    term_t  term;
+    doc_t   doc;
+    value_t value;
+  };
+  using PostingVector = std::vector<Posting>;
+
+  /* Query result: doc ids in ascending order, read by batches */
+  /* Result is kept in SPU structure or on host when SPU structures are run out */
+  class Result
+  {
+  private:
+    BaseStructure *docs;              // Doc keyed structure, owned
+    Cursor *cursor;
+    DocVector host;                   // Host side result
+    size_t pos;
+    status_t status;
+
+  public:
+    explicit Result(BaseStructure *structure, u32 batch = II_BATCH_SIZE);
+    explicit Result(const DocVector &found, status_t status = OK);
+    Result(Result &&obj);
+    Result(const Result &obj) = delete;
+    ~Result();
+
+    /// возвращает следующий документ, false в конце результата
+    bool next(doc_t &doc);
+    /// читает все оставшиеся документы
+    DocVector rest();
+    u32 size();
+    /// результат вычислен на хосте
+    bool on_host();
+    /// ERR, если команда СП над структурами завершилась ошибкой; результат тогда пуст
+    status_t get_status();
+  };
+
+private:
+  DynamicBackend base;
+  Fields<std::string> key_fields;             // (doc, term) key layout
+  std::map<term_t, BaseStructure *> term_docs; // Kept doc keyed structures of terms, owned
+  u32 batch_size;
+  u32 max_temporaries;
+  u32 max_terms;
+
+  key_t termBegin(term_t term);
+  key_t termEnd(term_t term);
+  static key_t docKey(doc_t doc);
+
+  /// число документов каждого термина, сортировка терминов по нему
+  TermVector byCount(const TermVector &terms, bool &empty);
+  /// структура термина с ключом по документу или nullptr.
+  /// С create новая структура создается для термина без постингов, пока не исчерпан лимит
+  BaseStructure *termDocs(term_t term, bool create);
+  /// добавляет запись постинга в основную структуру и в структуру термина
+  void push(Batch &batch, cmd_t cmd, term_t term, doc_t doc, value_t value);
+  static status_t flush(Batch &batch);
+  /// документы термина на хосте
+  DocVector postings(term_t term);
+
+  /// вычисление запроса командой AND или OR над структурами терминов
+  Result evaluate(cmd_t cmd, const TermVector &terms);
+  /// вычисление запроса слиянием списков документов на хосте
+  Result evaluateOnHost(cmd_t cmd, const TermVector &terms);
+
+public:
+  explicit InvertedIndex(BaseStructure *structure = nullptr, u32 batch = II_BATCH_SIZE,
+                         u32 temporaries = II_MAX_TEMPORARIES, u32 terms = II_MAX_TERM_STRUCTURES);
+  ~InvertedIndex();
+
+  /// упаковывает идентификаторы термина и документа в ключ
+  key_t makeKey(term_t term, doc_t doc);
+  term_t termOf(key_t key);
+  doc_t docOf(key_t key);
+
+  status_t add(term_t term, doc_t doc, value_t value = {0});
+  /// добавляет постинги пакетами
+  status_t add(const PostingVector &postings);
+  status_t remove(term_t term, doc_t doc);
+  /// удаляет все постинги термина
+  status_t remove(term_t term);
+
+  /// число документов термина
+  u32 count(term_t term);
+  /// извлекает постинги термина в структуру result срезами GREQ и LSEQ
+  status_t extract(term_t term, BaseStructure &result);
+
+  /// документы, содержащие все термины (AND)
+  Result all(const TermVector &terms);
+  /// документы, содержащие хотя бы один термин (OR)
+  Result any(const TermVector &terms);
+
+  u32 get_power();
+};
+
+} /* namespace SPU */
+
+#endif /* INVERTED_INDEX_H */
@@ -0,0 +1,136 @@
+/*
+  key_codec.hpp
+        - order-preserving codecs of key types: order of SPU keys equals order of source keys
+        - unsigned integers as is, signed ones with inverted sign bit, floating point by sign-magnitude flip
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEY_CODEC_HPP
+#define KEY_CODEC_HPP
+
+#include "libspu.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace SPU
+{
+
+/***************************************
+  Key codecs
+***************************************/
+
+/* Order-preserving codec of key type: a < b exactly when encode(a) < encode(b) */
+template <typename K, typename Enable = void>
+struct KeyCodec;
+
+/* Unsigned integers are stored as is */
+template <typename K>
+struct KeyCodec<K, typename std::enable_if<std::is_integral<K>::value && std::is_unsigned<K>::value>::type>
+{
+  static_assert(sizeof(K) <= sizeof(key_t), "Key type is wider than SPU key");
+
+  static key_t encode(K key)
+  {
+    key_t ret = {0};
+    std::memcpy(&ret, &key, sizeof key);
+    return ret;
+  }
+
+  static K decode(const key_t &key)
+  {
+    K ret;
+    std::memcpy(&ret, &key, sizeof ret);
+    return ret;
+  }
+};
+
+/* Signed integers have sign bit inverted */
+template <typename K>
+struct KeyCodec<K, typename std::enable_if<std::is_integral<K>::value && std::is_signed<K>::value>::type>
+{
+  using U = typename std::make_unsigned<K>::type;
+  static constexpr U SIGN = (U) 1 << (sizeof(K) * 8 - 1);
+
+  static key_t encode(K key) { return KeyCodec<U>::encode((U) key ^ SIGN); }
+  static K decode(const key_t &key) { return (K) (KeyCodec<U>::decode(key) ^ SIGN); }
+};
+
+/* Floating point numbers: negative ones are inverted, positive ones get sign bit set */
+template <typename K>
+struct KeyCodec<K, typename std::enable_if<std::is_floating_point<K>::value>::type>
+{
+  using U = typename std::conditional<sizeof(K) == 4, u32, unsigned long long>::type;
+  static constexpr U SIGN = (U) 1 << (sizeof(K) * 8 - 1);
+
+  static key_t encode(K key)
+  {
+    U bits;
+    std::memcpy(&bits, &key, sizeof bits);
+    bits = (bits & SIGN) ? ~bits : bits | SIGN;
+    return KeyCodec<U>::encode(bits);
+  }
+
+  static K decode(const key_t &key)
+  {
+    U bits = KeyCodec<U>::decode(key);
+    bits = (bits & SIGN) ? bits & ~SIGN : ~bits;
+    K ret;
+    std::memcpy(&ret, &bits, sizeof ret);
+    return ret;
+  }
+};
+
+/* Strings up to SPU key size without zero chars: the first char is the most significant byte */
+template <>
+struct KeyCodec<std::string>
+{
+  static key_t encode(const std::string &key)
+  {
+    if (key.size() > sizeof(key_t))
+    {
+      throw std::length_error("String key is longer than SPU key");
+    }
+    key_t ret = {0};
+    for (size_t i = 0; i < key.size(); i++)
+    {
+      ret[SPU_WEIGHT - 1 - i / 4] |= (u32) (unsigned char) key[i] << (24 - 8 * (i % 4));
+    }
+    return ret;
+  }
+
+  static std::string decode(const key_t &key)
+  {
+    std::string ret;
+    for (size_t i = 0; i < sizeof(key_t); i++)
+    {
+      char ch = (char) (key[SPU_WEIGHT - 1 - i / 4] >> (24 - 8 * (i % 4)));
+      if (ch == 0)
+      {
+        break;
+      }
+      ret.push_back(ch);
+    }
+    return ret;
+  }
+};
+
+} /* namespace SPU */
+
+#endif /* KEY_CODEC_HPP */
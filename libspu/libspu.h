@@ -66,6 +66,7 @@ public:
     auto max_size = sizeof d;
     auto bytes_cnt = data_size < max_size ? data_size : max_size;
     std::memcpy(&d, &data, bytes_cnt);
+    return *this;
   }
 
   data_t get() { return d; }
@@ -83,7 +84,7 @@ public:
 
   template <typename T>
   BitFlow& operator<< (T data) {
-    set(data);
+    return set(data);
   }
   template <typename T>
   T& operator>> (T value) { return (T&) d; }
@@ -0,0 +1,339 @@
+/*
+  map.hpp
+        - ordered map template class with std::map-like interface on top of SPU structure
+        - keys are packed by order-preserving codecs, so SPU order equals order of keys
+        - small trivially copyable values are stored inline, others are stored on host by id
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAP_HPP
+#define MAP_HPP
+
+#include "libspu.h"
+#include "base_structure.h"
+#include "backend.hpp"
+#include "cursor.h"
+#include "key_codec.hpp"
+
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace SPU
+{
+
+/* Default count of pairs read ahead by map iterator */
+#define MAP_READ_AHEAD 64
+
+/***************************************
+  Value stores
+***************************************/
+
+/* Values fitting SPU value are stored inline */
+template <typename V, bool Inline = std::is_trivially_copyable<V>::value && sizeof(V) <= sizeof(value_t)>
+class ValueStore
+{
+public:
+  value_t put(const V &value)
+  {
+    value_t ret = {0};
+    std::memcpy(&ret, &value, sizeof value);
+    return ret;
+  }
+
+  /// замещает значение по ранее выданному идентификатору, true если запись в СП не нужна
+  bool replace(const value_t &, const V &) { return false; }
+
+  V get(const value_t &value) const
+  {
+    V ret;
+    std::memcpy(&ret, &value, sizeof ret);
+    return ret;
+  }
+
+  void release(const value_t &) {}
+  void clear() {}
+};
+
+/* Other values are stored on host in slots, SPU value holds slot number */
+template <typename V>
+class ValueStore<V, false>
+{
+private:
+  std::vector<V>   slots;
+  std::vector<u32> free_slots;
+
+public:
+  value_t put(const V &value)
+  {
+    value_t ret = {0};
+    if (free_slots.empty())
+    {
+      ret[0] = slots.size();
+      slots.push_back(value);
+    }
+    else
+    {
+      ret[0] = free_slots.back();
+      free_slots.pop_back();
+      slots[ret[0]] = value;
+    }
+    return ret;
+  }
+
+  bool replace(const value_t &id, const V &value)
+  {
+    slots[id[0]] = value;
+    return true;
+  }
+
+  V get(const value_t &id) const { return slots[id[0]]; }
+
+  void release(const value_t &id)
+  {
+    slots[id[0]] = V();
+    free_slots.push_back(id[0]);
+  }
+
+  void clear()
+  {
+    slots.clear();
+    free_slots.clear();
+  }
+};
+
+
+/***************************************
+  Map template class declaration
+***************************************/
+
+/* Ordered map of K to V stored in SPU structure */
+/* Iterators are snapshots: they read pairs ahead by batches and do not see later changes */
+template <typename K, typename V>
+class Map
+{
+public:
+  using key_type    = K;
+  using mapped_type = V;
+  using value_type  = std::pair<const K, V>;
+  using size_type   = std::size_t;
+  using Codec       = KeyCodec<K>;
+
+  class const_iterator
+  {
+    friend class Map;
+
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type        = typename Map::value_type;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const value_type *;
+    using reference         = const value_type &;
+
+  private:
+    using Buffer = std::vector<value_type>;
+
+    Map *map;
+    std::shared_ptr<Buffer> buf;   // Pairs read ahead, shared by copies of iterator
+    std::size_t pos;               // Position in buffer, end iterator has no buffer
+
+    const_iterator(Map *owner, std::shared_ptr<Buffer> pairs, std::size_t position = 0) :
+      map(owner), buf(pairs), pos(position)
+    {
+      if (buf && buf->empty()) { buf.reset(); }
+    }
+
+  public:
+    const_iterator() : map(nullptr), pos(0) {}
+
+    reference operator*()  const { return (*buf)[pos]; }
+    pointer   operator->() const { return &(*buf)[pos]; }
+
+    const_iterator& operator++()
+    {
+      if (++pos == buf->size())
+      {
+        /* Next batch goes after the last read key */
+        key_t key = Codec::encode((*buf)[pos - 1].first);
+        *this = key == lastKey() ? map->end() : map->readFrom(++key);
+      }
+      return *this;
+    }
+
+    const_iterator& operator--()
+    {
+      if (!buf)
+      {
+        *this = map->fetch(map->base->max());
+      }
+      else if (pos > 0)
+      {
+        pos--;
+      }
+      else
+      {
+        /* Only forward read ahead exists, so previous pair is got by PREV */
+        *this = map->fetch(map->base->prev(Codec::encode((*buf)[pos].first)));
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) { const_iterator ret = *this; ++*this; return ret; }
+    const_iterator operator--(int) { const_iterator ret = *this; --*this; return ret; }
+
+    bool operator==(const const_iterator &other) const
+    {
+      if (!buf || !other.buf) { return !buf && !other.buf; }
+      return Codec::encode((*buf)[pos].first) == Codec::encode((*other.buf)[other.pos].first);
+    }
+    bool operator!=(const const_iterator &other) const { return !(*this == other); }
+  };
+  using iterator = const_iterator;
+
+private:
+  DynamicBackend base;
+  ValueStore<V> values;
+  u32 read_ahead;
+
+  value_type decodePair(const pair_t &pair) const
+  {
+    return value_type(Codec::decode(pair.key), values.get(pair.value));
+  }
+
+  /* Iterator holding one found pair or end */
+  const_iterator fetch(const pair_t &pair)
+  {
+    auto buf = std::make_shared<typename const_iterator::Buffer>();
+    if (pair.status == OK)
+    {
+      buf->push_back(decodePair(pair));
+    }
+    return const_iterator(this, buf);
+  }
+
+  /* Iterator on the first key not less than key with pairs read ahead */
+  const_iterator readFrom(key_t key)
+  {
+    auto buf = std::make_shared<typename const_iterator::Buffer>();
+    for (auto &ex : base->scan(key, lastKey(), read_ahead))
+    {
+      buf->push_back(decodePair(ex));
+    }
+    return const_iterator(this, buf);
+  }
+
+public:
+  explicit Map(BaseStructure *structure = nullptr, u32 batch = MAP_READ_AHEAD) :
+    base(structure), read_ahead(batch ? batch : 1)
+  {
+  }
+
+  Map(const Map &) = delete;
+  Map& operator=(const Map &) = delete;
+
+  /* Capacity */
+  size_type size()  { return base->get_power(); }
+  bool      empty() { return size() == 0; }
+
+  /* Iterators */
+  const_iterator begin() { return readFrom({0}); }
+  const_iterator end()   { return const_iterator(this, nullptr); }
+
+  /* Lookup */
+  const_iterator find(const K &key)  { return fetch(base->search(Codec::encode(key))); }
+  size_type count(const K &key)      { return base->search(Codec::encode(key)).status == OK ? 1 : 0; }
+  const_iterator lower_bound(const K &key) { return readFrom(Codec::encode(key)); }
+  const_iterator upper_bound(const K &key)
+  {
+    key_t enc = Codec::encode(key);
+    return enc == lastKey() ? end() : readFrom(++enc);
+  }
+
+  /// значение по ключу, std::out_of_range если ключа нет
+  V at(const K &key)
+  {
+    pair_t pair = base->search(Codec::encode(key));
+    if (pair.status != OK)
+    {
+      throw std::out_of_range("SPU::Map::at");
+    }
+    return values.get(pair.value);
+  }
+
+  /* Modifiers */
+
+  /// вставляет пару, если ключа нет; second - была ли вставка
+  std::pair<const_iterator, bool> insert(const value_type &pair)
+  {
+    key_t key = Codec::encode(pair.first);
+    pair_t found = base->search(key);
+    if (found.status == OK)
+    {
+      return { fetch(found), false };
+    }
+    base->insert(key, values.put(pair.second));
+    return { find(pair.first), true };
+  }
+
+  /// вставляет пару или замещает значение; second - была ли вставка
+  std::pair<const_iterator, bool> insert_or_assign(const K &key, const V &value)
+  {
+    key_t enc = Codec::encode(key);
+    pair_t found = base->search(enc);
+    bool inserted = found.status != OK;
+    if (inserted || !values.replace(found.value, value))
+    {
+      base->insert(enc, values.put(value));
+    }
+    return { find(key), inserted };
+  }
+
+  size_type erase(const K &key)
+  {
+    key_t enc = Codec::encode(key);
+    pair_t found = base->search(enc);
+    if (found.status != OK)
+    {
+      return 0;
+    }
+    base->del(enc);
+    values.release(found.value);
+    return 1;
+  }
+
+  const_iterator erase(const_iterator pos)
+  {
+    K key = pos->first;
+    erase(key);
+    return upper_bound(key);
+  }
+
+  void clear()
+  {
+    base->erase({0}, lastKey());
+    values.clear();
+  }
+};
+
+} /* namespace SPU */
+
+#endif /* MAP_HPP */
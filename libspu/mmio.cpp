@@ -0,0 +1,607 @@
+/*
+  mmio.cpp
+        - userspace command executor implementation
+        - command workflow follows spudrv/cmdexec.c: bursts to registers, polling of state, result decoding
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mmio.h"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <memory>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/vfio.h>
+
+namespace SPU
+{
+    /***************************************
+      MappedRegisters class implementation
+    ***************************************/
+
+    MappedRegisters::~MappedRegisters()
+    {
+        if(base)
+        {
+            munmap((void *) base, size);
+        }
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        if(group >= 0)
+        {
+            close(group);
+        }
+        if(container >= 0)
+        {
+            close(container);
+        }
+    }
+
+    void MappedRegisters::map(off_t offset, size_t length)
+    {
+        void *ptr = length ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset) : MAP_FAILED;
+        if(ptr == MAP_FAILED)
+        {
+            throw CouldNotMapDevice();
+        }
+        base = (volatile u8 *) ptr;
+        size = length;
+    }
+
+    /* Revision of PCI device from sysfs, 0 if unknown */
+    void MappedRegisters::readRevision(const std::string &device)
+    {
+        std::ifstream in(device + "/revision");
+        unsigned int value = 0;
+        if(in >> std::hex >> value)
+        {
+            rev = (u8) value;
+        }
+    }
+
+    /* UIO map 0 or sysfs resource file of BAR 0 */
+    MappedRegisters *MappedRegisters::open(const char *path)
+    {
+        std::unique_ptr<MappedRegisters> ret(new MappedRegisters());
+        ret->fd = ::open(path, O_RDWR | O_SYNC);
+        if(ret->fd < 0)
+        {
+            throw CouldNotMapDevice();
+        }
+
+        std::string name(path);
+        size_t slash = name.rfind('/');
+        if(name.compare(0, 8, "/dev/uio") == 0)
+        {
+            std::string uio = "/sys/class/uio/" + name.substr(slash + 1);
+            std::ifstream in(uio + "/maps/map0/size");
+            unsigned long long length = 0;
+            in >> std::hex >> length;
+            ret->readRevision(uio + "/device");
+            ret->map(0, length);
+        }
+        else
+        {
+            struct stat st;
+            if(fstat(ret->fd, &st) != 0)
+            {
+                throw CouldNotMapDevice();
+            }
+            ret->readRevision(name.substr(0, slash));
+            ret->map(0, st.st_size);
+        }
+        return ret.release();
+    }
+
+    /* Container with type 1 IOMMU, group and device of vfio-pci; BAR 0 region is mapped */
+    MappedRegisters *MappedRegisters::vfio(const char *group, const char *bdf)
+    {
+        std::unique_ptr<MappedRegisters> ret(new MappedRegisters());
+        ret->container = ::open("/dev/vfio/vfio", O_RDWR);
+        if(ret->container < 0 || ioctl(ret->container, VFIO_GET_API_VERSION) != VFIO_API_VERSION ||
+           !ioctl(ret->container, VFIO_CHECK_EXTENSION, VFIO_TYPE1_IOMMU))
+        {
+            throw CouldNotMapDevice();
+        }
+
+        ret->group = ::open((std::string("/dev/vfio/") + group).c_str(), O_RDWR);
+        struct vfio_group_status status = { sizeof(status), 0 };
+        if(ret->group < 0 || ioctl(ret->group, VFIO_GROUP_GET_STATUS, &status) != 0 ||
+           !(status.flags & VFIO_GROUP_FLAGS_VIABLE) ||
+           ioctl(ret->group, VFIO_GROUP_SET_CONTAINER, &ret->container) != 0 ||
+           ioctl(ret->container, VFIO_SET_IOMMU, VFIO_TYPE1_IOMMU) != 0)
+        {
+            throw CouldNotMapDevice();
+        }
+
+        ret->fd = ioctl(ret->group, VFIO_GROUP_GET_DEVICE_FD, bdf);
+        struct vfio_region_info bar = {};
+        bar.argsz = sizeof(bar);
+        bar.index = VFIO_PCI_BAR0_REGION_INDEX;
+        if(ret->fd < 0 || ioctl(ret->fd, VFIO_DEVICE_GET_REGION_INFO, &bar) != 0 ||
+           !(bar.flags & VFIO_REGION_INFO_FLAG_MMAP))
+        {
+            throw CouldNotMapDevice();
+        }
+
+        /* Revision is byte 8 of configuration space */
+        struct vfio_region_info config = {};
+        config.argsz = sizeof(config);
+        config.index = VFIO_PCI_CONFIG_REGION_INDEX;
+        if(ioctl(ret->fd, VFIO_DEVICE_GET_REGION_INFO, &config) == 0 &&
+           pread(ret->fd, &ret->rev, 1, config.offset + 8) != 1)
+        {
+            ret->rev = 0;
+        }
+
+        ret->map(bar.offset, bar.size);
+        return ret.release();
+    }
+
+
+    /***************************************
+      Mmio class implementation
+    ***************************************/
+
+    Mmio::Mmio(Registers &registers) : regs(&registers), random(std::random_device()())
+    {
+        for(auto &ex : gsids)
+        {
+            ex = gsid_t{ {0} };
+        }
+    }
+
+    /* Reset as in driver probe */
+    bool Mmio::reset()
+    {
+        put(CNTL_REG_1, MMIO_RESET_ALL);
+        put(CNTL_REG_0, (1u << SPU2CPU_DRDY_INT_EN) | (1u << SYS2SPU_QOVF_INT_EN));
+
+        reads++;
+        if(((regs->status(STATE_REG_0) >> DDR_TEST_SUCC_FLAG) & 1) == 0)
+        {
+            return false;
+        }
+
+        for(u32 i = 0; i < SPU_STR_NUM; i++)
+        {
+            put(CMD_REG, MMIO_CMD(DELS) | MMIO_STR_R(i + 1));
+            gsids[i] = gsid_t{ {0} };
+        }
+        return true;
+    }
+
+    /* GSID as driver generates it: driver version and SPU revision, random words and time */
+    bool Mmio::create(gsid_t &gsid)
+    {
+        for(auto &ex : gsids)
+        {
+            if(ex == gsid_t{ {0} })
+            {
+                gsid.cont[0] = (DRIVER_VERSION_NUM << GSID_DRIVER_SHIFT) | regs->revision();
+                gsid.cont[1] = random();
+                gsid.cont[2] = random();
+                gsid.cont[3] = (u32) time(nullptr);
+                ex = gsid;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    u32 Mmio::resolve(const gsid_t &gsid, cmd_t cmd)
+    {
+        for(u32 i = 0; i < SPU_STR_NUM; i++)
+        {
+            if(gsids[i] == gsid && gsid != gsid_t{ {0} })
+            {
+                if((cmd & CMD_MASK) == DELS)
+                {
+                    gsids[i] = gsid_t{ {0} };
+                }
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+
+    /* Busy polling: process does not give up CPU between reads */
+    bool Mmio::poll(u32 reg, u8 shift, u8 &state)
+    {
+        for(u32 i = 0; i < MMIO_POLL_ATTEMPTS; i++)
+        {
+            reads++;
+            state = regs->status(reg);
+            if((state >> shift) & 1)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Command workflow of execute_cmd: burst to registers with command word last, polling, result */
+    bool Mmio::command(const void *cmd_buf, void *rslt_buf)
+    {
+        const batch_slot_t *slot = (const batch_slot_t *) cmd_buf;
+        batch_slot_t out;
+        cmd_t cmd = slot->frmt_0.cmd;
+        bool wait = cmd & P_FLAG;
+
+        /* Without polling result is OK and nothing is read from SPU */
+        size_t size = sizeof(rslt_t);
+        out.rslt_0.rslt = wait ? ERR : OK;
+
+        /* Burst words, command word goes last */
+        u32 addrs[SPU_WEIGHT*2 + 1], words[SPU_WEIGHT*2 + 1];
+        u32 count = 0;
+        u32 str = 0, str_b = 0, str_r = 0;
+        const data_container *key = nullptr, *val = nullptr;
+        bool pair = false;          // Result of format 2 with pair
+
+        switch(cmd & CMD_MASK)
+        {
+            case ADDS:
+                out.rslt_0.rslt = create(out.rslt_0.gsid) ? OK : ERR;
+                memcpy(rslt_buf, &out, sizeof(adds_rslt_t));
+                return out.rslt_0.rslt == OK;
+
+            case INS:
+                str = resolve(slot->frmt_1.gsid, cmd);
+                key = &slot->frmt_1.key;
+                val = &slot->frmt_1.val;
+                break;
+
+            case SRCH:
+            case DEL:
+            case NEXT:
+            case PREV:
+            case NSM:
+            case NGR:
+                str  = resolve(slot->frmt_2.gsid, cmd);
+                key  = &slot->frmt_2.key;
+                pair = true;
+                break;
+
+            case MIN:
+            case MAX:
+                pair = true;
+                /* fall through */
+            case DELS:
+            case SQ:
+                str = resolve(slot->frmt_3.gsid, cmd);
+                break;
+
+            case AND:
+            case OR:
+            case NOT:
+                str   = resolve(slot->frmt_4.gsid_a, cmd);
+                str_b = resolve(slot->frmt_4.gsid_b, cmd);
+                str_r = resolve(slot->frmt_4.gsid_r, cmd);
+                if(!str_b || !str_r)
+                {
+                    str = 0;
+                }
+                break;
+
+            /* Slice key is written too: SPU compares pairs with KEY register */
+            case LS:
+            case LSEQ:
+            case GR:
+            case GREQ:
+                str   = resolve(slot->frmt_5.gsid_a, cmd);
+                str_r = resolve(slot->frmt_5.gsid_r, cmd);
+                key   = &slot->frmt_5.key;
+                if(!str_r)
+                {
+                    str = 0;
+                }
+                break;
+        }
+
+        if(wait)
+        {
+            size = pair ? sizeof(rsltfrmt_2) : sizeof(rsltfrmt_1);
+            out.rslt_2.power = 0;
+        }
+        if(str == 0)
+        {
+            out.rslt_0.rslt = ERR;
+            memcpy(rslt_buf, &out, size);
+            return false;
+        }
+
+        for(u32 i = 0; key && i < SPU_WEIGHT; i++)
+        {
+            addrs[count]   = KEY_REG + i;
+            words[count++] = key->cont[i];
+        }
+        for(u32 i = 0; val && i < SPU_WEIGHT; i++)
+        {
+            addrs[count]   = VAL_REG + i;
+            words[count++] = val->cont[i];
+        }
+        addrs[count] = CMD_REG;
+        switch(cmd & CMD_MASK)
+        {
+            case AND:
+            case OR:
+            case NOT:
+                words[count++] = MMIO_CMD(cmd & CMD_TO_SPU) | MMIO_STR_A(str) | MMIO_STR_B(str_b) | MMIO_STR_R(str_r);
+                break;
+
+            case LS:
+            case LSEQ:
+            case GR:
+            case GREQ:
+                words[count++] = MMIO_CMD(cmd & CMD_TO_SPU) | MMIO_STR_A(str) | MMIO_STR_R(str_r);
+                break;
+
+            default:
+                words[count++] = MMIO_CMD(cmd & CMD_TO_SPU) | str;
+                break;
+        }
+
+        /* Queue is ready if queuing without reset, then SPU is ready */
+        u8 state = 0;
+        if(((cmd & Q_FLAG) && !(cmd & R_FLAG) && !poll(STATE_REG_1, SYS2SPU_Q_EMP_FLAG, state)) ||
+           !poll(STATE_REG_0, SPU_READY_FLAG, state))
+        {
+            out.rslt_0.rslt = ERR;
+            memcpy(rslt_buf, &out, size);
+            return false;
+        }
+
+        for(u32 i = 0; i < count; i++)
+        {
+            put(addrs[i], words[i]);
+        }
+
+        if(wait)
+        {
+            if(!poll(STATE_REG_0, SPU_READY_FLAG, state))
+            {
+                memcpy(rslt_buf, &out, size);
+                return false;
+            }
+            if(pair)
+            {
+                for(u32 i = 0; i < SPU_WEIGHT; i++)
+                {
+                    out.rslt_2.key.cont[i] = get(KEY_REG + i);
+                    out.rslt_2.val.cont[i] = get(VAL_REG + i);
+                }
+                out.rslt_2.power = get(POWER_REG);
+            }
+            else
+            {
+                out.rslt_1.power = get(POWER_REG);
+            }
+            out.rslt_0.rslt = state & ERRORS_MASK;
+        }
+        else
+        {
+            out.rslt_0.rslt = OK;
+        }
+        memcpy(rslt_buf, &out, size);
+        return true;
+    }
+
+    /* Batch of execute_batch: every slot gets result of its command */
+    size_t Mmio::batch(void *buf, size_t count)
+    {
+        if(count < sizeof(btch_cmd_t))
+        {
+            return 0;
+        }
+        batch_slot_t *slots = (batch_slot_t *) ((btch_cmd_t *) buf + 1);
+        u32 cmd_count = ((btch_cmd_t *) buf)->count;
+        if(cmd_count > SPU_BATCH_MAX || sizeof(btch_cmd_t) + cmd_count*sizeof(batch_slot_t) > count)
+        {
+            return 0;
+        }
+
+        for(u32 i = 0; i < cmd_count; i++)
+        {
+            command(&slots[i], &slots[i]);
+        }
+
+        btch_rslt_t *head = (btch_rslt_t *) buf;
+        head->rslt  = OK;
+        head->power = cmd_count;
+        return sizeof(btch_cmd_t) + cmd_count*sizeof(batch_slot_t);
+    }
+
+    /* LCM program of execute_program: instructions and jumps run without returns to caller */
+    size_t Mmio::program(void *buf, size_t count)
+    {
+        if(count < sizeof(prgm_cmd_t))
+        {
+            return 0;
+        }
+        prgm_cmd_t head = *(prgm_cmd_t *) buf;
+        lcm_str_t *strs    = (lcm_str_t *) ((prgm_cmd_t *) buf + 1);
+        lcm_instr_t *code  = (lcm_instr_t *) (strs + head.str_count);
+        rsltfrmt_2 *out    = (rsltfrmt_2 *) (code + head.count);
+        size_t prgm_size = sizeof(prgm_cmd_t) + head.str_count*sizeof(lcm_str_t) +
+                           head.count*sizeof(lcm_instr_t) + (size_t) head.out_max*sizeof(rsltfrmt_2);
+        if(head.count > LCM_SIZE || head.str_count > SPU_STR_NUM || prgm_size > count)
+        {
+            return 0;
+        }
+
+        key_t last_key = {0};
+        value_t last_val = {0};
+        rslt_t status = OK, last = OK;
+        u32 pc = 0, steps = 0, out_count = 0;
+        for(u32 i = 0; i < head.str_count; i++)
+        {
+            strs[i].deleted  = 0;
+            strs[i].squeezed = 0;
+        }
+
+        /* Steps are limited as by driver */
+        head.max_steps = std::min<u32>(head.max_steps, LCM_MAX_STEPS);
+        while(pc < head.count)
+        {
+            if(steps == head.max_steps)
+            {
+                status = ERR;
+                break;
+            }
+            steps++;
+            const lcm_instr_t &instr = code[pc];
+            cmd_t cmd = instr.cmd & CMD_MASK;
+
+            /* Jumps are resolved by last status */
+            if(cmd == JT)
+            {
+                bool jump = (instr.opt & LCM_IF_OK) ? last == OK : ((instr.opt & LCM_IF_ERR) ? last != OK : true);
+                pc = jump ? instr.target : pc + 1;
+                continue;
+            }
+
+            /* Command with key and value of instruction or last found pair, always polled */
+            bool set   = cmd == AND || cmd == OR || cmd == NOT;
+            bool slice = cmd == LS || cmd == LSEQ || cmd == GR || cmd == GREQ;
+            if(instr.str_a >= head.str_count || cmd == ADDS || cmd == DELS || cmd > NGR ||
+               (set && instr.str_b >= head.str_count) || ((set || slice) && instr.str_r >= head.str_count))
+            {
+                status = ERR;
+                break;
+            }
+            u32 str = (set || slice) ? instr.str_r : instr.str_a;
+            batch_slot_t slot;
+            const key_t &key   = (instr.opt & LCM_KEY_LAST) ? last_key : instr.key;
+            const value_t &val = (instr.opt & LCM_VAL_LAST) ? last_val : instr.val;
+            slot.frmt_4.cmd    = instr.cmd | P_FLAG;
+            switch(cmd)
+            {
+                case INS:
+                    slot.frmt_1.gsid = strs[instr.str_a].gsid;
+                    slot.frmt_1.key  = key;
+                    slot.frmt_1.val  = val;
+                    break;
+
+                case AND:
+                case OR:
+                case NOT:
+                    slot.frmt_4.gsid_a = strs[instr.str_a].gsid;
+                    slot.frmt_4.gsid_b = strs[instr.str_b].gsid;
+                    slot.frmt_4.gsid_r = strs[instr.str_r].gsid;
+                    break;
+
+                case LS:
+                case LSEQ:
+                case GR:
+                case GREQ:
+                    slot.frmt_5.gsid_a = strs[instr.str_a].gsid;
+                    slot.frmt_5.gsid_r = strs[instr.str_r].gsid;
+                    slot.frmt_5.key    = key;
+                    break;
+
+                case MIN:
+                case MAX:
+                case SQ:
+                    slot.frmt_3.gsid = strs[instr.str_a].gsid;
+                    break;
+
+                default:
+                    slot.frmt_2.gsid = strs[instr.str_a].gsid;
+                    slot.frmt_2.key  = key;
+                    break;
+            }
+
+            if(!command(&slot, &slot))
+            {
+                status = ERR;
+                break;
+            }
+            last = slot.rslt_0.rslt;
+
+            bool pair = cmd == SRCH || cmd == DEL || cmd == MIN || cmd == MAX ||
+                        cmd == NEXT || cmd == PREV || cmd == NSM || cmd == NGR;
+            strs[str].power = pair ? slot.rslt_2.power : slot.rslt_1.power;
+
+            if(last == OK)
+            {
+                if(cmd == DEL)
+                {
+                    strs[str].deleted++;
+                }
+                else if(cmd == SQ)
+                {
+                    strs[str].deleted  = 0;
+                    strs[str].squeezed = 1;
+                }
+                else if(pair)
+                {
+                    last_key = slot.rslt_2.key;
+                    last_val = slot.rslt_2.val;
+                    if(instr.opt & LCM_OUT)
+                    {
+                        if(out_count == head.out_max)
+                        {
+                            status = OERR;
+                            break;
+                        }
+                        out[out_count++] = slot.rslt_2;
+                    }
+                }
+            }
+            pc++;
+        }
+
+        prgm_rslt_t *ret = (prgm_rslt_t *) buf;
+        ret->rslt      = status;
+        ret->steps     = steps;
+        ret->out_count = out_count;
+        return prgm_size;
+    }
+
+    size_t Mmio::execute(void *buf, size_t count)
+    {
+        if(count < sizeof(cmd_t))
+        {
+            return 0;
+        }
+        switch(((adds_cmd_t *) buf)->cmd & CMD_MASK)
+        {
+            case BTCH:
+                return batch(buf, count);
+
+            case PRGM:
+                return program(buf, count);
+
+            default:
+                return command(buf, buf) ? count : 0;
+        }
+    }
+
+    void Mmio::execute(const void *cmd, void *rslt)
+    {
+        command(cmd, rslt);
+    }
+}
@@ -0,0 +1,162 @@
+/*
+  mmio.h
+        - userspace command executor declaration
+        - commands are encoded into SPU registers mapped into process, without driver calls and copies
+        - registers are accessed through swappable layer: BAR mapped by UIO, VFIO or sysfs, or emulated file
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MMIO_H
+#define MMIO_H
+
+#include "libspu.h"
+#include "transport.h"
+#include "errors/could_not_map_device.hpp"
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <sys/types.h>
+
+namespace SPU
+{
+
+/* Register map and driver version are the ones of the kernel driver */
+/* Driver headers use u8 and u32 of SPU namespace */
+#include "../spudrv/pcidrv.h"
+#include "../spudrv/info.h"
+
+/* Control 1 register: reset of SPU, queues, TSC and interrupts at once */
+#define MMIO_RESET_ALL    ( (1u << RESET_SPU_FLAG) | (1u << RESET_PCI_Q_FLAG) | (1u << RESET_SPU2CPU_Q_FLAG) | \
+                            (1u << RESET_TSC_FLAG) | (1u << RESET_SPU_IP_FLAG) | (1u << SPU2CPU_DRDY_INT_CLR) | \
+                            (1u << SYS2SPU_QOVF_INT_CLR) )
+
+/* Command register fields: command and numbers of structures A, B, R */
+#define MMIO_STR_BITS     STURCTURE_NUM
+#define MMIO_CMD(cmd)     ( (u32) (cmd) << 3*MMIO_STR_BITS )
+#define MMIO_STR_A(str)   ( (u32) (str) << 2*MMIO_STR_BITS )
+#define MMIO_STR_B(str)   ( (u32) (str) << 1*MMIO_STR_BITS )
+#define MMIO_STR_R(str)   ( (u32) (str) )
+#define MMIO_STR_MASK     ( (1u << MMIO_STR_BITS) - 1 )
+
+/* GSID word 0 of created structure: driver version in high half, PCI revision of SPU in low byte */
+#define GSID_DRIVER_SHIFT 16
+
+/* Polls of state register before SPU is considered hung; driver sleeps 1 ms between 255 polls */
+#define MMIO_POLL_ATTEMPTS (1u << 24)
+
+/***************************************
+  Registers class declaration
+***************************************/
+
+/* Register access layer of SPU, addresses are register numbers */
+class Registers
+{
+public:
+  virtual ~Registers() = default;
+
+  virtual void write(u32 reg, u32 data) = 0;
+  virtual u32 read(u32 reg) = 0;
+  /// регистры состояния читаются байтом, как в драйвере
+  virtual u8 status(u32 reg) { return (u8) read(reg); }
+  /// ревизия СП из конфигурации PCI: по ней GSID сообщает разрядность платы
+  virtual u8 revision() { return 0; }
+};
+
+
+/***************************************
+  MappedRegisters class declaration
+***************************************/
+
+/* BAR 0 of SPU mapped into process */
+class MappedRegisters : public Registers
+{
+private:
+  int fd = -1;                      // UIO, sysfs resource or VFIO device
+  int group = -1;                   // VFIO group
+  int container = -1;               // VFIO container
+  volatile u8 *base = nullptr;
+  size_t size = 0;
+  u8 rev = 0;
+
+  MappedRegisters() = default;
+  void map(off_t offset, size_t length);
+  void readRevision(const std::string &device);
+
+public:
+  MappedRegisters(const MappedRegisters &) = delete;
+  MappedRegisters& operator=(const MappedRegisters &) = delete;
+  ~MappedRegisters() override;
+
+  /// UIO-устройство (/dev/uioN) или файл ресурса (/sys/bus/pci/devices/<bdf>/resource0).
+  /// Ошибка открытия или отображения - исключение CouldNotMapDevice
+  static MappedRegisters *open(const char *path);
+  /// устройство, привязанное к vfio-pci: group - номер группы IOMMU, bdf - адрес PCI (0000:01:00.0)
+  static MappedRegisters *vfio(const char *group, const char *bdf);
+
+  void write(u32 reg, u32 data) override { *(volatile u32 *) (base + (reg << ADDR_SHIFT)) = data; }
+  u32 read(u32 reg) override { return *(volatile u32 *) (base + (reg << ADDR_SHIFT)); }
+  u8 status(u32 reg) override { return *(base + (reg << ADDR_SHIFT)); }
+  u8 revision() override { return rev; }
+};
+
+
+/***************************************
+  Mmio class declaration
+***************************************/
+
+/* Commands of driver executed by process over SPU registers */
+/* Executor owns all SPU structures: driver must not serve the board at the same time */
+class Mmio : public Transport
+{
+private:
+  Registers *regs;
+  gsid_t gsids[SPU_STR_NUM];        // GSIDs of SPU structures 1..SPU_STR_NUM, zero is free
+  std::mt19937 random;
+  unsigned long long writes = 0;    // Register accesses
+  unsigned long long reads  = 0;
+
+  bool create(gsid_t &gsid);
+  /// номер структуры СП по GSID (0 - нет); DELS освобождает номер
+  u32 resolve(const gsid_t &gsid, cmd_t cmd);
+  bool poll(u32 reg, u8 shift, u8 &state);
+  void put(u32 reg, u32 data) { regs->write(reg, data); writes++; }
+  u32 get(u32 reg)            { reads++; return regs->read(reg); }
+
+  /// выполняет команду форматов 0-5 и записывает в rslt результат её формата.
+  /// Команда читается до записи результата: rslt может совпадать с cmd
+  bool command(const void *cmd, void *rslt);
+  size_t batch(void *buf, size_t count);
+  size_t program(void *buf, size_t count);
+
+public:
+  explicit Mmio(Registers &registers);
+
+  /// сбрасывает СП и очереди и удаляет все структуры, как драйвер при загрузке.
+  /// false - DDR не прошла самотестирование
+  bool reset();
+
+  size_t execute(void *buf, size_t count) override;
+  void execute(const void *cmd, void *rslt) override;
+
+  unsigned long long register_writes() const { return writes; }
+  unsigned long long register_reads() const  { return reads; }
+};
+
+} /* namespace SPU */
+
+#endif /* MMIO_H */
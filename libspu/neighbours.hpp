@@ -0,0 +1,201 @@
+/*
+  neighbours.hpp
+        - nearest key lookup and linear interpolation over SPU structures
+        - both neighbours of a probe are got by NSM and NGR in one batch
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NEIGHBOURS_HPP
+#define NEIGHBOURS_HPP
+
+#include "libspu.h"
+#include "base_structure.h"
+#include "batch.h"
+#include "key_codec.hpp"
+
+#include <vector>
+
+namespace SPU
+{
+
+/* Neighbours of probe key: lower is the greatest key <= probe, upper is the least key >= probe */
+/* If probe is in structure both pairs are equal */
+struct neighbours_t
+{
+  pair_t lower;
+  pair_t upper;
+};
+using NeighboursVector = std::vector<neighbours_t>;
+
+
+/* Adds commands for both neighbours of probe into batch */
+/* NSM and NGR are strict, so they are issued for probe+1 and probe-1, MAX and MIN on key range edges */
+inline void pushNeighbours(Batch &batch, BaseStructure &structure, key_t probe)
+{
+  key_t above = probe;
+  key_t below = probe;
+  if(++above == key_t{0}) { batch.max(structure); } else { batch.nsm(structure, above); }
+  if(probe == key_t{0})   { batch.min(structure); } else { batch.ngr(structure, --below); }
+}
+
+/* Both neighbours of probe by one batch */
+inline neighbours_t neighbours(BaseStructure &structure, key_t probe)
+{
+  Batch batch;
+  pushNeighbours(batch, structure, probe);
+  BaseStructure::PairVector rslt = batch.execute();
+  return { rslt[0], rslt[1] };
+}
+
+/* Neighbours of all probes by one batch */
+inline NeighboursVector neighbours(BaseStructure &structure, const std::vector<key_t> &probes)
+{
+  Batch batch;
+  for(auto &ex : probes)
+  {
+    pushNeighbours(batch, structure, ex);
+  }
+  BaseStructure::PairVector rslt = batch.execute();
+
+  NeighboursVector ret;
+  ret.reserve(probes.size());
+  for(size_t i = 0; i < probes.size(); i++)
+  {
+    ret.push_back({ rslt[2*i], rslt[2*i + 1] });
+  }
+  return ret;
+}
+
+
+/* Decode value of SPU as numeric type */
+template <typename T>
+inline T decode(const data_t &data)
+{
+  BitFlow flow(data);
+  return flow;
+}
+
+/* Keys are packed by order-preserving KeyCodec: signed and floating point keys keep their order in SPU */
+template <typename T>
+inline T decodeKey(const key_t &key)
+{
+  return KeyCodec<T>::decode(key);
+}
+
+/* Encode numeric probe as SPU key */
+template <typename T>
+inline key_t encode(T probe)
+{
+  return KeyCodec<T>::encode(probe);
+}
+
+/* Encode numeric probes as SPU keys */
+template <typename T>
+std::vector<key_t> encode(const std::vector<T> &probes)
+{
+  std::vector<key_t> ret;
+  ret.reserve(probes.size());
+  for(auto &ex : probes)
+  {
+    ret.push_back(encode(ex));
+  }
+  return ret;
+}
+
+/* Closer of two neighbours to probe, lower one wins a tie */
+template <typename KeyT>
+pair_t closer(const neighbours_t &found, KeyT probe)
+{
+  if(found.lower.status != OK) { return found.upper; }
+  if(found.upper.status != OK) { return found.lower; }
+  KeyT lower = decodeKey<KeyT>(found.lower.key);
+  KeyT upper = decodeKey<KeyT>(found.upper.key);
+  return (probe - lower <= upper - probe) ? found.lower : found.upper;
+}
+
+/* Nearest key to probe; status is ERR only for empty structure */
+template <typename KeyT>
+pair_t nearest(BaseStructure &structure, KeyT probe)
+{
+  return closer(neighbours(structure, encode(probe)), probe);
+}
+
+/* Nearest keys to all probes by one batch */
+template <typename KeyT>
+BaseStructure::PairVector nearest(BaseStructure &structure, const std::vector<KeyT> &probes)
+{
+  NeighboursVector found = neighbours(structure, encode(probes));
+
+  BaseStructure::PairVector ret;
+  ret.reserve(probes.size());
+  for(size_t i = 0; i < probes.size(); i++)
+  {
+    ret.push_back(closer(found[i], probes[i]));
+  }
+  return ret;
+}
+
+
+/* Linear interpolation of neighbours' values; ERR when probe is out of keys range */
+template <typename KeyT, typename ValueT>
+status_t interpolate(const neighbours_t &found, KeyT probe, ValueT &result)
+{
+  if(found.lower.status != OK || found.upper.status != OK)
+  {
+    return ERR;
+  }
+
+  ValueT lower_val = decode<ValueT>(found.lower.value);
+  if(found.lower.key == found.upper.key)
+  {
+    result = lower_val;
+    return OK;
+  }
+
+  double x0 = decodeKey<KeyT>(found.lower.key);
+  double x1 = decodeKey<KeyT>(found.upper.key);
+  double y0 = lower_val;
+  double y1 = decode<ValueT>(found.upper.value);
+  result = (ValueT) ( y0 + (y1 - y0) * ((double) probe - x0) / (x1 - x0) );
+  return OK;
+}
+
+/* Interpolated value at probe by one batch */
+template <typename KeyT, typename ValueT>
+status_t interpolate(BaseStructure &structure, KeyT probe, ValueT &result)
+{
+  return interpolate(neighbours(structure, encode(probe)), probe, result);
+}
+
+/* Interpolated values at all probes by one batch; statuses are returned for every probe */
+template <typename KeyT, typename ValueT>
+std::vector<status_t> interpolate(BaseStructure &structure, const std::vector<KeyT> &probes, std::vector<ValueT> &results)
+{
+  NeighboursVector found = neighbours(structure, encode(probes));
+
+  std::vector<status_t> ret(probes.size());
+  results.resize(probes.size());
+  for(size_t i = 0; i < probes.size(); i++)
+  {
+    ret[i] = interpolate(found[i], probes[i], results[i]);
+  }
+  return ret;
+}
+
+} /* namespace SPU */
+
+#endif /* NEIGHBOURS_HPP */
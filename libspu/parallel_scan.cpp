@@ -0,0 +1,228 @@
+/*
+  parallel_scan.cpp
+        - parallel scan class implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "parallel_scan.h"
+
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace SPU
+{
+    /***************************************
+      ParallelScan class implementation
+    ***************************************/
+
+    ParallelScan::ParallelScan(BaseStructure &str, u32 parts, u32 batch) :
+            structure(&str), parts(parts), chunk(batch ? batch : 1)
+    {
+    }
+
+    BaseStructure::RangeVector ParallelScan::ranges(key_t from, key_t to)
+    {
+        u32 count = parts;
+        if(count == 0)
+        {
+            count = structure->concurrent() ? std::thread::hardware_concurrency() : PSCAN_SERIAL_PARTS;
+        }
+        return structure->split(from, to, count ? count : 1);
+    }
+
+    /* Range per thread, the first range is read by the calling thread */
+    void ParallelScan::threaded(const BaseStructure::RangeVector &ranges, const Consumer &consumer)
+    {
+        std::vector<std::exception_ptr> errors(ranges.size());
+        auto read = [this, &ranges, &consumer, &errors](u32 part)
+        {
+            try
+            {
+                key_t from = ranges[part].from;
+                while(true)
+                {
+                    BaseStructure::PairVector pairs = structure->scan(from, ranges[part].to, chunk);
+                    if(!pairs.empty())
+                    {
+                        consumer(part, pairs);
+                    }
+                    if(pairs.size() < chunk || pairs.back().key == ranges[part].to)
+                    {
+                        break;
+                    }
+                    from = pairs.back().key;
+                    ++from;
+                }
+            }
+            catch(...)
+            {
+                errors[part] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(u32 i = 1; i < ranges.size(); i++)
+        {
+            threads.emplace_back(read, i);
+        }
+        if(!ranges.empty())
+        {
+            read(0);
+        }
+        for(auto &ex : threads)
+        {
+            ex.join();
+        }
+        for(auto &ex : errors)
+        {
+            if(ex)
+            {
+                std::rethrow_exception(ex);
+            }
+        }
+    }
+
+    /* Rounds of one batch: SRCH and NGR find the first key of range, then NEXT per range */
+    void ParallelScan::batched(const BaseStructure::RangeVector &ranges, const Consumer &consumer)
+    {
+        struct State
+        {
+            key_t key;                      // Last key read
+            bool started;
+            bool done;
+            BaseStructure::PairVector buf;
+        };
+        std::vector<State> states(ranges.size(), State{ {0}, false, false, {} });
+
+        BaseStructure::BatchVector batch;
+        while(true)
+        {
+            batch.clear();
+            for(auto &ex : states)
+            {
+                if(ex.done)
+                {
+                    continue;
+                }
+                u32 part = &ex - states.data();
+                if(!ex.started)
+                {
+                    batch.push_back({ structure, (cmd_t) (SRCH | P_FLAG), ranges[part].from, {0} });
+                    batch.push_back({ structure, (cmd_t) (NGR | P_FLAG), ranges[part].from, {0} });
+                }
+                else
+                {
+                    batch.push_back({ structure, (cmd_t) (NEXT | P_FLAG), ex.key, {0} });
+                }
+            }
+            if(batch.empty())
+            {
+                return;
+            }
+
+            BaseStructure::PairVector results = structure->execute(batch);
+            size_t i = 0;
+            for(auto &ex : states)
+            {
+                if(ex.done)
+                {
+                    continue;
+                }
+                u32 part = &ex - states.data();
+                pair_t pair = results[i++];
+                if(!ex.started)
+                {
+                    ex.started = true;
+                    pair_t greater = results[i++];
+                    if(pair.status != OK)
+                    {
+                        pair = greater;
+                    }
+                }
+
+                if(pair.status == OK && pair.key <= ranges[part].to)
+                {
+                    ex.key = pair.key;
+                    ex.buf.push_back(pair);
+                    ex.done = pair.key == ranges[part].to;
+                }
+                else
+                {
+                    ex.done = true;
+                }
+
+                if(ex.buf.size() == chunk || (ex.done && !ex.buf.empty()))
+                {
+                    consumer(part, ex.buf);
+                    ex.buf.clear();
+                }
+            }
+        }
+    }
+
+    void ParallelScan::forEach(const BaseStructure::RangeVector &ranges, const Consumer &consumer)
+    {
+        if(structure->concurrent())
+        {
+            threaded(ranges, consumer);
+        }
+        else
+        {
+            batched(ranges, consumer);
+        }
+    }
+
+    void ParallelScan::forEach(key_t from, key_t to, const Consumer &consumer)
+    {
+        forEach(ranges(from, to), consumer);
+    }
+
+    /* Ordered output is concatenation of parts: ranges do not overlap and go by key */
+    BaseStructure::PairVector ParallelScan::scan(key_t from, key_t to, bool ordered)
+    {
+        BaseStructure::RangeVector parts = ranges(from, to);
+        BaseStructure::PairVector ret;
+        if(!ordered)
+        {
+            std::mutex lock;
+            forEach(parts, [&ret, &lock](u32, const BaseStructure::PairVector &pairs)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                ret.insert(ret.end(), pairs.begin(), pairs.end());
+            });
+            return ret;
+        }
+
+        std::vector<BaseStructure::PairVector> out(parts.size());
+        forEach(parts, [&out](u32 part, const BaseStructure::PairVector &pairs)
+        {
+            out[part].insert(out[part].end(), pairs.begin(), pairs.end());
+        });
+        size_t size = 0;
+        for(auto &ex : out)
+        {
+            size += ex.size();
+        }
+        ret.reserve(size);
+        for(auto &ex : out)
+        {
+            ret.insert(ret.end(), ex.begin(), ex.end());
+        }
+        return ret;
+    }
+}
@@ -0,0 +1,103 @@
+/*
+  parallel_scan.h
+        - parallel scan class declaration
+        - key range is split into parts with close numbers of keys
+        - parts are read by own threads or advanced together by batches of one command per part
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARALLEL_SCAN_H
+#define PARALLEL_SCAN_H
+
+#include "libspu.h"
+#include "base_structure.h"
+#include "cursor.h"
+
+#include <functional>
+#include <vector>
+
+namespace SPU
+{
+
+/* Parts of scan when structure reads are serialized: commands of one batch to SPU */
+#define PSCAN_SERIAL_PARTS 64
+
+/***************************************
+  ParallelScan class declaration
+***************************************/
+
+/* Scan of key range [from, to] split into parts */
+class ParallelScan
+{
+public:
+  /// part - номер диапазона, pairs - очередная порция его пар по возрастанию ключа
+  using Consumer = std::function<void(u32 part, const BaseStructure::PairVector &pairs)>;
+
+private:
+  BaseStructure *structure;
+  u32 parts;                        // Parts of range, 0 - by cores or PSCAN_SERIAL_PARTS
+  u32 chunk;                        // Pairs in one portion
+
+  /// каждый диапазон читается своим потоком
+  void threaded(const BaseStructure::RangeVector &ranges, const Consumer &consumer);
+  /// одно обращение к СП продвигает все диапазоны: в пакете по команде NEXT на диапазон
+  void batched(const BaseStructure::RangeVector &ranges, const Consumer &consumer);
+
+public:
+  explicit ParallelScan(BaseStructure &str, u32 parts = 0, u32 batch = SPU_BATCH_MAX);
+
+  /// делит [from, to] на диапазоны с близким числом ключей
+  BaseStructure::RangeVector ranges(key_t from, key_t to);
+
+  /// передает consumer пары диапазонов порциями, порции диапазона - по порядку.
+  /// Если структура допускает параллельное чтение, consumer вызывается из потоков диапазонов одновременно
+  void forEach(const BaseStructure::RangeVector &ranges, const Consumer &consumer);
+  void forEach(key_t from, key_t to, const Consumer &consumer);
+
+  /// пары [from, to]: ordered - по возрастанию ключа, иначе порции в порядке готовности
+  BaseStructure::PairVector scan(key_t from = {0}, key_t to = lastKey(), bool ordered = true);
+
+  /// свертка пар [from, to]: fold(acc, pair) внутри диапазона, combine(init, acc) по порядку диапазонов.
+  /// init - нейтральный элемент: с него начинаются аккумуляторы диапазонов и итог
+  template <class T, class Fold, class Combine>
+  T aggregate(key_t from, key_t to, T init, Fold fold, Combine combine);
+};
+
+
+/***************************************
+  ParallelScan template implementation
+***************************************/
+
+template <class T, class Fold, class Combine>
+T ParallelScan::aggregate(key_t from, key_t to, T init, Fold fold, Combine combine)
+{
+  BaseStructure::RangeVector parts = ranges(from, to);
+  std::vector<T> acc(parts.size(), init);
+  forEach(parts, [&acc, &fold](u32 part, const BaseStructure::PairVector &pairs) {
+    for (auto &ex : pairs) {
+      fold(acc[part], ex);
+    }
+  });
+  for (auto &ex : acc) {
+    combine(init, ex);
+  }
+  return init;
+}
+
+} /* namespace SPU */
+
+#endif /* PARALLEL_SCAN_H */
@@ -0,0 +1,165 @@
+/*
+  program.cpp
+        - program class implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "program.h"
+
+namespace SPU
+{
+    /***************************************
+      Program class implementation
+    ***************************************/
+
+    size_t Program::push(BaseStructure *structure, cmd_t cmd, u8 opt, key_t key, value_t value,
+                         BaseStructure *b, BaseStructure *result)
+    {
+        code.push_back({ structure, b, result, cmd, opt, 0, key, value });
+        return code.size() - 1;
+    }
+
+    size_t Program::insert(BaseStructure &structure, key_t key, value_t value, u8 opt)
+    {
+        return push(&structure, INS, opt, key, value);
+    }
+
+    size_t Program::del(BaseStructure &structure, key_t key, u8 opt)
+    {
+        return push(&structure, DEL, opt, key);
+    }
+
+    size_t Program::search(BaseStructure &structure, key_t key, u8 opt)
+    {
+        return push(&structure, SRCH, opt, key);
+    }
+
+    size_t Program::min(BaseStructure &structure, u8 opt)
+    {
+        return push(&structure, MIN, opt);
+    }
+
+    size_t Program::max(BaseStructure &structure, u8 opt)
+    {
+        return push(&structure, MAX, opt);
+    }
+
+    size_t Program::next(BaseStructure &structure, key_t key, u8 opt)
+    {
+        return push(&structure, NEXT, opt, key);
+    }
+
+    size_t Program::prev(BaseStructure &structure, key_t key, u8 opt)
+    {
+        return push(&structure, PREV, opt, key);
+    }
+
+    size_t Program::nsm(BaseStructure &structure, key_t key, u8 opt)
+    {
+        return push(&structure, NSM, opt, key);
+    }
+
+    size_t Program::ngr(BaseStructure &structure, key_t key, u8 opt)
+    {
+        return push(&structure, NGR, opt, key);
+    }
+
+    size_t Program::squeeze(BaseStructure &structure)
+    {
+        return push(&structure, SQ, LCM_NONE);
+    }
+
+    size_t Program::intersect(BaseStructure &a, BaseStructure &b, BaseStructure &result)
+    {
+        return push(&a, AND, LCM_NONE, {0}, {0}, &b, &result);
+    }
+
+    size_t Program::unite(BaseStructure &a, BaseStructure &b, BaseStructure &result)
+    {
+        return push(&a, OR, LCM_NONE, {0}, {0}, &b, &result);
+    }
+
+    size_t Program::subtract(BaseStructure &a, BaseStructure &b, BaseStructure &result)
+    {
+        return push(&a, NOT, LCM_NONE, {0}, {0}, &b, &result);
+    }
+
+    size_t Program::ls(BaseStructure &a, key_t key, BaseStructure &result, u8 opt)
+    {
+        return push(&a, LS, opt, key, {0}, nullptr, &result);
+    }
+
+    size_t Program::lseq(BaseStructure &a, key_t key, BaseStructure &result, u8 opt)
+    {
+        return push(&a, LSEQ, opt, key, {0}, nullptr, &result);
+    }
+
+    size_t Program::gr(BaseStructure &a, key_t key, BaseStructure &result, u8 opt)
+    {
+        return push(&a, GR, opt, key, {0}, nullptr, &result);
+    }
+
+    size_t Program::greq(BaseStructure &a, key_t key, BaseStructure &result, u8 opt)
+    {
+        return push(&a, GREQ, opt, key, {0}, nullptr, &result);
+    }
+
+    void Program::label(const std::string &name)
+    {
+        labels[name] = code.size();
+    }
+
+    size_t Program::jump(const std::string &name, u8 cond)
+    {
+        size_t ret = push(nullptr, JT, cond);
+        jumps.emplace_back(ret, name);
+        return ret;
+    }
+
+    size_t Program::halt()
+    {
+        size_t ret = push(nullptr, JT, LCM_NONE);
+        code[ret].target = LCM_HALT;
+        return ret;
+    }
+
+    void Program::clear()
+    {
+        code.clear();
+        labels.clear();
+        jumps.clear();
+    }
+
+    /* Labels are resolved at run, so jumps may go forward */
+    BaseStructure::ProgramResult Program::run(u32 out_max, u32 max_steps)
+    {
+        for (auto &ex : jumps) {
+            auto it = labels.find(ex.second);
+            if (it == labels.end()) {
+                throw UndefinedLabel();
+            }
+            code[ex.first].target = it->second;
+        }
+
+        for (auto &ex : code) {
+            if (ex.structure != nullptr) {
+                return ex.structure->run(code, out_max, max_steps);
+            }
+        }
+        return { OK, 0, BaseStructure::PairVector() };
+    }
+}
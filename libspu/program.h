@@ -0,0 +1,98 @@
+/*
+  program.h
+        - program class declaration
+        - program is assembled from SPU commands and jumps and executed by LCM in MISD mode
+        - loops like "drain queue by MIN and DEL" run without host round trip per step
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include "libspu.h"
+#include "base_structure.h"
+#include "errors/undefined_label.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace SPU
+{
+
+/* Default limit of executed instructions and jumps */
+#define PROGRAM_MAX_STEPS 1000000
+
+/***************************************
+  Program class declaration
+***************************************/
+
+/* LCM program of SPU commands for any structures */
+class Program
+{
+private:
+  BaseStructure::ProgramVector code;
+  std::map<std::string, u32> labels;
+  std::vector<std::pair<size_t, std::string>> jumps;  // Jump instructions with label targets
+
+  size_t push(BaseStructure *structure, cmd_t cmd, u8 opt, key_t key = {0}, value_t value = {0},
+              BaseStructure *b = nullptr, BaseStructure *result = nullptr);
+
+public:
+  Program() = default;
+
+  /// Каждый метод добавляет инструкцию в программу и возвращает её индекс.
+  /// Опции opt: LCM_KEY_LAST и LCM_VAL_LAST берут ключ и значение из последней найденной пары,
+  /// LCM_OUT записывает найденную пару в выход программы
+  size_t insert(BaseStructure &structure, key_t key, value_t value, u8 opt = LCM_NONE);
+  size_t del   (BaseStructure &structure, key_t key = {0}, u8 opt = LCM_NONE);
+  size_t search(BaseStructure &structure, key_t key, u8 opt = LCM_NONE);
+  size_t min   (BaseStructure &structure, u8 opt = LCM_NONE);
+  size_t max   (BaseStructure &structure, u8 opt = LCM_NONE);
+  size_t next  (BaseStructure &structure, key_t key = {0}, u8 opt = LCM_NONE);
+  size_t prev  (BaseStructure &structure, key_t key = {0}, u8 opt = LCM_NONE);
+  size_t nsm   (BaseStructure &structure, key_t key = {0}, u8 opt = LCM_NONE);
+  size_t ngr   (BaseStructure &structure, key_t key = {0}, u8 opt = LCM_NONE);
+  size_t squeeze(BaseStructure &structure);
+
+  size_t intersect(BaseStructure &a, BaseStructure &b, BaseStructure &result);
+  size_t unite    (BaseStructure &a, BaseStructure &b, BaseStructure &result);
+  size_t subtract (BaseStructure &a, BaseStructure &b, BaseStructure &result);
+  size_t ls  (BaseStructure &a, key_t key, BaseStructure &result, u8 opt = LCM_NONE);
+  size_t lseq(BaseStructure &a, key_t key, BaseStructure &result, u8 opt = LCM_NONE);
+  size_t gr  (BaseStructure &a, key_t key, BaseStructure &result, u8 opt = LCM_NONE);
+  size_t greq(BaseStructure &a, key_t key, BaseStructure &result, u8 opt = LCM_NONE);
+
+  /// ставит метку на следующую инструкцию
+  void label(const std::string &name);
+  /// переход JT к метке: безусловный или по статусу последней команды (LCM_IF_OK, LCM_IF_ERR)
+  size_t jump(const std::string &name, u8 cond = LCM_NONE);
+  /// останавливает программу
+  size_t halt();
+
+  size_t size() const { return code.size(); }
+  bool empty() const  { return code.empty(); }
+  void clear();
+
+  /// выполняет программу; структура первой команды выбирает способ выполнения (СП или симулятор).
+  /// Программа остается собранной и может выполняться повторно
+  BaseStructure::ProgramResult run(u32 out_max = SPU_BATCH_MAX, u32 max_steps = PROGRAM_MAX_STEPS);
+};
+
+} /* namespace SPU */
+
+#endif /* PROGRAM_H */
@@ -0,0 +1,247 @@
+/*
+  remote.cpp
+        - remote SPU client transport implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "remote.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace SPU
+{
+    /***************************************
+      Remote class implementation
+    ***************************************/
+
+    Remote::Remote(int sock) : sock(sock)
+    {
+    }
+
+    Remote::~Remote()
+    {
+        flush();
+        close(sock);
+    }
+
+    Remote *Remote::connected(int sock)
+    {
+        Remote *remote = new Remote(sock);
+        if(!remote->handshake())
+        {
+            delete remote;
+            throw CouldNotConnect();
+        }
+        return remote;
+    }
+
+    Remote *Remote::tcp(const char *host, u32 port)
+    {
+        struct addrinfo hints = {}, *addrs = nullptr;
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if(getaddrinfo(host, std::to_string(port).c_str(), &hints, &addrs) != 0)
+        {
+            throw CouldNotConnect();
+        }
+
+        int sock = -1;
+        for(struct addrinfo *ex = addrs; ex && sock < 0; ex = ex->ai_next)
+        {
+            sock = socket(ex->ai_family, ex->ai_socktype, ex->ai_protocol);
+            if(sock >= 0 && connect(sock, ex->ai_addr, ex->ai_addrlen) != 0)
+            {
+                close(sock);
+                sock = -1;
+            }
+        }
+        freeaddrinfo(addrs);
+        if(sock < 0)
+        {
+            throw CouldNotConnect();
+        }
+
+        /* Frames are coalesced by client, Nagle's delay would only hold requests */
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return connected(sock);
+    }
+
+    Remote *Remote::local(const char *path)
+    {
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if(strlen(path) >= sizeof(addr.sun_path))
+        {
+            throw CouldNotConnect();
+        }
+        strcpy(addr.sun_path, path);
+
+        int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(sock < 0 || connect(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+        {
+            if(sock >= 0)
+            {
+                close(sock);
+            }
+            throw CouldNotConnect();
+        }
+        return connected(sock);
+    }
+
+    void Remote::queue(const void *buf, size_t size, u32 flags)
+    {
+        remote_request head = { size, flags };
+        const u8 *bytes = (const u8 *) &head;
+        pending.insert(pending.end(), bytes, bytes + sizeof(head));
+        pending.insert(pending.end(), (const u8 *) buf, (const u8 *) buf + size);
+        frames++;
+    }
+
+    /* All queued frames go by one system call when socket buffer takes them */
+    bool Remote::send()
+    {
+        size_t done = 0;
+        while(done < pending.size())
+        {
+            ssize_t ret = ::send(sock, pending.data() + done, pending.size() - done, MSG_NOSIGNAL);
+            if(ret <= 0)
+            {
+                pending.clear();
+                return false;
+            }
+            done += ret;
+        }
+        pending.clear();
+        return true;
+    }
+
+    bool Remote::receive(void *buf, size_t size)
+    {
+        size_t done = 0;
+        while(done < size)
+        {
+            ssize_t ret = recv(sock, (u8 *) buf + done, size - done, 0);
+            if(ret <= 0)
+            {
+                return false;
+            }
+            done += ret;
+        }
+        return true;
+    }
+
+    bool Remote::skip(size_t size)
+    {
+        u8 rest[4096];
+        while(size)
+        {
+            size_t part = std::min<size_t>(size, sizeof(rest));
+            if(!receive(rest, part))
+            {
+                return false;
+            }
+            size -= part;
+        }
+        return true;
+    }
+
+    bool Remote::handshake()
+    {
+        remote_hello hello = remoteHello();
+        if(::send(sock, &hello, sizeof(hello), MSG_NOSIGNAL) != sizeof(hello) || !receive(&hello, sizeof(hello)))
+        {
+            return false;
+        }
+        return remoteAgree(hello);
+    }
+
+    bool Remote::request(const void *buf, size_t size, remote_reply &reply)
+    {
+        queue(buf, size, 0);
+        trips++;
+        return send() && receive(&reply, sizeof(reply));
+    }
+
+    void Remote::flush()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        send();
+    }
+
+    size_t Remote::execute(void *buf, size_t count)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        remote_reply reply;
+        if(!request(buf, count, reply))
+        {
+            return 0;
+        }
+        /* Result longer than buffer is read out: next reply starts at its frame */
+        if(reply.size > count)
+        {
+            skip(reply.size);
+            return 0;
+        }
+        return receive(buf, reply.size) ? reply.count : 0;
+    }
+
+    void Remote::execute(const void *cmd, void *rslt)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        cmd_t code  = *(const cmd_t *) cmd;
+        size_t size = commandSize(code);
+        size_t max  = resultSize(code);
+        rslt_t status = ERR;
+
+        if(size && !(code & P_FLAG) && (code & CMD_MASK) != ADDS)
+        {
+            queue(cmd, size, REMOTE_NO_REPLY);
+            status = OK;
+            if(pending.size() >= REMOTE_PIPELINE_MAX && !send())
+            {
+                status = ERR;
+            }
+            memcpy(rslt, &status, sizeof(status));
+            return;
+        }
+
+        /* Command is copied into frame before result is written: rslt may be the same buffer */
+        remote_reply reply;
+        if(size && request(cmd, size, reply))
+        {
+            if(reply.size <= max && receive(rslt, reply.size))
+            {
+                return;
+            }
+            if(reply.size > max)
+            {
+                skip(reply.size);
+            }
+        }
+        memcpy(rslt, &status, sizeof(status));
+    }
+}
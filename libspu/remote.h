@@ -0,0 +1,138 @@
+/*
+  remote.h
+        - remote SPU protocol and client transport declaration
+        - frames carry command and result formats of driver as they are written to device file
+        - commands without P flag are pipelined: they get no reply and are sent together with next request
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REMOTE_H
+#define REMOTE_H
+
+#include "transport.h"
+#include "errors/could_not_connect.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace SPU
+{
+
+/* Default TCP port of SPU server */
+#define REMOTE_PORT 7407
+
+/* Protocol version, hello frames of client and server must agree */
+#define REMOTE_MAGIC   0x55505352   /* "RSPU" */
+#define REMOTE_VERSION 1
+
+/* Request flags */
+#define REMOTE_NO_REPLY 0x01        /* Server sends no reply: command was sent without P flag */
+
+/* Largest frame, greater frame closes connection */
+#define REMOTE_FRAME_MAX (64u << 20)
+
+/* Bytes of pipelined commands which are sent without waiting for a request with reply */
+#define REMOTE_PIPELINE_MAX 65536
+
+/* Frames are little endian hosts' layout of formats: x86 clients and Baikal-T1 server agree on it */
+
+/* Hello frame: first frame of both sides, server closes connection when it does not agree */
+struct remote_hello
+{
+  u32 magic;
+  u32 version;
+  u32 weight;   // SPU_WEIGHT: width of keys and values in formats
+};
+
+/* Hello of this build */
+inline remote_hello remoteHello()
+{
+  return { REMOTE_MAGIC, REMOTE_VERSION, SPU_WEIGHT };
+}
+
+inline bool remoteAgree(const remote_hello &hello)
+{
+  return hello.magic == REMOTE_MAGIC && hello.version == REMOTE_VERSION && hello.weight == SPU_WEIGHT;
+}
+
+/* Request frame header, command buffer of `size` bytes follows */
+struct remote_request
+{
+  u32 size;
+  u32 flags;
+};
+
+/* Reply frame header, result buffer of `size` bytes follows */
+struct remote_reply
+{
+  u32 size;
+  u32 count;    // Bytes processed by executor as write to device file returns, 0 on error
+};
+
+
+/***************************************
+  Remote class declaration
+***************************************/
+
+/* Transport to SPU server over TCP or Unix socket */
+class Remote : public Transport
+{
+private:
+  int sock;
+  std::vector<u8> pending;          // Frames which are not sent yet
+  std::mutex lock;
+  unsigned long long trips = 0;     // Requests waited for reply
+  unsigned long long frames = 0;
+
+  explicit Remote(int sock);
+  /// клиент соединения после обмена приветствиями; ошибка - исключение CouldNotConnect
+  static Remote *connected(int sock);
+
+  void queue(const void *buf, size_t size, u32 flags);
+  bool send();
+  bool receive(void *buf, size_t size);
+  /// читает и отбрасывает size байт ответа, не поместившихся в буфер
+  bool skip(size_t size);
+  /// обмен кадрами remote_hello; false - сервер другой версии или ширины SPU_WEIGHT
+  bool handshake();
+  /// отправляет очередь вместе с запросом и ждет ответ; false - соединение потеряно
+  bool request(const void *buf, size_t size, remote_reply &reply);
+
+public:
+  Remote(const Remote &) = delete;
+  Remote& operator=(const Remote &) = delete;
+  ~Remote() override;
+
+  /// соединение с сервером по TCP. Ошибка или несовпадение версии и SPU_WEIGHT - исключение CouldNotConnect
+  static Remote *tcp(const char *host, u32 port = REMOTE_PORT);
+  /// соединение с сервером на том же хосте через сокет Unix
+  static Remote *local(const char *path);
+
+  size_t execute(void *buf, size_t count) override;
+  /// команда без флага P ставится в очередь и сразу получает OK, как в драйвере без опроса
+  void execute(const void *cmd, void *rslt) override;
+
+  /// отправляет команды, накопленные без ответа
+  void flush();
+
+  unsigned long long round_trips() const { return trips; }
+  unsigned long long sent_frames() const { return frames; }
+};
+
+} /* namespace SPU */
+
+#endif /* REMOTE_H */
@@ -0,0 +1,102 @@
+/*
+  schema.cpp
+        - text dump and load of data by schema descriptors
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "schema.h"
+#include "fields_view.hpp"
+#include "errors/did_not_found_by_name.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace SPU
+{
+    /* Sign bit of field */
+    static unsigned long long signBit(u32 width)
+    {
+        return 1ULL << (width - 1);
+    }
+
+    std::string dump(const schema_layout_t &layout, const data_t &data)
+    {
+        std::string ret;
+        for (u32 i = 0; i < layout.count; i++) {
+            const schema_field_t &field = layout.fields[i];
+            unsigned long long raw = extract(data, { field.offset, field.width });
+            char buf[32];
+
+            switch (field.codec) {
+                case SCHEMA_INT:
+                    std::snprintf(buf, sizeof buf, "%lld", (long long) raw - (long long) signBit(field.width));
+                    break;
+                case SCHEMA_BOOL:
+                    std::snprintf(buf, sizeof buf, "%s", raw ? "true" : "false");
+                    break;
+                case SCHEMA_BITSET:
+                    std::snprintf(buf, sizeof buf, "0x%llx", raw);
+                    break;
+                default:
+                    std::snprintf(buf, sizeof buf, "%llu", raw);
+            }
+
+            if (i) {
+                ret += " ";
+            }
+            ret += std::string(field.name) + "=" + buf;
+        }
+        return ret;
+    }
+
+    data_t load(const schema_layout_t &layout, const std::string &text)
+    {
+        data_t ret = {0};
+        std::istringstream stream(text);
+        std::string token;
+        while (stream >> token) {
+            size_t eq = token.find('=');
+            std::string name  = token.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : token.substr(eq + 1);
+
+            const schema_field_t *field = nullptr;
+            for (u32 i = 0; i < layout.count; i++) {
+                if (name == layout.fields[i].name) {
+                    field = &layout.fields[i];
+                }
+            }
+            if (field == nullptr) {
+                throw DidNotFoundDataByName<std::string>(layout.name, name);
+            }
+
+            unsigned long long raw;
+            switch (field->codec) {
+                case SCHEMA_INT:
+                    raw = (unsigned long long) std::strtoll(value.c_str(), nullptr, 0) ^ signBit(field->width);
+                    break;
+                case SCHEMA_BOOL:
+                    raw = value == "true" || value == "1";
+                    break;
+                default:
+                    raw = std::strtoull(value.c_str(), nullptr, 0);
+            }
+            deposit(ret, { field->offset, field->width }, raw);
+        }
+        return ret;
+    }
+}
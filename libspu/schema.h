@@ -0,0 +1,115 @@
+/*
+  schema.h
+        - runtime part of layouts generated from schema files by tools/schema_gen
+        - schema descriptors with text dump and load of packed data
+        - SchemaStructure wrapper of SPU structure with generated key and value layouts
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include "libspu.h"
+#include "base_structure.h"
+#include "backend.hpp"
+#include "bitset.hpp"
+
+#include <string>
+
+namespace SPU
+{
+
+/* Codecs of schema fields */
+enum schema_codec
+{
+  SCHEMA_UINT   = 0x00, // Unsigned integer
+  SCHEMA_INT    = 0x01, // Signed integer stored with inverted sign bit to keep order
+  SCHEMA_BOOL   = 0x02, // Boolean
+  SCHEMA_BITSET = 0x03  // Bitmask
+}; /* enum schema_codec */
+
+/* Descriptor of leaf field; nested fields are flattened with dotted names and absolute offsets */
+struct schema_field_t
+{
+  const char *name;
+  u32 offset;
+  u32 width;
+  u8  codec;
+};
+
+/* Descriptor of layout */
+struct schema_layout_t
+{
+  const char *name;
+  u32 width;
+  const schema_field_t *fields;
+  u32 count;
+};
+
+/* Packed data as text "name=value ..." */
+std::string dump(const schema_layout_t &layout, const data_t &data);
+/* Packed data from text "name=value ..."; fields not in text are zero */
+data_t load(const schema_layout_t &layout, const std::string &text);
+
+
+/***************************************
+  SchemaStructure template class declaration
+***************************************/
+
+/* SPU structure with keys and values of generated layouts */
+template <class KeyL, class ValueL>
+class SchemaStructure
+{
+public:
+  struct Record
+  {
+    KeyL     key;
+    ValueL   value;
+    status_t status;
+  };
+
+private:
+  DynamicBackend base;
+
+  static Record record(const pair_t &pair)
+  {
+    return { KeyL::unpack(pair.key), ValueL::unpack(pair.value), pair.status };
+  }
+
+public:
+  explicit SchemaStructure(BaseStructure *structure = nullptr) : base(structure) {}
+  SchemaStructure(const SchemaStructure &) = delete;
+
+  BaseStructure &structure() { return *base; }
+  u32 get_power()            { return base->get_power(); }
+
+  status_t insert(const KeyL &key, const ValueL &value, flags_t flags = NO_FLAGS) { return base->insert(KeyL::pack(key), ValueL::pack(value), flags); }
+  status_t insert(const Record &rec, flags_t flags = NO_FLAGS)                    { return insert(rec.key, rec.value, flags); }
+  status_t del(const KeyL &key, flags_t flags = NO_FLAGS)                         { return base->del(KeyL::pack(key), flags); }
+
+  Record search(const KeyL &key, flags_t flags = P_FLAG) { return record(base->search(KeyL::pack(key), flags)); }
+  Record min(flags_t flags = P_FLAG)                     { return record(base->min(flags)); }
+  Record max(flags_t flags = P_FLAG)                     { return record(base->max(flags)); }
+  Record next(const KeyL &key, flags_t flags = P_FLAG)   { return record(base->next(KeyL::pack(key), flags)); }
+  Record prev(const KeyL &key, flags_t flags = P_FLAG)   { return record(base->prev(KeyL::pack(key), flags)); }
+  Record nsm(const KeyL &key, flags_t flags = P_FLAG)    { return record(base->nsm(KeyL::pack(key), flags)); }
+  Record ngr(const KeyL &key, flags_t flags = P_FLAG)    { return record(base->ngr(KeyL::pack(key), flags)); }
+};
+
+} /* namespace SPU */
+
+#endif /* SCHEMA_H */
@@ -0,0 +1,382 @@
+/*
+  server.cpp
+        - SPU server implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server.h"
+#include "data_container_operators.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <thread>
+
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace SPU
+{
+  namespace
+  {
+    /* Reads of connection by large portions: pipelined frames take no system call each */
+    class Reader
+    {
+    private:
+        int sock;
+        std::vector<u8> in;
+        size_t begin = 0, end = 0;
+
+    public:
+        explicit Reader(int sock) : sock(sock), in(REMOTE_PIPELINE_MAX) {}
+
+        /* Whole buffer, false when connection is closed */
+        bool read(void *buf, size_t size)
+        {
+            u8 *out = (u8 *) buf;
+            while(size)
+            {
+                if(begin == end)
+                {
+                    ssize_t ret = recv(sock, in.data(), in.size(), 0);
+                    if(ret <= 0)
+                    {
+                        return false;
+                    }
+                    begin = 0;
+                    end   = ret;
+                }
+                size_t part = std::min(size, end - begin);
+                memcpy(out, in.data() + begin, part);
+                begin += part;
+                out   += part;
+                size  -= part;
+            }
+            return true;
+        }
+    };
+
+    /* Structures of connection: ones it has created and not deleted are deleted when it is closed */
+    class Ownership
+    {
+    private:
+        std::set<gsid_t> gsids;
+        std::vector<size_t> adds;       // Offsets of ADDS in frame being executed
+
+        /* Calls visit(offset, cmd) for single command or each slot of BTCH, PRGM has no ADDS and DELS */
+        template <typename Visit>
+        static void slots(const u8 *buf, size_t size, Visit visit)
+        {
+            cmd_t cmd = buf[0];
+            if((cmd & CMD_MASK) != BTCH)
+            {
+                if(commandSize(cmd) == size)
+                {
+                    visit(0, cmd);
+                }
+                return;
+            }
+            if(size < sizeof(btch_cmd_t))
+            {
+                return;
+            }
+            u32 count = ((const btch_cmd_t *) buf)->count;
+            for(u32 i = 0; i < count && sizeof(btch_cmd_t) + (i + 1)*sizeof(batch_slot_t) <= size; i++)
+            {
+                size_t offset = sizeof(btch_cmd_t) + i*sizeof(batch_slot_t);
+                visit(offset, buf[offset]);
+            }
+        }
+
+    public:
+        /* Results overwrite commands: DELS are taken and ADDS are noted before execution */
+        void before(const u8 *buf, size_t size)
+        {
+            adds.clear();
+            slots(buf, size, [&](size_t offset, cmd_t cmd) {
+                switch(cmd & CMD_MASK)
+                {
+                    case ADDS: adds.push_back(offset); break;
+                    case DELS: gsids.erase(((const dels_cmd_t *) (buf + offset))->gsid); break;
+                }
+            });
+        }
+
+        void after(const u8 *buf)
+        {
+            for(auto &ex : adds)
+            {
+                const adds_rslt_t *rslt = (const adds_rslt_t *) (buf + ex);
+                if(rslt->rslt == OK)
+                {
+                    gsids.insert(rslt->gsid);
+                }
+            }
+        }
+
+        const std::set<gsid_t> &owned() const { return gsids; }
+    };
+  }
+
+    static bool writeAll(int sock, const void *buf, size_t size)
+    {
+        size_t done = 0;
+        while(done < size)
+        {
+            ssize_t ret = send(sock, (const u8 *) buf + done, size - done, MSG_NOSIGNAL);
+            if(ret <= 0)
+            {
+                return false;
+            }
+            done += ret;
+        }
+        return true;
+    }
+
+
+    /***************************************
+      Server class implementation
+    ***************************************/
+
+    Server::Server(Transport *transport) :
+            transport(transport), device("/dev/" SPU_CDEV_NAME), stopped(false), served(0)
+    {
+        if(pipe(wake) != 0)
+        {
+            wake[0] = wake[1] = -1;
+        }
+    }
+
+    Server::~Server()
+    {
+        stop();
+        for(auto &ex : listeners)
+        {
+            close(ex);
+        }
+        if(!path.empty())
+        {
+            unlink(path.c_str());
+        }
+        for(auto &ex : wake)
+        {
+            if(ex >= 0)
+            {
+                close(ex);
+            }
+        }
+    }
+
+    bool Server::listenTcp(u32 port, const char *host)
+    {
+        struct addrinfo hints = {}, *addrs = nullptr;
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags    = AI_PASSIVE;
+        if(getaddrinfo(host, std::to_string(port).c_str(), &hints, &addrs) != 0)
+        {
+            return false;
+        }
+
+        bool ret = false;
+        for(struct addrinfo *ex = addrs; ex && !ret; ex = ex->ai_next)
+        {
+            int sock = socket(ex->ai_family, ex->ai_socktype, ex->ai_protocol);
+            int one  = 1;
+            if(sock < 0)
+            {
+                continue;
+            }
+            setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if(bind(sock, ex->ai_addr, ex->ai_addrlen) != 0 || listen(sock, SOMAXCONN) != 0)
+            {
+                close(sock);
+                continue;
+            }
+            listeners.push_back(sock);
+            ret = true;
+        }
+        freeaddrinfo(addrs);
+        return ret;
+    }
+
+    bool Server::listenLocal(const char *name)
+    {
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if(strlen(name) >= sizeof(addr.sun_path))
+        {
+            return false;
+        }
+        strcpy(addr.sun_path, name);
+        unlink(name);
+
+        int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(sock < 0)
+        {
+            return false;
+        }
+        if(bind(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(sock, SOMAXCONN) != 0)
+        {
+            close(sock);
+            return false;
+        }
+        listeners.push_back(sock);
+        path = name;
+        return true;
+    }
+
+    void Server::run()
+    {
+        std::vector<struct pollfd> fds;
+        for(auto &ex : listeners)
+        {
+            fds.push_back({ ex, POLLIN, 0 });
+        }
+        fds.push_back({ wake[0], POLLIN, 0 });
+
+        while(!stopped)
+        {
+            if(poll(fds.data(), fds.size(), -1) < 0)
+            {
+                continue;
+            }
+            for(size_t i = 0; i + 1 < fds.size(); i++)
+            {
+                if(!(fds[i].revents & POLLIN))
+                {
+                    continue;
+                }
+                int client = accept(fds[i].fd, nullptr, nullptr);
+                if(client < 0)
+                {
+                    continue;
+                }
+                int one = 1;
+                setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+                std::lock_guard<std::mutex> guard(lock);
+                clients.insert(client);
+                std::thread(&Server::serve, this, client).detach();
+            }
+        }
+
+        /* Connections are closed after accept loop: their threads finish on shutdown */
+        std::unique_lock<std::mutex> guard(lock);
+        for(auto &ex : clients)
+        {
+            shutdown(ex, SHUT_RDWR);
+        }
+        done.wait(guard, [this] { return clients.empty(); });
+    }
+
+    void Server::stop()
+    {
+        if(!stopped.exchange(true) && wake[1] >= 0)
+        {
+            char byte = 0;
+            ssize_t ret = write(wake[1], &byte, 1);
+            (void) ret;
+        }
+    }
+
+    /* Single command gets result of its format in place, BTCH and PRGM buffers are returned whole */
+    size_t Server::execute(u8 *buf, size_t size, u32 &count)
+    {
+        cmd_t cmd = buf[0];
+        std::lock_guard<std::mutex> guard(spu);
+        switch(cmd & CMD_MASK)
+        {
+            case BTCH:
+            case PRGM:
+                count = transport ? transport->execute(buf, size) : device.execute(buf, size);
+                return size;
+        }
+
+        if(commandSize(cmd) != size)
+        {
+            count  = 0;
+            buf[0] = ERR;
+            return sizeof(rslt_t);
+        }
+        if(transport)
+        {
+            transport->execute(buf, buf);
+            count = size;
+        }
+        else
+        {
+            count = device.execute(buf, size);
+        }
+        return resultSize(cmd);
+    }
+
+    /* Reply header and result go by one system call */
+    void Server::serve(int client)
+    {
+        Reader reader(client);
+        Ownership ownership;
+        std::vector<u8> buf;
+        remote_request head;
+
+        /* Server answers by its hello in any case: client reports mismatch itself */
+        remote_hello hello, own = remoteHello();
+        bool agreed = reader.read(&hello, sizeof(hello)) && writeAll(client, &own, sizeof(own)) && remoteAgree(hello);
+
+        while(agreed && reader.read(&head, sizeof(head)) && head.size && head.size <= REMOTE_FRAME_MAX)
+        {
+            /* Buffer fits result of any single command */
+            buf.assign(sizeof(remote_reply) + std::max<size_t>(head.size, sizeof(batch_slot_t)), 0);
+            u8 *data = buf.data() + sizeof(remote_reply);
+            if(!reader.read(data, head.size))
+            {
+                break;
+            }
+
+            remote_reply reply;
+            ownership.before(data, head.size);
+            reply.size = execute(data, head.size, reply.count);
+            ownership.after(data);
+            served++;
+            memcpy(buf.data(), &reply, sizeof(reply));
+            if(!(head.flags & REMOTE_NO_REPLY) && !writeAll(client, buf.data(), sizeof(reply) + reply.size))
+            {
+                break;
+            }
+        }
+
+        /* Client is gone without DELS of its structures: they would hold SPU until reset */
+        for(auto &ex : ownership.owned())
+        {
+            batch_slot_t slot = {};
+            slot.frmt_3.cmd  = DELS | P_FLAG;
+            slot.frmt_3.gsid = ex;
+            u32 count;
+            execute((u8 *) &slot, sizeof(dels_cmd_t), count);
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        clients.erase(client);
+        close(client);
+        done.notify_all();
+    }
+}
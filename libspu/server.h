@@ -0,0 +1,86 @@
+/*
+  server.h
+        - SPU server declaration
+        - commands of remote clients are executed by device file or any transport of server host
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "remote.h"
+#include "fileops.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace SPU
+{
+
+/***************************************
+  Server class declaration
+***************************************/
+
+/* Server of remote protocol: thread per connection, commands of all connections go to SPU in turn */
+class Server
+{
+private:
+  Transport *transport;             // Executor, nullptr - device file
+  Fileops device;
+  std::mutex spu;                   // SPU executes one command at a time
+
+  std::vector<int> listeners;
+  std::string path;                 // Unix socket to unlink
+  int wake[2] = { -1, -1 };         // Pipe which stops accept loop
+  std::atomic<bool> stopped;
+
+  std::mutex lock;
+  std::condition_variable done;     // Last connection is closed
+  std::set<int> clients;
+  std::atomic<unsigned long long> served;
+
+  void serve(int client);
+  /// выполняет команды кадра на месте буфера и возвращает размер результата
+  size_t execute(u8 *buf, size_t size, u32 &count);
+
+public:
+  /// transport - исполнитель команд на хосте сервера (nullptr - файл устройства драйвера)
+  explicit Server(Transport *transport = nullptr);
+  Server(const Server &) = delete;
+  Server& operator=(const Server &) = delete;
+  ~Server();
+
+  /// принимает соединения TCP; host - адрес (nullptr - все адреса). false - порт занят
+  bool listenTcp(u32 port = REMOTE_PORT, const char *host = nullptr);
+  /// принимает соединения через сокет Unix
+  bool listenLocal(const char *path);
+
+  /// обслуживает клиентов до вызова stop() из другого потока
+  void run();
+  void stop();
+
+  /// выполненные кадры запросов
+  unsigned long long requests() const { return served; }
+};
+
+} /* namespace SPU */
+
+#endif /* SERVER_H */
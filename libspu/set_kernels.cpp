@@ -0,0 +1,429 @@
+/*
+  set_kernels.cpp
+        - sorted set kernels implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "set_kernels.h"
+#include "data_container_operators.h"
+
+#include <algorithm>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SET_KERNELS_X86
+#endif
+
+namespace SPU
+{
+    /* 64-bit view of two-word keys: cont[0] is the low word */
+    struct __attribute__((may_alias)) word64
+    {
+        unsigned long long word;
+
+        bool operator<(const word64 &other) const { return word < other.word; }
+        bool operator<=(const word64 &other) const { return word <= other.word; }
+        bool operator==(const word64 &other) const { return word == other.word; }
+    };
+
+    /* Bits of block a[0, width) that are equal to some key of block b[0, width) */
+    template <class T> using MaskFn = u32 (*)(const T *a, const T *b);
+
+    template <class T> struct Kernel
+    {
+        MaskFn<T> mask;   // nullptr - scalar merge only
+        u32 width;        // Keys in block
+    };
+
+
+    /***************************************
+      Block compare of SSE and AVX2
+    ***************************************/
+
+#ifdef SET_KERNELS_X86
+    /* Block of b is rotated by shuffles so every key of a meets every key of b */
+    static u32 maskSse32(const u32 *a, const u32 *b)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i *) a);
+        __m128i vb = _mm_loadu_si128((const __m128i *) b);
+        __m128i m0 = _mm_cmpeq_epi32(va, vb);
+        __m128i m1 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)));
+        __m128i m2 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+        __m128i m3 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)));
+        __m128i m  = _mm_or_si128(_mm_or_si128(m0, m1), _mm_or_si128(m2, m3));
+        return (u32) _mm_movemask_ps(_mm_castsi128_ps(m));
+    }
+
+    __attribute__((target("sse4.1")))
+    static u32 maskSse64(const word64 *a, const word64 *b)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i *) a);
+        __m128i vb = _mm_loadu_si128((const __m128i *) b);
+        __m128i m0 = _mm_cmpeq_epi64(va, vb);
+        __m128i m1 = _mm_cmpeq_epi64(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+        return (u32) _mm_movemask_pd(_mm_castsi128_pd(_mm_or_si128(m0, m1)));
+    }
+
+    __attribute__((target("avx2")))
+    static u32 maskAvx32(const u32 *a, const u32 *b)
+    {
+        const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+        __m256i va = _mm256_loadu_si256((const __m256i *) a);
+        __m256i vb = _mm256_loadu_si256((const __m256i *) b);
+        __m256i m  = _mm256_cmpeq_epi32(va, vb);
+        for(int i = 1; i < 8; i++)
+        {
+            vb = _mm256_permutevar8x32_epi32(vb, rotate);
+            m  = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, vb));
+        }
+        return (u32) _mm256_movemask_ps(_mm256_castsi256_ps(m));
+    }
+
+    __attribute__((target("avx2")))
+    static u32 maskAvx64(const word64 *a, const word64 *b)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *) a);
+        __m256i vb = _mm256_loadu_si256((const __m256i *) b);
+        __m256i m  = _mm256_cmpeq_epi64(va, vb);
+        for(int i = 1; i < 4; i++)
+        {
+            vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+            m  = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, vb));
+        }
+        return (u32) _mm256_movemask_pd(_mm256_castsi256_pd(m));
+    }
+
+    static bool hasAvx2()
+    {
+        static const bool ret = __builtin_cpu_supports("avx2");
+        return ret;
+    }
+
+    static bool hasSse41()
+    {
+        static const bool ret = __builtin_cpu_supports("sse4.1");
+        return ret;
+    }
+#endif
+
+    /* Kernels of the host processor unless setKernelsUse() has chosen others */
+    enum Isa { ISA_SCALAR, ISA_SSE, ISA_AVX2 };
+
+    static Isa &chosen()
+    {
+#ifdef SET_KERNELS_X86
+        static Isa ret = hasAvx2() ? ISA_AVX2 : ISA_SSE;
+#else
+        static Isa ret = ISA_SCALAR;
+#endif
+        return ret;
+    }
+
+    static Kernel<u32> kernel32()
+    {
+#ifdef SET_KERNELS_X86
+        switch(chosen())
+        {
+            case ISA_AVX2:   return { maskAvx32, 8 };
+            case ISA_SSE:    return { maskSse32, 4 };
+            case ISA_SCALAR: break;
+        }
+#endif
+        return { nullptr, 1 };
+    }
+
+    static Kernel<word64> kernel64()
+    {
+#ifdef SET_KERNELS_X86
+        if(chosen() == ISA_AVX2)
+        {
+            return { maskAvx64, 4 };
+        }
+        if(chosen() == ISA_SSE && hasSse41())
+        {
+            return { maskSse64, 2 };
+        }
+#endif
+        return { nullptr, 1 };
+    }
+
+
+    /***************************************
+      Generic kernels
+    ***************************************/
+
+    /* First position from lo with key not less than key: steps double, then binary search */
+    template <class T>
+    static size_t gallop(const T *x, size_t n, size_t lo, const T &key)
+    {
+        size_t step = 1;
+        size_t hi = lo;
+        while(hi < n && x[hi] < key)
+        {
+            lo = hi + 1;
+            hi += step;
+            step <<= 1;
+        }
+        return std::lower_bound(x + lo, x + std::min(hi, n), key) - x;
+    }
+
+    /* Blocks of width keys are compared all against all, block with smaller last key goes on. */
+    /* Matches of a block of a are accumulated while it meets blocks of b: difference emits     */
+    /* the rest of them when the block goes on. Tails are merged by scalar compares             */
+    template <class T>
+    static size_t blocks(const T *a, size_t na, const T *b, size_t nb, u32 *out, const Kernel<T> &kernel,
+                         bool subtract)
+    {
+        const u32 width = kernel.width;
+        size_t i = 0, j = 0, ret = 0;
+        u32 seen = 0;
+        while(kernel.mask && i + width <= na && j + width <= nb)
+        {
+            u32 bits = kernel.mask(a + i, b + j);
+            for(u32 rest = subtract ? 0 : bits; rest; rest &= rest - 1)
+            {
+                out[ret++] = i + __builtin_ctz(rest);
+            }
+            seen |= bits;
+
+            bool next_a = a[i + width - 1] <= b[j + width - 1];
+            bool next_b = b[j + width - 1] <= a[i + width - 1];
+            if(next_a)
+            {
+                for(u32 rest = subtract ? ~seen & ((1u << width) - 1) : 0; rest; rest &= rest - 1)
+                {
+                    out[ret++] = i + __builtin_ctz(rest);
+                }
+                i += width;
+                seen = 0;
+            }
+            if(next_b)
+            {
+                j += width;
+            }
+        }
+
+        /* Keys of current block matched by passed blocks of b are already counted */
+        for(size_t base = i; i < na; i++)
+        {
+            if(i - base < width && (seen >> (i - base)) & 1)
+            {
+                continue;
+            }
+            while(j < nb && b[j] < a[i])
+            {
+                j++;
+            }
+            if(j == nb && !subtract)
+            {
+                break;
+            }
+            if((j < nb && b[j] == a[i]) != subtract)
+            {
+                out[ret++] = i;
+            }
+        }
+        return ret;
+    }
+
+    template <class T>
+    static size_t intersect(const T *a, size_t na, const T *b, size_t nb, u32 *out, const Kernel<T> &kernel)
+    {
+        size_t ret = 0;
+        if((unsigned long long) na * SET_GALLOP_RATIO <= nb)
+        {
+            for(size_t i = 0, j = 0; i < na; i++)
+            {
+                j = gallop(b, nb, j, a[i]);
+                if(j == nb)
+                {
+                    break;
+                }
+                if(b[j] == a[i])
+                {
+                    out[ret++] = i;
+                }
+            }
+            return ret;
+        }
+        if((unsigned long long) nb * SET_GALLOP_RATIO <= na)
+        {
+            for(size_t i = 0, j = 0; j < nb; j++)
+            {
+                i = gallop(a, na, i, b[j]);
+                if(i == na)
+                {
+                    break;
+                }
+                if(a[i] == b[j])
+                {
+                    out[ret++] = i;
+                }
+            }
+            return ret;
+        }
+        return blocks(a, na, b, nb, out, kernel, false);
+    }
+
+    /* Difference of small a gallops over b, otherwise every key of a is visited by blocks */
+    template <class T>
+    static size_t subtract(const T *a, size_t na, const T *b, size_t nb, u32 *out, const Kernel<T> &kernel)
+    {
+        if((unsigned long long) na * SET_GALLOP_RATIO <= nb)
+        {
+            size_t ret = 0;
+            for(size_t i = 0, j = 0; i < na; i++)
+            {
+                j = gallop(b, nb, j, a[i]);
+                if(j == nb || !(b[j] == a[i]))
+                {
+                    out[ret++] = i;
+                }
+            }
+            return ret;
+        }
+        return blocks(a, na, b, nb, out, kernel, true);
+    }
+
+    /* Union writes every key, so it is bound by merge: runs of one array shorter than next key */
+    /* of the other are copied by blocks without compares of single keys                       */
+    template <class T>
+    static size_t unite(const T *a, size_t na, const T *b, size_t nb, u32 *out, u32 width)
+    {
+        size_t i = 0, j = 0, ret = 0;
+        while(i < na && j < nb)
+        {
+            if(i + width <= na && a[i + width - 1] < b[j])
+            {
+                for(size_t end = i + width; i < end; i++)
+                {
+                    out[ret++] = i;
+                }
+            }
+            else if(j + width <= nb && b[j + width - 1] < a[i])
+            {
+                for(size_t end = j + width; j < end; j++)
+                {
+                    out[ret++] = j | SET_FROM_B;
+                }
+            }
+            else if(a[i] < b[j])
+            {
+                out[ret++] = i++;
+            }
+            else if(b[j] < a[i])
+            {
+                out[ret++] = j++ | SET_FROM_B;
+            }
+            else
+            {
+                out[ret++] = i++;
+                j++;
+            }
+        }
+        while(i < na)
+        {
+            out[ret++] = i++;
+        }
+        while(j < nb)
+        {
+            out[ret++] = j++ | SET_FROM_B;
+        }
+        return ret;
+    }
+
+
+    /***************************************
+      Sorted set kernels
+    ***************************************/
+
+    size_t setIntersect(const u32 *a, size_t na, const u32 *b, size_t nb, u32 *out)
+    {
+        return intersect(a, na, b, nb, out, kernel32());
+    }
+
+    size_t setUnite(const u32 *a, size_t na, const u32 *b, size_t nb, u32 *out)
+    {
+        return unite(a, na, b, nb, out, kernel32().width);
+    }
+
+    size_t setSubtract(const u32 *a, size_t na, const u32 *b, size_t nb, u32 *out)
+    {
+        return subtract(a, na, b, nb, out, kernel32());
+    }
+
+    /* Keys of one or two words are compared as machine words, wider keys by scalar kernels */
+#if SPU_WEIGHT == 1
+    static const u32 *words(const data_t *keys) { return reinterpret_cast<const u32 *>(keys); }
+    static Kernel<u32> kernelOfKeys() { return kernel32(); }
+#elif SPU_WEIGHT == 2 && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    static const word64 *words(const data_t *keys) { return reinterpret_cast<const word64 *>(keys); }
+    static Kernel<word64> kernelOfKeys() { return kernel64(); }
+#else
+    static const data_t *words(const data_t *keys) { return keys; }
+    static Kernel<data_t> kernelOfKeys() { return { nullptr, 1 }; }
+#endif
+
+    size_t setIntersect(const data_t *a, size_t na, const data_t *b, size_t nb, u32 *out)
+    {
+        return intersect(words(a), na, words(b), nb, out, kernelOfKeys());
+    }
+
+    size_t setUnite(const data_t *a, size_t na, const data_t *b, size_t nb, u32 *out)
+    {
+        return unite(words(a), na, words(b), nb, out, kernelOfKeys().width);
+    }
+
+    size_t setSubtract(const data_t *a, size_t na, const data_t *b, size_t nb, u32 *out)
+    {
+        return subtract(words(a), na, words(b), nb, out, kernelOfKeys());
+    }
+
+    const char *setKernelsIsa()
+    {
+        switch(chosen())
+        {
+            case ISA_AVX2: return "avx2";
+            case ISA_SSE:  return "sse";
+            default:       return "scalar";
+        }
+    }
+
+    bool setKernelsUse(const char *isa)
+    {
+        std::string name = isa;
+        if(name == "scalar")
+        {
+            chosen() = ISA_SCALAR;
+            return true;
+        }
+#ifdef SET_KERNELS_X86
+        if(name == "sse")
+        {
+            chosen() = ISA_SSE;
+            return true;
+        }
+        if(name == "avx2" && hasAvx2())
+        {
+            chosen() = ISA_AVX2;
+            return true;
+        }
+#endif
+        return false;
+    }
+}
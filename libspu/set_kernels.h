@@ -0,0 +1,62 @@
+/*
+  set_kernels.h
+        - sorted set kernels declaration: intersection, union and difference on host
+        - blocks of keys are compared all against all by SSE or AVX2, skewed sizes are galloped
+        - kernel is selected by processor at first call, scalar kernels serve other hosts
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SET_KERNELS_H
+#define SET_KERNELS_H
+
+#include "spu.h"
+
+namespace SPU
+{
+
+/* Position of union result taken from b */
+#define SET_FROM_B 0x80000000u
+
+/* Intersection gallops over the larger array when it is SET_GALLOP_RATIO times larger */
+#define SET_GALLOP_RATIO 32
+
+/***************************************
+  Sorted set kernels
+***************************************/
+
+/* Arrays are strictly increasing. Results are positions in increasing order of keys:    */
+/* positions of a for intersection and difference, of a or b with SET_FROM_B for union.  */
+/* Equal keys of union are taken from a. out holds min(na, nb), na or na + nb positions  */
+
+size_t setIntersect(const u32 *a, size_t na, const u32 *b, size_t nb, u32 *out);
+size_t setUnite(const u32 *a, size_t na, const u32 *b, size_t nb, u32 *out);
+size_t setSubtract(const u32 *a, size_t na, const u32 *b, size_t nb, u32 *out);
+
+size_t setIntersect(const data_t *a, size_t na, const data_t *b, size_t nb, u32 *out);
+size_t setUnite(const data_t *a, size_t na, const data_t *b, size_t nb, u32 *out);
+size_t setSubtract(const data_t *a, size_t na, const data_t *b, size_t nb, u32 *out);
+
+/* Instruction set of kernels on this host: "avx2", "sse" or "scalar" */
+const char *setKernelsIsa();
+
+/* Chooses kernels by instruction set name before set operations, e.g. to check or measure narrower ones. */
+/* false - the host does not support it, kernels are not changed                                          */
+bool setKernelsUse(const char *isa);
+
+} /* namespace SPU */
+
+#endif /* SET_KERNELS_H */
@@ -72,6 +72,18 @@ typedef unsigned char u8;
 // Number of structures in SPU memory
 #define SPU_STR_NUM 7
 
+// Maximum number of commands in one batch
+#define SPU_BATCH_MAX 256
+
+// Maximum number of instructions in LCM program
+#define LCM_SIZE 256
+
+// Maximum of executed instructions and jumps of LCM program, greater max_steps is clamped by driver
+#define LCM_MAX_STEPS (1 << 24)
+
+// JT target which halts LCM program
+#define LCM_HALT 0xffffffff
+
 
 
 /***************************************
@@ -87,6 +99,8 @@ enum cmd
   MIN  = 0x03, // Minimum (first) key-value pair by key
   MAX  = 0x04, // Maximum (last) key-value pair by key
   SRCH = 0x05, // Search for key-value pair
+  SQ   = 0x06, // Squeeze (defragment) DSM blocks of structure
+  JT   = 0x07, // Jump in LCM program (MISD mode only)
   OR   = 0x08, // Binary OR of structures
   AND  = 0x09, // Binary AND of structures
   NOT  = 0x0A, // Binary NOT (minus) of structures
@@ -98,7 +112,9 @@ enum cmd
   NEXT = 0x10, // Next key-value pair by key
   PREV = 0x11, // Previous key-value pair by key
   NSM  = 0x12, // Next smaller key-value pair by key
-  NGR  = 0x13  // Next greater key-value pair by key
+  NGR  = 0x13, // Next greater key-value pair by key
+  PRGM = 0x1E, // LCM program special command (not from SPU)
+  BTCH = 0x1F  // Batch of commands special command (not from SPU)
 }; /* enum cmd */
 
 /* SPU command flags */
@@ -134,6 +150,17 @@ enum rslt
   OERR = 0x08  // Command overflow error
 }; /* enum rslt */
 
+/* LCM program instruction options */
+enum lcm_opt
+{
+  LCM_NONE     = 0x00, // Key and value are taken from instruction
+  LCM_KEY_LAST = 0x01, // Key is taken from last found pair
+  LCM_VAL_LAST = 0x02, // Value is taken from last found pair
+  LCM_OUT      = 0x04, // Found pair is written to program output
+  LCM_IF_OK    = 0x08, // JT jumps if last status is OK
+  LCM_IF_ERR   = 0x10  // JT jumps if last status is not OK
+}; /* enum lcm_opt */
+
 /* SPU result masks */
 enum rslt_mask
 {
@@ -245,7 +272,7 @@ struct cmdfrmt_2
   spu_key_t key;
 };
 
-/* Command format 3 - DELS, MIN, MAX */
+/* Command format 3 - DELS, MIN, MAX, SQ */
 struct cmdfrmt_3
 {
   cmd_t cmd;
@@ -270,6 +297,46 @@ struct cmdfrmt_5
   spu_key_t key;
 };
 
+/* Command format B - BTCH header, followed by `count` batch slots */
+struct cmdfrmt_b
+{
+  cmd_t cmd;
+  u32 count;
+};
+
+/* Command format P - PRGM header, followed by `str_count` LCM structures, */
+/* `count` LCM instructions and `out_max` output slots of result format 2 */
+struct cmdfrmt_p
+{
+  cmd_t cmd;
+  u32 count;
+  u32 str_count;
+  u32 out_max;
+  u32 max_steps;
+};
+
+/* LCM structure: GSID of program structure table, power and deletes are returned in place */
+struct lcm_str
+{
+  gsid_t gsid;
+  u32 power;
+  u32 deleted;  // Deletes after last SQ of program
+  u8 squeezed;  // SQ was executed by program
+};
+
+/* LCM instruction, structures are indexes in program structure table */
+struct lcm_instr
+{
+  cmd_t cmd;
+  u8 opt;       // LCM options
+  u8 str_a;
+  u8 str_b;
+  u8 str_r;
+  u32 target;   // JT target instruction
+  spu_key_t key;
+  val_t val;
+};
+
 
 
 /***************************************
@@ -283,7 +350,7 @@ struct rsltfrmt_0
   gsid_t gsid;
 };
 
-/* Result format 1 - DELS, AND, OR, NOT, LS, LSEQ, GR, GREQ, INS */
+/* Result format 1 - DELS, AND, OR, NOT, LS, LSEQ, GR, GREQ, INS, SQ */
 struct rsltfrmt_1
 {
   rslt_t rslt;
@@ -299,6 +366,35 @@ struct rsltfrmt_2
   u32 power;
 };
 
+/* Result format P - PRGM header after execution */
+struct rsltfrmt_p
+{
+  rslt_t rslt;
+  u32 steps;
+  u32 out_count;
+};
+
+
+
+/***************************************
+  Batch slot
+***************************************/
+
+/* Batch slot holds one command and gets its result after execution */
+/* Result of BTCH header itself is format 1 with count of executed commands as power */
+union batch_slot
+{
+  struct cmdfrmt_0 frmt_0;
+  struct cmdfrmt_1 frmt_1;
+  struct cmdfrmt_2 frmt_2;
+  struct cmdfrmt_3 frmt_3;
+  struct cmdfrmt_4 frmt_4;
+  struct cmdfrmt_5 frmt_5;
+  struct rsltfrmt_0 rslt_0;
+  struct rsltfrmt_1 rslt_1;
+  struct rsltfrmt_2 rslt_2;
+};
+
 
 
 /***************************************
@@ -308,12 +404,18 @@ struct rsltfrmt_2
 typedef struct cmdfrmt_0 adds_cmd_t;
 typedef struct cmdfrmt_1 ins_cmd_t;
 typedef struct cmdfrmt_2 srch_cmd_t, del_cmd_t, next_cmd_t, prev_cmd_t, nsm_cmd_t, ngr_cmd_t;
-typedef struct cmdfrmt_3 dels_cmd_t, min_cmd_t, max_cmd_t;
+typedef struct cmdfrmt_3 dels_cmd_t, min_cmd_t, max_cmd_t, sq_cmd_t;
 typedef struct cmdfrmt_4 and_cmd_t, or_cmd_t, not_cmd_t;
 typedef struct cmdfrmt_5 ls_cmd_t, lseq_cmd_t, gr_cmd_t, greq_cmd_t;
+typedef struct cmdfrmt_b btch_cmd_t;
+typedef struct cmdfrmt_p prgm_cmd_t;
+typedef struct lcm_str lcm_str_t;
+typedef struct lcm_instr lcm_instr_t;
 typedef struct rsltfrmt_0 adds_rslt_t;
-typedef struct rsltfrmt_1 dels_rslt_t, ins_rslt_t, and_rslt_t, or_rslt_t, not_rslt_t, ls_rslt_t, lseq_rslt_t, gr_rslt_t, greq_rslt_t;
+typedef struct rsltfrmt_1 dels_rslt_t, ins_rslt_t, and_rslt_t, or_rslt_t, not_rslt_t, ls_rslt_t, lseq_rslt_t, gr_rslt_t, greq_rslt_t, btch_rslt_t, sq_rslt_t;
 typedef struct rsltfrmt_2 srch_rslt_t, del_rslt_t, min_rslt_t, max_rslt_t, next_rslt_t, prev_rslt_t, nsm_rslt_t, ngr_rslt_t;
+typedef struct rsltfrmt_p prgm_rslt_t;
+typedef union batch_slot batch_slot_t;
 
 
 
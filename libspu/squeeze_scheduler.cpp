@@ -0,0 +1,144 @@
+/*
+  squeeze_scheduler.cpp
+        - squeeze scheduler class implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "squeeze_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace SPU
+{
+    /***************************************
+      SqueezeScheduler class implementation
+    ***************************************/
+
+    SqueezeScheduler::SqueezeScheduler(u32 deletes, u32 percent) :
+            min_deletes(deletes), delete_percent(percent), total(0), running(false)
+    {
+    }
+
+    SqueezeScheduler::~SqueezeScheduler()
+    {
+        stop();
+    }
+
+    void SqueezeScheduler::add(BaseStructure &structure)
+    {
+        std::lock_guard<std::mutex> guard(list_lock);
+        if (std::find(structures.begin(), structures.end(), &structure) == structures.end()) {
+            structures.push_back(&structure);
+        }
+    }
+
+    void SqueezeScheduler::remove(BaseStructure &structure)
+    {
+        std::lock_guard<std::mutex> guard(list_lock);
+        structures.erase(std::remove(structures.begin(), structures.end(), &structure), structures.end());
+    }
+
+    bool SqueezeScheduler::due(BaseStructure &structure)
+    {
+        unsigned long long deleted = structure.get_deleted();
+        unsigned long long used    = structure.get_power() + deleted;
+        return deleted > 0 && deleted >= min_deletes && deleted * 100 >= used * delete_percent;
+    }
+
+    u32 SqueezeScheduler::run(u32 limit)
+    {
+        /* Structures are squeezed under list lock, so remove waits for squeeze end */
+        std::lock_guard<std::mutex> guard(list_lock);
+        std::vector<BaseStructure *> candidates;
+        for (auto ex : structures) {
+            if (due(*ex)) {
+                candidates.push_back(ex);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](BaseStructure *a, BaseStructure *b) {
+            return a->get_deleted() > b->get_deleted();
+        });
+
+        u32 ret = 0;
+        for (auto ex : candidates) {
+            if (ret >= limit) {
+                break;
+            }
+            if (ex->squeeze() == OK) {
+                ret++;
+            }
+        }
+        total += ret;
+        return ret;
+    }
+
+    void SqueezeScheduler::start(std::mutex &lock, u32 idle_ms)
+    {
+        stop();
+        running = true;
+        worker = std::thread(&SqueezeScheduler::loop, this, &lock, idle_ms ? idle_ms : 1);
+    }
+
+    void SqueezeScheduler::stop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(wake_lock);
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    void SqueezeScheduler::loop(std::mutex *lock, u32 idle_ms)
+    {
+        /* Deletes seen by previous check: structure is idle when they did not change */
+        std::map<BaseStructure *, u32> seen;
+
+        std::unique_lock<std::mutex> wait_guard(wake_lock);
+        while (running) {
+            wake.wait_for(wait_guard, std::chrono::milliseconds(idle_ms));
+            if (!running || !lock->try_lock()) {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(list_lock);
+                BaseStructure *victim = nullptr;
+                std::map<BaseStructure *, u32> now;
+                for (auto ex : structures) {
+                    u32 deleted = ex->get_deleted();
+                    now[ex] = deleted;
+                    auto it = seen.find(ex);
+                    bool idle = it != seen.end() && it->second == deleted;
+                    if (idle && due(*ex) && (!victim || deleted > victim->get_deleted())) {
+                        victim = ex;
+                    }
+                }
+                seen.swap(now);
+
+                if (victim && victim->squeeze() == OK) {
+                    seen[victim] = 0;
+                    total++;
+                }
+            }
+            lock->unlock();
+        }
+    }
+}
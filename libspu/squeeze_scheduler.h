@@ -0,0 +1,97 @@
+/*
+  squeeze_scheduler.h
+        - squeeze scheduler class declaration
+        - structures with many deletes since last SQ are squeezed in idle windows
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SQUEEZE_SCHEDULER_H
+#define SQUEEZE_SCHEDULER_H
+
+#include "libspu.h"
+#include "base_structure.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SPU
+{
+
+/* Default minimum of deletes since last squeeze */
+#define SQUEEZE_MIN_DELETES 1024
+
+/* Default minimum share of deleted cells among used ones, percent */
+#define SQUEEZE_DELETE_PERCENT 25
+
+/* Default period of idle checks of background thread, ms */
+#define SQUEEZE_IDLE_MS 100
+
+/***************************************
+  SqueezeScheduler class declaration
+***************************************/
+
+/* Structure is due to squeeze when it has at least min_deletes deletes since last SQ */
+/* and they are at least delete_percent of power + deletes */
+class SqueezeScheduler
+{
+private:
+  std::vector<BaseStructure *> structures;
+  std::mutex list_lock;                 // Guards structures
+  u32 min_deletes;
+  u32 delete_percent;
+  std::atomic<u32> total;               // Squeezes made
+
+  std::thread worker;
+  std::mutex wake_lock;
+  std::condition_variable wake;
+  bool running;
+
+  void loop(std::mutex *lock, u32 idle_ms);
+
+public:
+  explicit SqueezeScheduler(u32 deletes = SQUEEZE_MIN_DELETES, u32 percent = SQUEEZE_DELETE_PERCENT);
+  SqueezeScheduler(const SqueezeScheduler &) = delete;
+  SqueezeScheduler& operator=(const SqueezeScheduler &) = delete;
+  ~SqueezeScheduler();
+
+  /// структура должна быть удалена из планировщика до своего удаления
+  void add(BaseStructure &structure);
+  void remove(BaseStructure &structure);
+
+  /// проверяет эвристику по числу удалений
+  bool due(BaseStructure &structure);
+
+  /// сжимает не более limit структур, начиная со структур с наибольшим числом удалений;
+  /// возвращает число сжатых структур
+  u32 run(u32 limit = ~0u);
+
+  /// запускает фоновый поток: каждые idle_ms поток пробует захватить lock и, если СП
+  /// свободен, сжимает одну структуру, число удалений которой не менялось с прошлой проверки.
+  /// Приложение держит lock на время своих команд к структурам планировщика
+  void start(std::mutex &lock, u32 idle_ms = SQUEEZE_IDLE_MS);
+  void stop();
+
+  u32 squeezed() { return total; }
+};
+
+} /* namespace SPU */
+
+#endif /* SQUEEZE_SCHEDULER_H */
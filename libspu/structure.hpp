@@ -2,6 +2,7 @@
   structure.hpp
         - definitions of structure template class with it's void specialization
         - this is the base interface class in SPU library
+        - structure holds its backend by value, see backend.hpp
 
   Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
                   Alex Popov <alexpopov@bmstu.ru>
@@ -22,16 +23,20 @@
 #ifndef STRUCTURE_HPP
 #define STRUCTURE_HPP
 
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 #include "libspu.h"
 #include "fields.hpp"
+#include "fields_view.hpp"
 #include "base_structure.h"
+#include "backend.hpp"
 #include "extern_value.h"
-
-#ifdef SPU_SIMULATOR
-#include "../simulator/Simulator.h"
-#endif
+#include "batch.h"
+#include "cursor.h"
 
 namespace SPU
 {
@@ -41,7 +46,8 @@ namespace SPU
 ***************************************/
 
 /* Template Structure class definition */
-template<typename NameT = void>
+/* BackendT is HardwareBackend, SimBackend or type-erased DynamicBackend */
+template<typename NameT = void, typename BackendT = DynamicBackend>
 class Structure
 {
 public:
@@ -52,110 +58,372 @@ public:
   };
   using InsertVector = std::vector<InsertStruct>;
 
+  /* Only values passing filter are indexed, empty filter passes all values */
+  using IndexFilter = std::function<bool(Fields<NameT>&)>;
+
 private:
-  BaseStructure *base;
+  /* Secondary index: structure keyed on (indexed value fields, primary key) with empty values */
+  struct Index
+  {
+    FieldsLength<NameT> value_len;   // Layout of primary values
+    FieldsLength<NameT> fields_len;  // Indexed fields, the first one is the least significant
+    IndexFilter filter;
+    BaseStructure *structure;
+  };
+
+  BackendT backend;
   FieldsLength<NameT> key_len;
+  FieldsLength<NameT> value_len;   // Empty when values are not typed
+  std::vector<Index> indexes;
+
+  /* Index key of primary pair or false when value is filtered out */
+  bool indexKey(Index &index, data_t key, data_t value, data_t &ret)
+  {
+    Fields<NameT> value_fields(index.value_len, BitFlow(value));
+    if(index.filter && !index.filter(value_fields))
+    {
+      return false;
+    }
+    Fields<NameT> fields(index.fields_len);
+    for(auto &ex : fields.vecData())
+    {
+      fields[ex.name] = value_fields[ex.name];
+    }
+    ret = ( (data_t) fields << (u8) key_len.width() ) | key;
+    return true;
+  }
+
+  /* Adds index updates of one primary write into batch */
+  void pushIndexes(Batch &batch, data_t key, const pair_t &old, const value_t *value, flags_t flags)
+  {
+    for(auto &ex : indexes)
+    {
+      data_t old_key, new_key;
+      bool had = old.status == OK && indexKey(ex, key, old.value, old_key);
+      bool has = value != nullptr && indexKey(ex, key, *value, new_key);
+      if(had && has && old_key == new_key)
+      {
+        continue;
+      }
+      if(had) { batch.del(*ex.structure, old_key, flags); }
+      if(has) { batch.insert(*ex.structure, new_key, {0}, flags); }
+    }
+  }
+
+  /* Primary write with index maintenance: old value is got by SRCH, */
+  /* then primary INS or DEL goes in one batch with index updates */
+  status_t write(data_t key, const value_t *value, flags_t flags)
+  {
+    if(indexes.empty())
+    {
+      return value ? backend.insert(key, *value, flags) : backend.del(key, flags);
+    }
+
+    pair_t old = backend.search(key);
+    Batch batch;
+    size_t primary = value ? batch.insert(base(), key, *value, flags) : batch.del(base(), key, flags);
+    pushIndexes(batch, key, old, value, flags);
+    return batch.execute()[primary].status;
+  }
+
+  status_t write(const BaseStructure::InsertVector &batch_vector, flags_t flags)
+  {
+    if(indexes.empty())
+    {
+      return backend.insert(batch_vector, flags);
+    }
+
+    /* Old values of all keys by one batch */
+    Batch batch;
+    for(auto &ex : batch_vector)
+    {
+      batch.search(base(), ex.key);
+    }
+    BaseStructure::PairVector old = batch.execute();
+
+    /* Repeated keys see values written earlier in the same vector */
+    std::map<key_t, pair_t> written;
+    std::vector<size_t> primary;
+    primary.reserve(batch_vector.size());
+    for(size_t i = 0; i < batch_vector.size(); i++)
+    {
+      const auto &ex = batch_vector[i];
+      auto it = written.find(ex.key);
+      pair_t before = it == written.end() ? old[i] : it->second;
+      primary.push_back(batch.insert(base(), ex.key, ex.value, flags));
+      pushIndexes(batch, ex.key, before, &ex.value, flags);
+      written[ex.key] = pair_t(ex.key, ex.value);
+    }
+
+    BaseStructure::PairVector rslt = batch.execute();
+    status_t status = OK;
+    for(auto &ex : primary)
+    {
+      status |= rslt[ex].status;
+    }
+    return status;
+  }
 
 public:
-  Structure(FieldsLength<NameT> key_length, BaseStructure *structure= nullptr) : base(structure), key_len(key_length) {
-    if (base == nullptr) {
-#ifndef SPU_SIMULATOR
-      base = new BaseStructure();
-#else
-      base = new Simulator();
-#endif
+  /* Found pair with views of key and value by layouts of structure */
+  /* Views refer to the record, so it has to outlive them */
+  class Record
+  {
+  private:
+    pair_t pair;
+    FieldsLength<NameT> *key_len;
+    FieldsLength<NameT> *value_len;
+
+  public:
+    Record(pair_t found, FieldsLength<NameT> &key_length, FieldsLength<NameT> &value_length) :
+      pair(found), key_len(&key_length), value_len(&value_length) {}
+
+    status_t status() const { return pair.status; }
+    bool found() const      { return pair.status == OK; }
+
+    FieldsView<NameT> key()   { return FieldsView<NameT>(pair.key, *key_len); }
+    FieldsView<NameT> value() { return FieldsView<NameT>(pair.value, *value_len); }
+
+    operator pair_t() const { return pair; }
+  };
+
+  explicit Structure(FieldsLength<NameT> key_length) : Structure(key_length, FieldsLength<NameT>()) {}
+  Structure(FieldsLength<NameT> key_length, FieldsLength<NameT> value_length) :
+    key_len(key_length), value_len(value_length) {}
+
+  /* Given structure is used by type-erased backend only and is not owned */
+  Structure(FieldsLength<NameT> key_length, BaseStructure *structure) : Structure(key_length, FieldsLength<NameT>(), structure) {}
+  Structure(FieldsLength<NameT> key_length, FieldsLength<NameT> value_length, BaseStructure *structure) :
+    backend(structure), key_len(key_length), value_len(value_length) {
+    static_assert(std::is_same<BackendT, DynamicBackend>::value, "Only DynamicBackend takes given structure");
+  }
+
+  Structure(const Structure &) = delete;
+  Structure& operator=(const Structure &) = delete;
+
+  ~Structure()
+  {
+    for(auto &ex : indexes)
+    {
+      delete ex.structure;
     }
   }
 
+  /* Structure of backend for batches, cursors and slices */
+  BaseStructure& base()
+  {
+    return backend;
+  }
+
   Fields<NameT> keyFields()
   {
     return Fields<NameT>(key_len);
   }
 
+  Fields<NameT> valueFields()
+  {
+    return Fields<NameT>(value_len);
+  }
+
+  /* Record of any result of structure */
+  Record record(pair_t pair)
+  {
+    return Record(pair, key_len, value_len);
+  }
+
+  u32 get_power()
+  {
+    return backend.get_power();
+  }
+
   /*************************************
-    Redefinitions of BaseStructure
-    commands with composite key
+    Secondary indexes
   *************************************/
 
-  u32 get_power()
+  /* Declares index on `fields` of values with `value_length` layout and fills it by current pairs */
+  /* Index key is (fields, primary key), so indexed and key widths together have to fit SPU key: */
+  /* wider index would lose high bits of fields and give equal keys to different rows            */
+  size_t addIndex(FieldsLength<NameT> value_length, FieldsLength<NameT> fields, IndexFilter filter = nullptr)
+  {
+    if(fields.width() + key_len.width() > SPU_WEIGHT*32)
+    {
+      throw std::length_error("Index fields and primary key are wider than SPU key");
+    }
+    Index index = { value_length, fields, filter, backend.newStructure() };
+
+    Cursor cursor(base());
+    BaseStructure::InsertVector batch;
+    pair_t pair;
+    while(cursor.next(pair))
+    {
+      data_t index_key;
+      if(indexKey(index, pair.key, pair.value, index_key))
+      {
+        batch.push_back({ index_key, {0} });
+      }
+      if(batch.size() >= SPU_BATCH_MAX)
+      {
+        index.structure->insert(batch);
+        batch.clear();
+      }
+    }
+    if(!batch.empty())
+    {
+      index.structure->insert(batch);
+    }
+
+    indexes.push_back(index);
+    return indexes.size() - 1;
+  }
+
+  /* Index structure, its keys are got by indexFields and primaryKey */
+  BaseStructure& index(size_t idx)
+  {
+    return *indexes.at(idx).structure;
+  }
+
+  /* Indexed fields of index key */
+  Fields<NameT> indexFields(size_t idx, data_t index_key)
+  {
+    return Fields<NameT>(indexes.at(idx).fields_len, BitFlow(index_key >> (u8) key_len.width()));
+  }
+
+  /* Primary key of index key */
+  Fields<NameT> primaryKey(data_t index_key)
+  {
+    return Fields<NameT>(key_len, BitFlow(index_key));
+  }
+
+  /* Primary pair with the least indexed fields */
+  pair_t first(size_t idx, flags_t flags = P_FLAG)
+  {
+    pair_t pair = index(idx).min(flags);
+    if(pair.status != OK)
+    {
+      return pair;
+    }
+    return backend.search(primaryKey(pair.key), flags);
+  }
+
+  /* Primary pair with the greatest indexed fields */
+  pair_t last(size_t idx, flags_t flags = P_FLAG)
   {
-    return base->get_power();
+    pair_t pair = index(idx).max(flags);
+    if(pair.status != OK)
+    {
+      return pair;
+    }
+    return backend.search(primaryKey(pair.key), flags);
   }
 
+  /*************************************
+    Redefinitions of BaseStructure
+    commands with composite key
+  *************************************/
+
   /* Insert */
-  status_t insert(BitFlow key, BitFlow value, flags_t flags = NO_FLAGS) { return base->insert(key, (value_t) value, flags); }
-  status_t insert(BitFlow key, BaseExternValue value, flags_t flags = NO_FLAGS) { return base->insert(key, value.get_id(), flags); }
+  status_t insert(BitFlow key, BitFlow value, flags_t flags = NO_FLAGS)
+  {
+    value_t val = value;
+    return write(key, &val, flags);
+  }
+  status_t insert(BitFlow key, BaseExternValue value, flags_t flags = NO_FLAGS)
+  {
+    value_t val = value.get_id();
+    return write(key, &val, flags);
+  }
   status_t insert(FieldsData<NameT> key, BaseExternValue value, flags_t flags = NO_FLAGS) { return insert(key, value.get_id(), flags); }
   status_t insert(FieldsData<NameT> key_data, BitFlow value, flags_t flags = NO_FLAGS)
   {
-    Fields<NameT> key(key_len, key_data);
-    return insert(key, value, flags);
+    return insert(BitFlow(pack(key_len, key_data)), value, flags);
+  }
+  status_t insert(FieldsData<NameT> key_data, FieldsData<NameT> value_data, flags_t flags = NO_FLAGS)
+  {
+    return insert(BitFlow(pack(key_len, key_data)), BitFlow(pack(value_len, value_data)), flags);
+  }
+  status_t insert(BitFlow key, FieldsData<NameT> value_data, flags_t flags = NO_FLAGS)
+  {
+    return insert(key, BitFlow(pack(value_len, value_data)), flags);
+  }
+  /* Writes record back, changes made through its views included */
+  status_t insert(const Record &rec, flags_t flags = NO_FLAGS)
+  {
+    pair_t pair = rec;
+    return insert(BitFlow(pair.key), BitFlow(pair.value), flags);
   }
   status_t insert(InsertVector insert_vector, flags_t flags = NO_FLAGS)
   {
-    for(auto ex : insert_vector)
+    BaseStructure::InsertVector batch;
+    batch.reserve(insert_vector.size());
+    for(auto &ex : insert_vector)
     {
-      status_t status = insert(ex.key_data, ex.value, flags);
-      if(status != OK)
-      {
-        return status;
-      }
+      batch.push_back({ pack(key_len, ex.key_data), ex.value });
     }
-    return OK;
+    return write(batch, flags);
   }
 
   /* Delete */
-  status_t del(BitFlow key, flags_t flags = NO_FLAGS) { return base->del(key, flags); }
+  status_t del(BitFlow key, flags_t flags = NO_FLAGS) { return write(key, nullptr, flags); }
   status_t del(FieldsData<NameT> key_data, flags_t flags = NO_FLAGS)
   {
-    Fields<NameT> key(key_len, key_data);
-    return del(key, flags);
+    return del(BitFlow(pack(key_len, key_data)), flags);
   }
 
   /* Search */
-  pair_t search(BitFlow key, flags_t flags = P_FLAG) { return base->search(key, flags); }
+  pair_t search(BitFlow key, flags_t flags = P_FLAG) { return backend.search(key, flags); }
   pair_t search(FieldsData<NameT> key_data, flags_t flags = P_FLAG)
   {
-    Fields<NameT> key(key_len, key_data);
-    return search(key, flags);
+    return search(BitFlow(pack(key_len, key_data)), flags);
   }
 
   /* Min and Max */
-  pair_t min(flags_t flags = P_FLAG) { return base->min(flags); }
-  pair_t max(flags_t flags = P_FLAG) { return base->max(flags); }
+  pair_t min(flags_t flags = P_FLAG) { return backend.min(flags); }
+  pair_t max(flags_t flags = P_FLAG) { return backend.max(flags); }
 
   /* Next */
-  pair_t next(BitFlow key, flags_t flags = P_FLAG) { return base->next(key, flags); }
+  pair_t next(BitFlow key, flags_t flags = P_FLAG) { return backend.next(key, flags); }
   pair_t next(FieldsData<NameT> key_data, flags_t flags = P_FLAG)
   {
-    Fields<NameT> key(key_len, key_data);
-    return next(key, flags);
+    return next(BitFlow(pack(key_len, key_data)), flags);
   }
 
   /* Prev */
-  pair_t prev(BitFlow key, flags_t flags = P_FLAG) { return base->prev(key, flags); }
+  pair_t prev(BitFlow key, flags_t flags = P_FLAG) { return backend.prev(key, flags); }
   pair_t prev(FieldsData<NameT> key_data, flags_t flags = P_FLAG)
   {
-    Fields<NameT> key(key_len, key_data);
-    return prev(key, flags);
+    return prev(BitFlow(pack(key_len, key_data)), flags);
   }
 
   /* NSM */
-  pair_t nsm(BitFlow key, flags_t flags = P_FLAG) { return base->nsm(key, flags); }
+  pair_t nsm(BitFlow key, flags_t flags = P_FLAG) { return backend.nsm(key, flags); }
   pair_t nsm(FieldsData<NameT> key_data, flags_t flags = P_FLAG)
   {
-    Fields<NameT> key(key_len, key_data);
-    return nsm(key, flags);
+    return nsm(BitFlow(pack(key_len, key_data)), flags);
   }
 
   /* NGR */
-  pair_t ngr(BitFlow key, flags_t flags = P_FLAG) { return base->ngr(key, flags); }
+  pair_t ngr(BitFlow key, flags_t flags = P_FLAG) { return backend.ngr(key, flags); }
   pair_t ngr(FieldsData<NameT> key_data, flags_t flags = P_FLAG)
   {
-    Fields<NameT> key(key_len, key_data);
-    return ngr(key, flags);
+    return ngr(BitFlow(pack(key_len, key_data)), flags);
   }
 
+  /*************************************
+    Commands returning records with
+    typed views of key and value
+  *************************************/
+
+  Record searchRecord(BitFlow key, flags_t flags = P_FLAG)             { return record(search(key, flags)); }
+  Record searchRecord(FieldsData<NameT> key_data, flags_t flags = P_FLAG) { return record(search(key_data, flags)); }
+  Record minRecord(flags_t flags = P_FLAG)                              { return record(min(flags)); }
+  Record maxRecord(flags_t flags = P_FLAG)                              { return record(max(flags)); }
+  Record nextRecord(BitFlow key, flags_t flags = P_FLAG)               { return record(next(key, flags)); }
+  Record prevRecord(BitFlow key, flags_t flags = P_FLAG)               { return record(prev(key, flags)); }
+  Record nsmRecord(BitFlow key, flags_t flags = P_FLAG)                { return record(nsm(key, flags)); }
+  Record ngrRecord(BitFlow key, flags_t flags = P_FLAG)                { return record(ngr(key, flags)); }
+  Record firstRecord(size_t idx, flags_t flags = P_FLAG)               { return record(first(idx, flags)); }
+  Record lastRecord(size_t idx, flags_t flags = P_FLAG)                { return record(last(idx, flags)); }
+
 };
 
 
@@ -164,8 +432,8 @@ public:
 ***************************************/
 
 /* Structure class void specialization witch is only BaseStructure son */
-template<>
-class Structure<void>
+template<typename BackendT>
+class Structure<void, BackendT>
 {
 public:
   struct InsertStruct
@@ -176,42 +444,46 @@ public:
   using InsertVector = std::vector<InsertStruct>;
 
 private:
-  BaseStructure *base;
+  BackendT backend;
 
 public:
-  explicit Structure(BaseStructure* structure=nullptr) : base(structure) {
-    if (base == nullptr) {
-#ifndef SPU_SIMULATOR
-      base = new BaseStructure();
-#else
-      base = new Simulator();
-#endif
-    }
+  Structure() {}
+  /* Given structure is used by type-erased backend only and is not owned */
+  explicit Structure(BaseStructure* structure) : backend(structure) {
+    static_assert(std::is_same<BackendT, DynamicBackend>::value, "Only DynamicBackend takes given structure");
+  }
+
+  Structure(const Structure &) = delete;
+  Structure& operator=(const Structure &) = delete;
+
+  BaseStructure& base()
+  {
+    return backend;
   }
 
+  u32 get_power() { return backend.get_power(); }
+
   /* BaseStructure overload with BitFlow insertion */
-  status_t insert ( BitFlow key, BitFlow value, flags_t flags = NO_FLAGS) { return base->insert ( key, value, flags); }
-  status_t del    ( BitFlow key, flags_t flags = NO_FLAGS)                { return base->del    ( key, flags); }
-  pair_t search   ( BitFlow key, flags_t flags = P_FLAG)                  { return base->search ( key, flags); }
-  pair_t next     ( BitFlow key, flags_t flags = P_FLAG)                  { return base->next   ( key, flags); }
-  pair_t prev     ( BitFlow key, flags_t flags = P_FLAG)                  { return base->prev   ( key, flags); }
-  pair_t nsm      ( BitFlow key, flags_t flags = P_FLAG)                  { return base->nsm    ( key, flags); }
-  pair_t ngr      ( BitFlow key, flags_t flags = P_FLAG)                  { return base->ngr    ( key, flags); }
-  pair_t min(flags_t flags = P_FLAG)                                      { return base->min(flags); }
-  pair_t max(flags_t flags = P_FLAG)                                      { return base->max(flags); }
+  status_t insert ( BitFlow key, BitFlow value, flags_t flags = NO_FLAGS) { return backend.insert ( key, value, flags); }
+  status_t del    ( BitFlow key, flags_t flags = NO_FLAGS)                { return backend.del    ( key, flags); }
+  pair_t search   ( BitFlow key, flags_t flags = P_FLAG)                  { return backend.search ( key, flags); }
+  pair_t next     ( BitFlow key, flags_t flags = P_FLAG)                  { return backend.next   ( key, flags); }
+  pair_t prev     ( BitFlow key, flags_t flags = P_FLAG)                  { return backend.prev   ( key, flags); }
+  pair_t nsm      ( BitFlow key, flags_t flags = P_FLAG)                  { return backend.nsm    ( key, flags); }
+  pair_t ngr      ( BitFlow key, flags_t flags = P_FLAG)                  { return backend.ngr    ( key, flags); }
+  pair_t min(flags_t flags = P_FLAG)                                      { return backend.min(flags); }
+  pair_t max(flags_t flags = P_FLAG)                                      { return backend.max(flags); }
 
   /* Mass insert overload */
   status_t insert(const InsertVector& insert_vector, flags_t flags = NO_FLAGS)
   {
-    for(auto ex : insert_vector)
+    BaseStructure::InsertVector batch;
+    batch.reserve(insert_vector.size());
+    for(auto &ex : insert_vector)
     {
-      status_t status = insert(ex.key, ex.value, flags);
-      if(status != OK)
-      {
-        return status;
-      }
+      batch.push_back({ ex.key, ex.value });
     }
-    return OK;
+    return backend.insert(batch, flags);
   }
 };
 
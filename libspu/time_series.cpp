@@ -0,0 +1,198 @@
+/*
+  time_series.cpp
+        - time-series storage class implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "time_series.h"
+
+#include <algorithm>
+
+namespace SPU
+{
+    /***************************************
+      TimeSeries class implementation
+    ***************************************/
+
+    TimeSeries::TimeSeries(BaseStructure *structure, size_t batch) :
+            base(structure),
+            key_fields({
+                { "time",   TS_TIME_BITS   },
+                { "series", TS_SERIES_BITS }
+            }),
+            batch_size(batch ? batch : 1)
+    {
+        pending.reserve(batch_size);
+    }
+
+    TimeSeries::~TimeSeries()
+    {
+        flush();
+    }
+
+    key_t TimeSeries::makeKey(series_t series, timestamp_t time)
+    {
+        key_fields["time"]   = time;
+        key_fields["series"] = series;
+        return key_fields;
+    }
+
+    TimeSeries::series_t TimeSeries::seriesOf(key_t key)
+    {
+        key_fields = BitFlow(key);
+        return key_fields["series"];
+    }
+
+    TimeSeries::timestamp_t TimeSeries::timeOf(key_t key)
+    {
+        key_fields = BitFlow(key);
+        return key_fields["time"];
+    }
+
+    TimeSeries::Point TimeSeries::toPoint(const pair_t &pair)
+    {
+        return { timeOf(pair.key), pair.value };
+    }
+
+    pair_t TimeSeries::firstFrom(key_t key)
+    {
+        /* NGR is strict so it is issued for the previous key */
+        if (key == key_t{0}) {
+            return base->min();
+        }
+        return base->ngr(--key);
+    }
+
+    /* Larger timestamp or series id would be cut by key fields and collide with other points */
+    status_t TimeSeries::append(series_t series, timestamp_t time, value_t value)
+    {
+        if (time > TS_TIME_MAX || series > TS_SERIES_MAX) {
+            return ERR;
+        }
+        pending.push_back({ makeKey(series, time), value });
+        if (pending.size() >= batch_size) {
+            return flush();
+        }
+        return OK;
+    }
+
+    status_t TimeSeries::flush()
+    {
+        if (pending.empty()) {
+            return OK;
+        }
+        status_t status = base->insert(pending);
+        pending.clear();
+        return status;
+    }
+
+    TimeSeries::PointVector TimeSeries::range(series_t series, timestamp_t from, timestamp_t to)
+    {
+        PointVector ret;
+        to = std::min(to, (timestamp_t) TS_TIME_MAX);
+        if (from > to || series > TS_SERIES_MAX) {
+            return ret;
+        }
+        flush();
+
+        key_t key  = makeKey(series, from);
+        key_t last = makeKey(series, to);
+        while (true) {
+            BaseStructure::PairVector pairs = base->scan(key, last, batch_size);
+            for (auto &ex : pairs) {
+                ret.push_back(toPoint(ex));
+            }
+            if (pairs.size() < batch_size || pairs.back().key == last) {
+                break;
+            }
+            key = pairs.back().key;
+            ++key;
+        }
+        return ret;
+    }
+
+    status_t TimeSeries::extract(series_t series, timestamp_t from, timestamp_t to, BaseStructure &result)
+    {
+        if (series > TS_SERIES_MAX) {
+            return ERR;
+        }
+        flush();
+
+        /* Range after the last timestamp begins at the next series and is empty */
+        key_t first = makeKey(series, std::min(from, (timestamp_t) TS_TIME_MAX));
+        if (from > TS_TIME_MAX) {
+            ++first;
+        }
+        return base->slice(first, makeKey(series, std::min(to, (timestamp_t) TS_TIME_MAX)), result);
+    }
+
+    TimeSeries::BucketVector TimeSeries::downsample(series_t series, timestamp_t from, timestamp_t to, timestamp_t bucket)
+    {
+        BucketVector ret;
+        to = std::min(to, (timestamp_t) TS_TIME_MAX);
+        if (bucket == 0 || from > to || series > TS_SERIES_MAX) {
+            return ret;
+        }
+        flush();
+
+        key_t last = makeKey(series, to);
+        timestamp_t start = from;
+        while (true) {
+            /* First point of the next non-empty bucket, empty buckets before it are jumped over */
+            pair_t pair = firstFrom(makeKey(series, start));
+            if (pair.status != OK || pair.key > last) {
+                break;
+            }
+            timestamp_t time = timeOf(pair.key);
+            unsigned long long begin = from + (unsigned long long) (time - from) / bucket * bucket;
+            unsigned long long end   = std::min<unsigned long long>(begin + bucket - 1, to);
+
+            Bucket ex = { (timestamp_t) begin, 0, pair.value, pair.value, pair.value, pair.value };
+            for (auto &point : range(series, time, (timestamp_t) end)) {
+                ex.count++;
+                ex.last = point.value;
+                ex.min  = std::min(ex.min, point.value);
+                ex.max  = std::max(ex.max, point.value);
+            }
+            ret.push_back(ex);
+
+            if (end >= to) {
+                break;
+            }
+            start = (timestamp_t) (end + 1);
+        }
+        return ret;
+    }
+
+    status_t TimeSeries::retain(series_t series, timestamp_t since)
+    {
+        if (since == 0) {
+            return OK;
+        }
+        if (series > TS_SERIES_MAX) {
+            return ERR;
+        }
+        flush();
+        return base->erase(makeKey(series, 0), makeKey(series, std::min(since - 1, (timestamp_t) TS_TIME_MAX)));
+    }
+
+    u32 TimeSeries::get_power()
+    {
+        flush();
+        return base->get_power();
+    }
+}
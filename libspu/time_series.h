@@ -0,0 +1,119 @@
+/*
+  time_series.h
+        - time-series storage class declaration
+        - points of many series are stored in one SPU structure
+        - key is (series id, timestamp) packed by FieldsLength layout
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include "libspu.h"
+#include "fields.hpp"
+#include "base_structure.h"
+#include "backend.hpp"
+
+#include <string>
+#include <vector>
+
+namespace SPU
+{
+
+/* Width of key fields: timestamp is the low part of key, series id is the high part */
+#define TS_TIME_BITS   ( SPU_WEIGHT > 1 ? 32 : 16 )
+#define TS_SERIES_BITS ( SPU_WEIGHT > 1 ? 32 : 16 )
+
+/* Largest timestamp and series id the key holds: 65535 on 32-bit SPU, append rejects larger ones */
+#define TS_TIME_MAX   ( (u32) (( 1ull << TS_TIME_BITS   ) - 1) )
+#define TS_SERIES_MAX ( (u32) (( 1ull << TS_SERIES_BITS ) - 1) )
+
+/* Default count of points in one insert batch */
+#define TS_BATCH_SIZE 256
+
+/***************************************
+  TimeSeries class declaration
+***************************************/
+
+/* Time-series storage on top of one SPU structure */
+class TimeSeries
+{
+public:
+  using series_t    = u32;
+  using timestamp_t = u32;
+
+  struct Point
+  {
+    timestamp_t time;
+    value_t     value;
+  };
+  using PointVector = std::vector<Point>;
+
+  /* Points of one downsampling interval [start, start + bucket), values are compared as unsigned words */
+  struct Bucket
+  {
+    timestamp_t start;
+    u32         count;
+    value_t     first;
+    value_t     last;
+    value_t     min;
+    value_t     max;
+  };
+  using BucketVector = std::vector<Bucket>;
+
+private:
+  DynamicBackend base;
+  Fields<std::string> key_fields;             // (time, series) key layout
+  BaseStructure::InsertVector pending;        // Appended but not yet inserted points
+  size_t batch_size;
+
+  Point toPoint(const pair_t &pair);
+  /// первая точка с ключом не меньше заданного
+  pair_t firstFrom(key_t key);
+
+public:
+  explicit TimeSeries(BaseStructure *structure = nullptr, size_t batch = TS_BATCH_SIZE);
+  ~TimeSeries();
+
+  /// упаковывает идентификатор серии и метку времени в ключ
+  key_t makeKey(series_t series, timestamp_t time);
+  series_t seriesOf(key_t key);
+  timestamp_t timeOf(key_t key);
+
+  /// добавляет точку в пакет, пакет вставляется в СП при заполнении.
+  /// Метка времени больше TS_TIME_MAX или серия больше TS_SERIES_MAX - ERR, точка не добавляется
+  status_t append(series_t series, timestamp_t time, value_t value);
+  /// вставляет накопленный пакет в СП
+  status_t flush();
+
+  /// точки серии с метками времени из [from, to], читаются пакетами
+  PointVector range(series_t series, timestamp_t from, timestamp_t to);
+  /// извлекает точки серии из [from, to] в структуру result срезами GREQ и LSEQ
+  status_t extract(series_t series, timestamp_t from, timestamp_t to, BaseStructure &result);
+  /// агрегаты (число точек, первое, последнее, минимальное и максимальное значения) каждого
+  /// непустого интервала длины bucket из [from, to]. Пустые интервалы пропускаются одной командой NGR
+  /// от границы следующего интервала, точки интервала читаются пакетным scan()
+  BucketVector downsample(series_t series, timestamp_t from, timestamp_t to, timestamp_t bucket);
+  /// удаляет точки серии старше since
+  status_t retain(series_t series, timestamp_t since);
+
+  u32 get_power();
+};
+
+} /* namespace SPU */
+
+#endif /* TIME_SERIES_H */
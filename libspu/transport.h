@@ -0,0 +1,116 @@
+/*
+  transport.h
+        - command transport interface declaration
+        - transport replaces write to device file for all structures of process
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "spu.h"
+
+#include <cstddef>
+
+namespace SPU
+{
+
+/***************************************
+  Transport class declaration
+***************************************/
+
+/* Executor of driver commands instead of device file */
+class Transport
+{
+public:
+  virtual ~Transport() = default;
+
+  /// выполняет команду, пакет BTCH или программу PRGM на месте буфера, как запись в файл устройства.
+  /// Возвращает число обработанных байт, 0 - ошибка
+  virtual size_t execute(void *buf, size_t count) = 0;
+  /// команда с результатом в отдельном буфере: результат может быть длиннее команды
+  virtual void execute(const void *cmd, void *rslt) = 0;
+
+  /// транспорт всех структур процесса (nullptr - команды идут через драйвер)
+  static Transport *&global()
+  {
+    static Transport *transport = nullptr;
+    return transport;
+  }
+};
+
+
+/***************************************
+  Format sizes
+***************************************/
+
+/* Size of single command of format 0-5, 0 for BTCH, PRGM and unknown commands */
+inline size_t commandSize(cmd_t cmd)
+{
+  switch(cmd & CMD_MASK)
+  {
+    case ADDS: return sizeof(cmdfrmt_0);
+    case INS:  return sizeof(cmdfrmt_1);
+
+    case SRCH:
+    case DEL:
+    case NEXT:
+    case PREV:
+    case NSM:
+    case NGR:  return sizeof(cmdfrmt_2);
+
+    case DELS:
+    case MIN:
+    case MAX:
+    case SQ:   return sizeof(cmdfrmt_3);
+
+    case AND:
+    case OR:
+    case NOT:  return sizeof(cmdfrmt_4);
+
+    case LS:
+    case LSEQ:
+    case GR:
+    case GREQ: return sizeof(cmdfrmt_5);
+  }
+  return 0;
+}
+
+/* Size of result of single command as driver allocates it: format 0 when no polling */
+inline size_t resultSize(cmd_t cmd)
+{
+  switch(cmd & CMD_MASK)
+  {
+    case SRCH:
+    case DEL:
+    case MIN:
+    case MAX:
+    case NEXT:
+    case PREV:
+    case NSM:
+    case NGR:  return (cmd & P_FLAG) ? sizeof(rsltfrmt_2) : sizeof(rsltfrmt_0);
+  }
+  if((cmd & CMD_MASK) == ADDS || !(cmd & P_FLAG))
+  {
+    return sizeof(rsltfrmt_0);
+  }
+  return commandSize(cmd) ? sizeof(rsltfrmt_1) : 0;
+}
+
+} /* namespace SPU */
+
+#endif /* TRANSPORT_H */
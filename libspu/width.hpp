@@ -0,0 +1,163 @@
+/*
+  width.hpp
+        - word kernels templated on SPU weight (count of u32 in key and value)
+        - weights 1 and 2 are specialised to single u32 and u64 operations
+        - library uses Words<SPU_WEIGHT>: weight is selected at compile time by SPU32, SPU64, ...
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WIDTH_HPP
+#define WIDTH_HPP
+
+#include "spu.h"
+
+namespace SPU
+{
+
+/***************************************
+  Words kernels
+***************************************/
+
+/* Kernels over W words, word 0 is the least significant */
+/* Loops have constant trip count and are unrolled by compiler */
+template <u32 W>
+struct Words
+{
+  /* Compares as numbers from the most significant word */
+  static int compare(const u32 *a, const u32 *b)
+  {
+    for(u32 i = W; i > 0; i--)
+    {
+      if(a[i-1] != b[i-1])
+      {
+        return a[i-1] < b[i-1] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  /* ret may be the same array as a */
+  static void shiftLeft(u32 *ret, const u32 *a, u32 shift)
+  {
+    u32 q = shift / 32, r = shift % 32;
+    for(u32 i = W; i > 0; i--)
+    {
+      u32 idx = i - 1;
+      u32 hi = idx >= q     ? a[idx - q]     : 0;
+      u32 lo = idx >= q + 1 ? a[idx - q - 1] : 0;
+      ret[idx] = r ? ( hi << r ) | ( lo >> (32 - r) ) : hi;
+    }
+  }
+
+  static void shiftRight(u32 *ret, const u32 *a, u32 shift)
+  {
+    u32 q = shift / 32, r = shift % 32;
+    for(u32 idx = 0; idx < W; idx++)
+    {
+      u32 lo = idx + q     < W ? a[idx + q]     : 0;
+      u32 hi = idx + q + 1 < W ? a[idx + q + 1] : 0;
+      ret[idx] = r ? ( lo >> r ) | ( hi << (32 - r) ) : lo;
+    }
+  }
+
+  /* Field of up to 64 bits at bit offset */
+  static unsigned long long extract(const u32 *a, u32 offset, u32 width)
+  {
+    if(width == 0 || offset >= W * 32)
+    {
+      return 0;
+    }
+    u32 idx = offset / 32, r = offset % 32;
+    unsigned long long ret = a[idx];
+    if(idx + 1 < W) { ret |= (unsigned long long) a[idx + 1] << 32; }
+    ret >>= r;
+    if(r && idx + 2 < W) { ret |= (unsigned long long) a[idx + 2] << (64 - r); }
+    return width < 64 ? ret & ( (1ull << width) - 1 ) : ret;
+  }
+
+  /* Writes low width bits of value at bit offset, other bits are kept */
+  /* Bits of field above 64 are cleared */
+  static void deposit(u32 *a, u32 offset, u32 width, unsigned long long value)
+  {
+    for(u32 done = 0; done < width && offset + done < W * 32; )
+    {
+      u32 idx = (offset + done) / 32, r = (offset + done) % 32;
+      u32 cnt = 32 - r;
+      if(cnt > width - done) { cnt = width - done; }
+      u32 mask = cnt == 32 ? ~0u : ( (1u << cnt) - 1 );
+      a[idx] = ( a[idx] & ~(mask << r) ) | ( ( (done < 64 ? (u32) (value >> done) : 0) & mask ) << r );
+      done += cnt;
+    }
+  }
+};
+
+/* SPU32: one u32 */
+template <>
+struct Words<1>
+{
+  static int compare(const u32 *a, const u32 *b) { return *a == *b ? 0 : ( *a < *b ? -1 : 1 ); }
+  static void shiftLeft (u32 *ret, const u32 *a, u32 shift) { *ret = shift < 32 ? *a << shift : 0; }
+  static void shiftRight(u32 *ret, const u32 *a, u32 shift) { *ret = shift < 32 ? *a >> shift : 0; }
+
+  static unsigned long long extract(const u32 *a, u32 offset, u32 width)
+  {
+    if(width == 0 || offset >= 32) { return 0; }
+    u32 ret = *a >> offset;
+    return width < 32 ? ret & ( (1u << width) - 1 ) : ret;
+  }
+
+  static void deposit(u32 *a, u32 offset, u32 width, unsigned long long value)
+  {
+    if(width == 0 || offset >= 32) { return; }
+    u32 mask = width >= 32 ? ~0u : ( (1u << width) - 1 );
+    *a = ( *a & ~(mask << offset) ) | ( ( (u32) value & mask ) << offset );
+  }
+};
+
+/* SPU64: two u32 joined to one u64 */
+template <>
+struct Words<2>
+{
+  static unsigned long long join(const u32 *a) { return a[0] | (unsigned long long) a[1] << 32; }
+  static void split(u32 *ret, unsigned long long v) { ret[0] = (u32) v; ret[1] = (u32) (v >> 32); }
+
+  static int compare(const u32 *a, const u32 *b)
+  {
+    unsigned long long x = join(a), y = join(b);
+    return x == y ? 0 : ( x < y ? -1 : 1 );
+  }
+  static void shiftLeft (u32 *ret, const u32 *a, u32 shift) { split(ret, shift < 64 ? join(a) << shift : 0); }
+  static void shiftRight(u32 *ret, const u32 *a, u32 shift) { split(ret, shift < 64 ? join(a) >> shift : 0); }
+
+  static unsigned long long extract(const u32 *a, u32 offset, u32 width)
+  {
+    if(width == 0 || offset >= 64) { return 0; }
+    unsigned long long ret = join(a) >> offset;
+    return width < 64 ? ret & ( (1ull << width) - 1 ) : ret;
+  }
+
+  static void deposit(u32 *a, u32 offset, u32 width, unsigned long long value)
+  {
+    if(width == 0 || offset >= 64) { return; }
+    unsigned long long mask = width >= 64 ? ~0ull : ( (1ull << width) - 1 );
+    split(a, ( join(a) & ~(mask << offset) ) | ( (value & mask) << offset ));
+  }
+};
+
+} /* namespace SPU */
+
+#endif /* WIDTH_HPP */
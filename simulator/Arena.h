@@ -0,0 +1,129 @@
+/*
+  Arena.h
+        - arena of simulator structures
+        - tree nodes are bump-allocated from blocks of the arena and reused from free list
+        - DELS of the last structure using the arena releases all blocks at once without walking the nodes
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GRAPH_API_ARENA_H
+#define GRAPH_API_ARENA_H
+
+#include "../libspu/libspu.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace SPU
+{
+
+/* Bytes of arena block inside structure: small temporary structures do not touch heap */
+#define ARENA_INLINE_BYTES 1024
+
+/* Bytes of first heap block, next blocks double up to ARENA_MAX_BLOCK */
+#define ARENA_FIRST_BLOCK 4096
+#define ARENA_MAX_BLOCK   (1 << 20)
+
+    /// Арена одной структуры: выделение - сдвиг указателя или снятие с free-list,
+    /// освобождение - возврат в free-list, release() освобождает все блоки сразу
+    class Arena {
+        struct Block { Block *next; };
+        struct Free  { Free *next; };
+
+        static constexpr size_t align = alignof(std::max_align_t);
+
+        alignas(std::max_align_t) char inline_block[ARENA_INLINE_BYTES];
+        Block *blocks = nullptr;
+        char *cur, *end;
+        size_t next_block = ARENA_FIRST_BLOCK;
+        Free *free_list = nullptr;
+        size_t free_size = 0;       /// размер элементов free-list (узлы одного контейнера)
+        size_t heap = 0;
+
+        static size_t round(size_t bytes) { return (bytes + align - 1) / align * align; }
+
+    public:
+        Arena() : cur(inline_block), end(inline_block + ARENA_INLINE_BYTES) {}
+        Arena(const Arena &) = delete;
+        Arena& operator=(const Arena &) = delete;
+        ~Arena() { release(); }
+
+        void *allocate(size_t bytes) {
+            bytes = round(bytes);
+            if (free_list && bytes == free_size) {
+                Free *ret = free_list;
+                free_list = ret->next;
+                return ret;
+            }
+            if ((size_t) (end - cur) < bytes) {
+                size_t size = next_block;
+                while (size < bytes + round(sizeof(Block))) {
+                    size *= 2;
+                }
+                Block *block = (Block *) std::malloc(size);
+                if (!block) {
+                    throw std::bad_alloc();
+                }
+                block->next = blocks;
+                blocks = block;
+                heap += size;
+                cur = (char *) block + round(sizeof(Block));
+                end = (char *) block + size;
+                if (next_block < ARENA_MAX_BLOCK) {
+                    next_block *= 2;
+                }
+            }
+            void *ret = cur;
+            cur += bytes;
+            return ret;
+        }
+
+        void deallocate(void *p, size_t bytes) {
+            bytes = round(bytes);
+            if (free_size == 0) {
+                free_size = bytes;
+            }
+            if (bytes == free_size) {
+                Free *ex = (Free *) p;
+                ex->next = free_list;
+                free_list = ex;
+            }
+        }
+
+        /// освобождает всю память арены; узлы контейнеров не обходятся
+        void release() {
+            while (blocks) {
+                Block *next = blocks->next;
+                std::free(blocks);
+                blocks = next;
+            }
+            cur = inline_block;
+            end = inline_block + ARENA_INLINE_BYTES;
+            next_block = ARENA_FIRST_BLOCK;
+            free_list = nullptr;
+            free_size = 0;
+            heap = 0;
+        }
+
+        /// байты, взятые из кучи
+        size_t heap_bytes() const { return heap; }
+    };
+
+}
+
+#endif //GRAPH_API_ARENA_H
@@ -0,0 +1,258 @@
+/*
+  LatencyModel.cpp
+        - latency model of SPU implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LatencyModel.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace SPU
+{
+  LatencyModel::Params::Params() {
+    for (auto &ex : cmd_ns) {
+      ex = 300;
+    }
+  }
+
+  LatencyModel::LatencyModel(const Params &params) : p(params), epoch(std::chrono::steady_clock::now()) {
+    if (p.fanout < 2) {
+      p.fanout = 2;
+    }
+    if (p.queue_depth == 0) {
+      p.queue_depth = 1;
+    }
+  }
+
+  LatencyModel *&LatencyModel::global() {
+    static LatencyModel *model = nullptr;
+    return model;
+  }
+
+  LatencyModel::Call::Call(LatencyModel *m) : model(m) {
+    if (model) {
+      std::lock_guard<std::mutex> guard(model->lock);
+      if (model->scope++ == 0) {
+        model->sync();
+        model->host += model->p.call_ns;
+        model->host_calls++;
+      }
+    }
+  }
+
+  LatencyModel::Call::~Call() {
+    if (model) {
+      {
+        std::lock_guard<std::mutex> guard(model->lock);
+        model->scope--;
+      }
+      model->spin();
+    }
+  }
+
+  u32 LatencyModel::levels(u32 power) const {
+    u32 ret = 1;
+    for (unsigned long long cap = p.fanout; cap < power; cap *= p.fanout) {
+      ret++;
+    }
+    return ret;
+  }
+
+  /// Ожидание опросом: хост замечает событие на ближайшем опросе после него
+  void LatencyModel::wait(unsigned long long until) {
+    if (until > host) {
+      unsigned long long polls = (until - host + p.poll_ns - 1) / (p.poll_ns ? p.poll_ns : 1);
+      host += p.poll_ns ? polls * p.poll_ns : until - host;
+    }
+  }
+
+  /// В реальном режиме работа хоста между командами тоже идет в счет времени
+  void LatencyModel::sync() {
+    if (p.real) {
+      unsigned long long wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - epoch).count();
+      if (wall > host) {
+        host = wall;
+      }
+    }
+  }
+
+  /// Ожидание занятым циклом: sleep слишком груб для микросекундных задержек
+  void LatencyModel::spin() {
+    if (!p.real) {
+      return;
+    }
+    unsigned long long until;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      until = host;
+    }
+    auto deadline = epoch + std::chrono::nanoseconds(until);
+    while (std::chrono::steady_clock::now() < deadline) {
+    }
+  }
+
+  void LatencyModel::command(cmd_t cmd, flags_t flags, u32 power, u32 pairs) {
+    bool single;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      single = scope == 0;
+      if (single) {
+        sync();
+        host += p.call_ns;
+        host_calls++;
+      }
+
+      while (!queue.empty() && queue.front() <= host) {
+        queue.pop_front();
+      }
+      if ((flags & Q_FLAG) && !(flags & R_FLAG)) {
+        /// Команда в очередь: хост ждет только свободного места
+        while (queue.size() >= p.queue_depth) {
+          wait(queue.front());
+          queue.pop_front();
+        }
+      } else {
+        /// Драйвер ждет готовности СП перед записью команды
+        wait(unit_free);
+      }
+
+      unsigned long long service = p.cmd_ns[cmd & CMD_MASK] + p.level_ns * levels(power) + p.pair_ns * pairs;
+      unsigned long long start   = unit_free > host ? unit_free : host;
+      unit_free = start + service;
+      queue.push_back(unit_free);
+      busy_ns += service;
+      cmds++;
+
+      if (flags & P_FLAG) {
+        wait(unit_free);
+      }
+    }
+    if (single) {
+      spin();
+    }
+  }
+
+  unsigned long long LatencyModel::now() {
+    std::lock_guard<std::mutex> guard(lock);
+    sync();
+    return host;
+  }
+
+  void LatencyModel::reset() {
+    std::lock_guard<std::mutex> guard(lock);
+    host = unit_free = busy_ns = cmds = host_calls = 0;
+    queue.clear();
+    epoch = std::chrono::steady_clock::now();
+  }
+
+  /// Имена команд трассы
+  static int commandCode(const std::string &name) {
+    static const struct { const char *name; cmd_t code; } names[] = {
+            {"DEL", DEL}, {"INS", INS}, {"MIN", MIN}, {"MAX", MAX}, {"SRCH", SRCH}, {"SQ", SQ},
+            {"OR", OR}, {"AND", AND}, {"NOT", NOT}, {"LSEQ", LSEQ}, {"LS", LS}, {"GREQ", GREQ},
+            {"GR", GR}, {"DELS", DELS}, {"NEXT", NEXT}, {"PREV", PREV}, {"NSM", NSM}, {"NGR", NGR}
+    };
+    for (auto &ex : names) {
+      if (name == ex.name) {
+        return ex.code;
+      }
+    }
+    char *end = nullptr;
+    long code = strtol(name.c_str(), &end, 0);
+    return end && *end == 0 && code >= 0 && code <= CMD_MASK ? (int) code : -1;
+  }
+
+  /// Модель одной команды: y - call_ns - poll_ns/2 = cmd_ns[cmd] + level_ns * levels + pair_ns * pairs.
+  /// Свободные члены по командам исключаются центрированием внутри команды
+  LatencyModel::Params LatencyModel::calibrate(std::istream &trace, const Params &params) {
+    struct Sample { int cmd; double levels, pairs, ns; };
+    LatencyModel shape(params);
+    std::vector<Sample> samples;
+
+    std::string line;
+    while (std::getline(trace, line)) {
+      std::istringstream in(line);
+      std::string name;
+      unsigned long long power = 0, pairs = 0;
+      double ns = 0;
+      if (!(in >> name >> power >> ns) || name[0] == '#') {
+        continue;
+      }
+      in >> pairs;
+      int code = commandCode(name);
+      if (code < 0) {
+        continue;
+      }
+      samples.push_back({code, (double) shape.levels(power), (double) pairs,
+                         ns - params.call_ns - params.poll_ns / 2.0});
+    }
+
+    /// Средние по командам
+    double cnt[CMD_MASK + 1] = {0}, ml[CMD_MASK + 1] = {0}, mp[CMD_MASK + 1] = {0}, my[CMD_MASK + 1] = {0};
+    for (auto &ex : samples) {
+      cnt[ex.cmd]++;
+      ml[ex.cmd] += ex.levels;
+      mp[ex.cmd] += ex.pairs;
+      my[ex.cmd] += ex.ns;
+    }
+    for (u32 i = 0; i <= CMD_MASK; i++) {
+      if (cnt[i]) {
+        ml[i] /= cnt[i];
+        mp[i] /= cnt[i];
+        my[i] /= cnt[i];
+      }
+    }
+
+    /// Нормальные уравнения для level_ns и pair_ns по центрированным данным
+    double sll = 0, spp = 0, slp = 0, sly = 0, spy = 0;
+    for (auto &ex : samples) {
+      double l = ex.levels - ml[ex.cmd], q = ex.pairs - mp[ex.cmd], y = ex.ns - my[ex.cmd];
+      sll += l * l;
+      spp += q * q;
+      slp += l * q;
+      sly += l * y;
+      spy += q * y;
+    }
+    double level = 0, pair = 0, det = sll * spp - slp * slp;
+    if (det > 1e-9) {
+      level = (sly * spp - spy * slp) / det;
+      pair  = (spy * sll - sly * slp) / det;
+    } else if (sll > 1e-9) {
+      level = sly / sll;
+    } else if (spp > 1e-9) {
+      pair = spy / spp;
+    }
+
+    Params ret = params;
+    ret.level_ns = level > 0 ? (unsigned long long) (level + 0.5) : 0;
+    ret.pair_ns  = pair  > 0 ? (unsigned long long) (pair  + 0.5) : 0;
+    for (u32 i = 0; i <= CMD_MASK; i++) {
+      if (cnt[i]) {
+        double base = my[i] - (double) ret.level_ns * ml[i] - (double) ret.pair_ns * mp[i];
+        ret.cmd_ns[i] = base > 0 ? (unsigned long long) (base + 0.5) : 0;
+      }
+    }
+    return ret;
+  }
+}
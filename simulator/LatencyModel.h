@@ -0,0 +1,101 @@
+/*
+  LatencyModel.h
+        - latency model of SPU for simulator timing mode
+        - host calls, PCI round trips, polling and one in-order execution unit with bounded queue
+        - parameters are calibrated from hardware traces
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GRAPH_API_LATENCY_MODEL_H
+#define GRAPH_API_LATENCY_MODEL_H
+
+#include "../libspu/libspu.h"
+
+#include <chrono>
+#include <deque>
+#include <istream>
+#include <mutex>
+
+namespace SPU
+{
+
+    /// Модель времени СП: виртуальные часы хоста и одно исполнительное устройство,
+    /// выполняющее команды по порядку. Одна модель разделяется всеми структурами одного СП
+    class LatencyModel {
+    public:
+        struct Params {
+            unsigned long long call_ns  = 4000;  /// вызов драйвера: write() и PCI-транзакции одной команды или пакета
+            unsigned long long poll_ns  = 1000;  /// период опроса регистров состояния
+            unsigned long long cmd_ns[CMD_MASK + 1];  /// время выполнения команды без спуска по дереву
+            unsigned long long level_ns = 60;    /// один уровень B+ дерева структуры
+            unsigned long long pair_ns  = 20;    /// одна пара операндов AND, OR, NOT и срезов
+            u32 fanout      = 32;                /// ветвление узла B+ дерева
+            u32 queue_depth = 16;                /// очередь команд СП (команды с флагом Q)
+            bool real       = false;             /// задержки также выдерживаются по настенным часам
+
+            Params();
+        };
+
+        explicit LatencyModel(const Params &params = Params());
+
+        /// Один вызов драйвера на всю область: пакет или программа LCM.
+        /// Команды внутри области не платят за отдельные вызовы
+        class Call {
+            LatencyModel *model;
+        public:
+            explicit Call(LatencyModel *m);
+            ~Call();
+        };
+
+        /// команда cmd над структурой мощности power, pairs - пары операндов массовых команд.
+        /// Без флагов хост ждет готовности устройства, с Q - места в очереди, с P - завершения
+        void command(cmd_t cmd, flags_t flags, u32 power, u32 pairs = 0);
+
+        /// число уровней B+ дерева структуры мощности power
+        u32 levels(u32 power) const;
+
+        unsigned long long now();                   /// время хоста, нс
+        unsigned long long busy() const { return busy_ns; }  /// занятость устройства, нс
+        unsigned long long commands() const { return cmds; }
+        unsigned long long calls() const { return host_calls; }
+        const Params &params() const { return p; }
+        void reset();
+
+        /// Подбирает параметры по трассе платы: строки "КОМАНДА мощность нс [пары]", где
+        /// КОМАНДА - имя (INS, SRCH, ...) или код, а нс - время одной команды с флагом P на хосте.
+        /// call_ns и poll_ns берутся из params, cmd_ns, level_ns и pair_ns - методом наименьших квадратов
+        static Params calibrate(std::istream &trace, const Params &params = Params());
+
+        /// модель, которую получают новые структуры симулятора (nullptr - без задержек)
+        static LatencyModel *&global();
+
+    private:
+        Params p;
+        std::mutex lock;
+        unsigned long long host = 0, unit_free = 0, busy_ns = 0, cmds = 0, host_calls = 0;
+        std::deque<unsigned long long> queue;  /// времена завершения команд в очереди
+        u32 scope = 0;
+        std::chrono::steady_clock::time_point epoch;
+
+        void wait(unsigned long long until);
+        void sync();
+        void spin();
+    };
+
+}
+
+#endif //GRAPH_API_LATENCY_MODEL_H
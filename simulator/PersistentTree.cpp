@@ -0,0 +1,632 @@
+/*
+  PersistentTree.cpp
+        - persistent B+ tree implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PersistentTree.h"
+#include "../libspu/width.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+
+namespace SPU
+{
+  using Node = PersistentTree::Node;
+
+  static_assert(std::is_trivially_copyable<PersistentTree::Entry>::value,
+                "nodes are copied by memcpy and released without destructors");
+
+  static inline bool less(const key_t &a, const key_t &b) {
+    return Words<SPU_WEIGHT>::compare(a.cont, b.cont) < 0;
+  }
+
+  /// Первая пара листа с ключом не меньше key (upper - больше key)
+  static u32 leafIndex(const Node *node, const key_t &key, bool upper) {
+    u32 i = 0;
+    if (upper) {
+      while (i < node->count && !less(key, node->entries[i].key)) {
+        i++;
+      }
+    } else {
+      while (i < node->count && less(node->entries[i].key, key)) {
+        i++;
+      }
+    }
+    return i;
+  }
+
+  /// Ребенок внутреннего узла, в поддереве которого лежит key
+  static u32 childIndex(const Node *node, const key_t &key) {
+    u32 i = leafIndex(node, key, true);
+    return i ? i - 1 : 0;
+  }
+
+  static void recount(Node *node) {
+    if (node->leaf) {
+      node->size = node->count;
+      return;
+    }
+    node->size = 0;
+    for (u32 i = 0; i < node->count; i++) {
+      node->size += node->entries[i].child->size;
+    }
+  }
+
+  /// Переносит последние n элементов l в начало r
+  static void moveRight(Node *l, Node *r, u32 n) {
+    std::memmove(r->entries + n, r->entries, r->count * sizeof(PersistentTree::Entry));
+    std::memcpy(r->entries, l->entries + l->count - n, n * sizeof(PersistentTree::Entry));
+    l->count -= n;
+    r->count += n;
+    recount(l);
+    recount(r);
+  }
+
+  /// Переносит первые n элементов r в конец l
+  static void moveLeft(Node *l, Node *r, u32 n) {
+    std::memcpy(l->entries + l->count, r->entries, n * sizeof(PersistentTree::Entry));
+    std::memmove(r->entries, r->entries + n, (r->count - n) * sizeof(PersistentTree::Entry));
+    l->count += n;
+    r->count -= n;
+    recount(l);
+    recount(r);
+  }
+
+  /// Вставляет элемент в позицию at узла, в котором есть место
+  static void place(Node *node, u32 at, const key_t &key, const value_t &value, Node *child) {
+    std::memmove(node->entries + at + 1, node->entries + at, (node->count - at) * sizeof(PersistentTree::Entry));
+    node->entries[at].key = key;
+    if (node->leaf) {
+      node->entries[at].value = value;
+    } else {
+      node->entries[at].child = child;
+    }
+    node->count++;
+  }
+
+  static void remove(Node *node, u32 at) {
+    std::memmove(node->entries + at, node->entries + at + 1, (node->count - at - 1) * sizeof(PersistentTree::Entry));
+    node->count--;
+  }
+
+
+  void PersistentTree::Iterator::descend(u32 from, bool right) {
+    for (u32 d = from; d < depth; d++) {
+      path[d] = path[d - 1]->entries[pos[d - 1]].child;
+      pos[d] = right ? path[d]->count - 1 : 0;
+    }
+  }
+
+  bool PersistentTree::Iterator::next() {
+    if (depth == 0) {
+      return false;
+    }
+    u32 leaf = depth - 1;
+    if (pos[leaf] + 1 < path[leaf]->count) {
+      pos[leaf]++;
+      return true;
+    }
+    for (u32 up = leaf; up-- > 0;) {
+      if (pos[up] + 1 < path[up]->count) {
+        pos[up]++;
+        descend(up + 1, false);
+        return true;
+      }
+    }
+    pos[leaf] = path[leaf]->count;
+    return false;
+  }
+
+  bool PersistentTree::Iterator::prev() {
+    if (depth == 0) {
+      return false;
+    }
+    u32 leaf = depth - 1;
+    if (pos[leaf] > 0) {
+      pos[leaf]--;
+      return true;
+    }
+    for (u32 up = leaf; up-- > 0;) {
+      if (pos[up] > 0) {
+        pos[up]--;
+        descend(up + 1, true);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool PersistentTree::Iterator::operator==(const Iterator &other) const {
+    bool a = valid(), b = other.valid();
+    if (!a || !b) {
+      return a == b;
+    }
+    return path[depth - 1] == other.path[other.depth - 1] && pos[depth - 1] == other.pos[other.depth - 1];
+  }
+
+
+  void PersistentTree::Builder::push(const key_t &key, const value_t &value) {
+    if (leaves.empty() || leaves.back()->count == TREE_ORDER) {
+      leaves.push_back(target.alloc(true));
+    }
+    Node *leaf = leaves.back();
+    leaf->entries[leaf->count].key = key;
+    leaf->entries[leaf->count].value = value;
+    leaf->count++;
+    leaf->size++;
+  }
+
+  /// Последний узел уровня добирает элементы у предыдущего
+  static void balanceTail(std::vector<Node *> &level) {
+    if (level.size() > 1 && level.back()->count < TREE_MIN) {
+      Node *l = level[level.size() - 2], *r = level.back();
+      moveRight(l, r, (l->count + r->count) / 2 - r->count);
+    }
+  }
+
+  void PersistentTree::Builder::finish() {
+    std::vector<Node *> level;
+    level.swap(leaves);
+    if (level.empty()) {
+      target.clear();
+      return;
+    }
+    balanceTail(level);
+    while (level.size() > 1) {
+      std::vector<Node *> up;
+      for (Node *ex : level) {
+        if (up.empty() || up.back()->count == TREE_ORDER) {
+          up.push_back(target.alloc(false));
+        }
+        Node *parent = up.back();
+        parent->entries[parent->count].key = ex->entries[0].key;
+        parent->entries[parent->count].child = ex;
+        parent->count++;
+        parent->size += ex->size;
+      }
+      balanceTail(up);
+      level.swap(up);
+    }
+
+    Node *old = target.root;
+    target.root = level[0];
+    target.pairs = level[0]->size;
+    if (old) {
+      target.release(old);
+    }
+  }
+
+
+  PersistentTree::PersistentTree(Pool *pool) : pool(pool ? pool : new Pool()) {
+    this->pool->trees++;
+  }
+
+  PersistentTree::~PersistentTree() {
+    leave();
+  }
+
+  Node *PersistentTree::alloc(bool leaf) {
+    Node *ret = (Node *) pool->arena.allocate(sizeof(Node));
+    ret->refs = 1;
+    ret->size = 0;
+    ret->count = 0;
+    ret->leaf = leaf;
+    return ret;
+  }
+
+  void PersistentTree::free(Node *node) {
+    pool->arena.deallocate(node, sizeof(Node));
+  }
+
+  void PersistentTree::release(Node *node) {
+    if (--node->refs == 0) {
+      if (!node->leaf) {
+        for (u32 i = 0; i < node->count; i++) {
+          release(node->entries[i].child);
+        }
+      }
+      free(node);
+    }
+  }
+
+  /// Разделяемый узел заменяется копией, которой владеет только slot
+  Node *PersistentTree::unique(Node *&slot) {
+    if (slot->refs > 1) {
+      Node *copy = alloc(slot->leaf);
+      std::memcpy(copy, slot, sizeof(Node));
+      copy->refs = 1;
+      if (!copy->leaf) {
+        for (u32 i = 0; i < copy->count; i++) {
+          copy->entries[i].child->refs++;
+        }
+      }
+      slot->refs--;
+      slot = copy;
+    }
+    return slot;
+  }
+
+  /// Последнее дерево семейства освобождает арену целиком, не обходя узлы
+  void PersistentTree::leave() {
+    if (--pool->trees == 0) {
+      delete pool;
+    } else if (root) {
+      release(root);
+    }
+    pool = nullptr;
+    root = nullptr;
+    pairs = 0;
+  }
+
+  void PersistentTree::clear() {
+    if (root) {
+      if (pool->trees == 1) {
+        pool->arena.release();
+      } else {
+        release(root);
+      }
+    }
+    root = nullptr;
+    pairs = 0;
+  }
+
+  void PersistentTree::assign(const PersistentTree &other) {
+    if (this == &other) {
+      return;
+    }
+    Node *shared = other.root;
+    if (shared) {
+      shared->refs++;
+    }
+    if (pool != other.pool) {
+      leave();
+      pool = other.pool;
+      pool->trees++;
+    } else {
+      clear();
+    }
+    root = shared;
+    pairs = other.pairs;
+  }
+
+  void PersistentTree::swap(PersistentTree &other) {
+    std::swap(pool, other.pool);
+    std::swap(root, other.root);
+    std::swap(pairs, other.pairs);
+  }
+
+
+  PersistentTree::Iterator PersistentTree::begin() const {
+    Iterator ret;
+    if (root) {
+      ret.path[0] = root;
+      ret.pos[0] = 0;
+      ret.depth = 1;
+      for (const Node *node = root; !node->leaf; node = node->entries[0].child) {
+        ret.depth++;
+      }
+      ret.descend(1, false);
+    }
+    return ret;
+  }
+
+  PersistentTree::Iterator PersistentTree::end() const {
+    Iterator ret;
+    if (root) {
+      ret.path[0] = root;
+      ret.pos[0] = root->count - 1;
+      ret.depth = 1;
+      for (const Node *node = root; !node->leaf; node = node->entries[node->count - 1].child) {
+        ret.depth++;
+      }
+      ret.descend(1, true);
+      ret.pos[ret.depth - 1]++;
+    }
+    return ret;
+  }
+
+  PersistentTree::Iterator PersistentTree::seek(const key_t &key, bool upper) const {
+    Iterator ret;
+    const Node *node = root;
+    while (node) {
+      ret.path[ret.depth] = node;
+      if (node->leaf) {
+        ret.pos[ret.depth++] = leafIndex(node, key, upper);
+        break;
+      }
+      ret.pos[ret.depth] = childIndex(node, key);
+      node = node->entries[ret.pos[ret.depth++]].child;
+    }
+    /// Позиция за концом листа - первая пара следующего листа
+    if (ret.depth != 0 && !ret.valid()) {
+      ret.pos[ret.depth - 1]--;
+      ret.next();
+    }
+    return ret;
+  }
+
+  PersistentTree::Iterator PersistentTree::lower_bound(const key_t &key) const {
+    return seek(key, false);
+  }
+
+  PersistentTree::Iterator PersistentTree::upper_bound(const key_t &key) const {
+    return seek(key, true);
+  }
+
+  PersistentTree::Iterator PersistentTree::find(const key_t &key) const {
+    Iterator ret = seek(key, false);
+    return ret.valid() && !less(key, ret.key()) ? ret : end();
+  }
+
+  bool PersistentTree::get(const key_t &key, value_t &value) const {
+    const Node *node = root;
+    if (!node) {
+      return false;
+    }
+    while (!node->leaf) {
+      node = node->entries[childIndex(node, key)].child;
+    }
+    u32 i = leafIndex(node, key, false);
+    if (i < node->count && !less(key, node->entries[i].key)) {
+      value = node->entries[i].value;
+      return true;
+    }
+    return false;
+  }
+
+  bool PersistentTree::contains(const key_t &key) const {
+    value_t value;
+    return get(key, value);
+  }
+
+  u32 PersistentTree::rank(const key_t &key, bool inclusive) const {
+    u32 ret = 0;
+    const Node *node = root;
+    while (node && !node->leaf) {
+      u32 i = childIndex(node, key);
+      for (u32 j = 0; j < i; j++) {
+        ret += node->entries[j].child->size;
+      }
+      node = node->entries[i].child;
+    }
+    return node ? ret + leafIndex(node, key, inclusive) : 0;
+  }
+
+  PersistentTree::Iterator PersistentTree::select(u32 index) const {
+    if (index >= pairs) {
+      return end();
+    }
+    Iterator ret;
+    const Node *node = root;
+    while (!node->leaf) {
+      u32 i = 0;
+      while (index >= node->entries[i].child->size) {
+        index -= node->entries[i++].child->size;
+      }
+      ret.path[ret.depth] = node;
+      ret.pos[ret.depth++] = i;
+      node = node->entries[i].child;
+    }
+    ret.path[ret.depth] = node;
+    ret.pos[ret.depth++] = index;
+    return ret;
+  }
+
+  u32 PersistentTree::height() const {
+    u32 ret = 0;
+    for (const Node *node = root; node; node = node->leaf ? nullptr : node->entries[0].child) {
+      ret++;
+    }
+    return ret;
+  }
+
+  static u32 countNodes(const Node *node) {
+    u32 ret = 1;
+    if (!node->leaf) {
+      for (u32 i = 0; i < node->count; i++) {
+        ret += countNodes(node->entries[i].child);
+      }
+    }
+    return ret;
+  }
+
+  u32 PersistentTree::nodes() const {
+    return root ? countNodes(root) : 0;
+  }
+
+  static void flattenNode(const Node *node, std::vector<key_t> &keys, std::vector<value_t> *values) {
+    if (!node->leaf) {
+      for (u32 i = 0; i < node->count; i++) {
+        flattenNode(node->entries[i].child, keys, values);
+      }
+      return;
+    }
+    for (u32 i = 0; i < node->count; i++) {
+      keys.push_back(node->entries[i].key);
+      if (values) {
+        values->push_back(node->entries[i].value);
+      }
+    }
+  }
+
+  void PersistentTree::flatten(std::vector<key_t> &keys, std::vector<value_t> *values) const {
+    keys.clear();
+    keys.reserve(pairs);
+    if (values) {
+      values->clear();
+      values->reserve(pairs);
+    }
+    if (root) {
+      flattenNode(root, keys, values);
+    }
+  }
+
+
+  bool PersistentTree::insertAt(Node *node, const key_t &key, const value_t &value, Node *&split, bool rightmost) {
+    bool added = true;
+    Node *child_split = nullptr;
+    u32 at;
+    if (node->leaf) {
+      at = leafIndex(node, key, false);
+      if (at < node->count && !less(key, node->entries[at].key)) {
+        node->entries[at].value = value;
+        return false;
+      }
+    } else {
+      u32 i = childIndex(node, key);
+      Node *child = unique(node->entries[i].child);
+      added = insertAt(child, key, value, child_split, rightmost && i + 1 == node->count);
+      node->entries[i].key = child->entries[0].key;
+      if (added) {
+        node->size++;
+      }
+      if (!child_split) {
+        return added;
+      }
+      at = i + 1;
+    }
+
+    const key_t &ins_key = node->leaf ? key : child_split->entries[0].key;
+    Node *target = node;
+    if (node->count == TREE_ORDER) {
+      /// Узел делится пополам. Вставка в конец правого края дерева оставляет узел полным,
+      /// а новый узел получает один элемент: возрастающие вставки заполняют узлы целиком.
+      /// Внутри дерева так делить нельзя: убывающие вставки в промежуток между ключами
+      /// создавали бы по листу на ключ
+      u32 half = rightmost && at == TREE_ORDER ? TREE_ORDER : TREE_ORDER / 2;
+      split = alloc(node->leaf);
+      moveRight(node, split, TREE_ORDER - half);
+      if (at >= half) {
+        target = split;
+        at -= half;
+      }
+    }
+    place(target, at, ins_key, value, child_split);
+    recount(target);
+    return added;
+  }
+
+  bool PersistentTree::insert(const key_t &key, const value_t &value) {
+    if (!root) {
+      root = alloc(true);
+      place(root, 0, key, value, nullptr);
+      root->size = 1;
+      pairs = 1;
+      return true;
+    }
+    unique(root);
+    Node *split = nullptr;
+    bool added = insertAt(root, key, value, split, true);
+    if (split) {
+      Node *top = alloc(false);
+      place(top, 0, root->entries[0].key, value, root);
+      place(top, 1, split->entries[0].key, value, split);
+      recount(top);
+      root = top;
+    }
+    if (added) {
+      pairs++;
+    }
+    return added;
+  }
+
+  /// Ребенок index узла parent сливается с соседом или берет у него часть элементов
+  void PersistentTree::rebalance(Node *parent, u32 index) {
+    u32 j = index > 0 ? index - 1 : index;
+    Node *l = unique(parent->entries[j].child), *r = unique(parent->entries[j + 1].child);
+    if (l->count + r->count <= TREE_ORDER) {
+      moveLeft(l, r, r->count);
+      free(r);
+      remove(parent, j + 1);
+    } else if (l->count < r->count) {
+      moveLeft(l, r, (r->count - l->count) / 2);
+      parent->entries[j + 1].key = r->entries[0].key;
+    } else {
+      moveRight(l, r, (l->count - r->count) / 2);
+      parent->entries[j + 1].key = r->entries[0].key;
+    }
+    parent->entries[j].key = l->entries[0].key;
+  }
+
+  void PersistentTree::eraseAt(Node *node, const key_t &key) {
+    if (node->leaf) {
+      remove(node, leafIndex(node, key, false));
+      node->size--;
+      return;
+    }
+    u32 i = childIndex(node, key);
+    Node *child = unique(node->entries[i].child);
+    eraseAt(child, key);
+    node->size--;
+    if (child->count < TREE_MIN) {
+      rebalance(node, i);
+    } else {
+      node->entries[i].key = child->entries[0].key;
+    }
+  }
+
+  bool PersistentTree::erase(const key_t &key) {
+    /// Отсутствующий ключ не должен копировать путь
+    if (!contains(key)) {
+      return false;
+    }
+    unique(root);
+    eraseAt(root, key);
+    pairs--;
+    if (root->count == 0) {
+      free(root);
+      root = nullptr;
+    } else if (!root->leaf && root->count == 1) {
+      Node *top = root;
+      root = top->entries[0].child;
+      free(top);
+    }
+    return true;
+  }
+
+  /// Большой диапазон удаляется перестроением дерева из оставшихся пар
+  u32 PersistentTree::erase(const key_t &from, const key_t &to) {
+    if (less(to, from)) {
+      return 0;
+    }
+    u32 ret = rank(to, true) - rank(from);
+    if (ret == 0) {
+      return 0;
+    }
+    if (ret == pairs) {
+      clear();
+    } else if (ret >= pairs / 8) {
+      Builder builder(*this);
+      for (Iterator it = begin(); it.valid() && less(it.key(), from); it.next()) {
+        builder.push(it.key(), it.value());
+      }
+      for (Iterator it = upper_bound(to); it.valid(); it.next()) {
+        builder.push(it.key(), it.value());
+      }
+      builder.finish();
+    } else {
+      for (u32 i = 0; i < ret; i++) {
+        key_t key = lower_bound(from).key();
+        erase(key);
+      }
+    }
+    return ret;
+  }
+}
@@ -0,0 +1,192 @@
+/*
+  PersistentTree.h
+        - persistent B+ tree of simulator structures
+        - clone shares all nodes, update copies only shared nodes on the path from root
+        - sorted pairs are linked bottom-up in linear time
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GRAPH_API_PERSISTENT_TREE_H
+#define GRAPH_API_PERSISTENT_TREE_H
+
+#include "../libspu/libspu.h"
+#include "Arena.h"
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace SPU
+{
+
+/* Pairs in leaf and children in inner node */
+#define TREE_ORDER 32
+
+/* Node with fewer entries is merged with its neighbour or borrows from it */
+#define TREE_MIN (TREE_ORDER / 4)
+
+/* Height limit: every node below the root holds at least TREE_MIN entries, so a tree of height h */
+/* has at least 2 * TREE_MIN^(h-1) = 2^(3h-2) pairs; u32 count of pairs keeps height under 12.     */
+/* Only nodes of the rightmost path may hold fewer: ascending inserts split them at the end,       */
+/* and their left neighbours stay full                                                             */
+#define TREE_MAX_HEIGHT 16
+
+    /// B+ дерево пар с копированием пути. Клон разделяет с исходным деревом все узлы,
+    /// изменение копирует только разделяемые узлы на пути от корня, остальные правятся на месте.
+    /// Клоны образуют семейство с общей ареной узлов; деревья семейства не изменяются параллельно
+    class PersistentTree {
+    public:
+        struct Node;
+
+        /// Ключ лежит рядом со значением или ребенком: поиск в узле и переход к ребенку
+        /// читают одни и те же строки кэша
+        struct Entry {
+            key_t key;                  /// ключ листа или наименьший ключ ребенка
+            union {
+                value_t value;
+                Node   *child;
+            };
+        };
+
+        struct Node {
+            u32  refs;                  /// деревья и узлы, ссылающиеся на узел
+            u32  size;                  /// пары поддерева
+            u32  count;                 /// пары листа или дети внутреннего узла
+            bool leaf;
+            Entry entries[TREE_ORDER];
+        };
+
+        /// Арена семейства деревьев
+        struct Pool {
+            Arena arena;
+            u32 trees = 0;
+        };
+
+        /// Позиция пары - путь от корня до листа. Позиция за последней парой - end()
+        class Iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type        = std::pair<key_t, value_t>;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const value_type *;
+            using reference         = value_type;
+
+            bool valid() const { return depth != 0 && pos[depth - 1] < path[depth - 1]->count; }
+            const key_t   &key()   const { return path[depth - 1]->entries[pos[depth - 1]].key; }
+            const value_t &value() const { return path[depth - 1]->entries[pos[depth - 1]].value; }
+            value_type operator*() const { return {key(), value()}; }
+
+            /// false - пары кончились, итератор стал end()
+            bool next();
+            /// false - предыдущей пары нет, итератор не изменяется
+            bool prev();
+
+            Iterator &operator++() { next(); return *this; }
+            Iterator operator++(int) { Iterator ret = *this; next(); return ret; }
+            bool operator==(const Iterator &other) const;
+            bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+        private:
+            friend class PersistentTree;
+            const Node *path[TREE_MAX_HEIGHT];
+            u32 pos[TREE_MAX_HEIGHT];
+            u32 depth = 0;
+
+            void descend(u32 from, bool right);
+        };
+
+        /// Построение по строго возрастающим ключам снизу вверх: листья заполняются подряд,
+        /// затем над ними строятся уровни внутренних узлов
+        class Builder {
+        public:
+            using value_type = std::pair<key_t, value_t>;
+
+            explicit Builder(PersistentTree &target) : target(target) {}
+
+            void push(const key_t &key, const value_t &value);
+            void push_back(const value_type &ex) { push(ex.first, ex.second); }
+            /// замещает содержимое target; читать target до вызова можно
+            void finish();
+
+        private:
+            PersistentTree &target;
+            std::vector<Node *> leaves;
+        };
+
+        /// pool - семейство нового дерева (nullptr - новое семейство)
+        explicit PersistentTree(Pool *pool = nullptr);
+        PersistentTree(const PersistentTree &) = delete;
+        PersistentTree& operator=(const PersistentTree &) = delete;
+        ~PersistentTree();
+
+        u32 size() const { return pairs; }
+        bool empty() const { return pairs == 0; }
+        /// байты кучи, взятые ареной семейства
+        size_t heap_bytes() const { return pool->arena.heap_bytes(); }
+        /// уровни дерева (0 - пустое дерево)
+        u32 height() const;
+        /// узлы дерева обходом за O(n / TREE_ORDER)
+        u32 nodes() const;
+
+        Iterator begin() const;
+        Iterator end() const;
+        Iterator lower_bound(const key_t &key) const;
+        Iterator upper_bound(const key_t &key) const;
+        /// end(), если ключа нет
+        Iterator find(const key_t &key) const;
+        bool get(const key_t &key, value_t &value) const;
+        bool contains(const key_t &key) const;
+        /// число ключей меньше key (inclusive - не больше key) за O(log n)
+        u32 rank(const key_t &key, bool inclusive = false) const;
+        /// пара с номером index по возрастанию ключа за O(log n) (end() при index >= size())
+        Iterator select(u32 index) const;
+        /// выгружает ключи (и значения, если values не nullptr) по возрастанию обходом листьев
+        void flatten(std::vector<key_t> &keys, std::vector<value_t> *values = nullptr) const;
+
+        /// вставляет пару или заменяет значение; true - ключ новый
+        bool insert(const key_t &key, const value_t &value);
+        bool erase(const key_t &key);
+        /// удаляет ключи из [from, to] и возвращает их число
+        u32 erase(const key_t &from, const key_t &to);
+        void clear();
+
+        /// дерево становится копией other за O(1): входит в семейство other и разделяет его корень
+        void assign(const PersistentTree &other);
+        void swap(PersistentTree &other);
+
+    private:
+        Pool *pool;
+        Node *root = nullptr;
+        u32 pairs = 0;
+
+        Node *alloc(bool leaf);
+        void free(Node *node);
+        void release(Node *node);
+        Node *unique(Node *&slot);
+        void leave();
+
+        Iterator seek(const key_t &key, bool upper) const;
+        /// rightmost - узел на правом краю дерева: только там переполненный узел делится в конце
+        bool insertAt(Node *node, const key_t &key, const value_t &value, Node *&split, bool rightmost);
+        void eraseAt(Node *node, const key_t &key);
+        void rebalance(Node *parent, u32 index);
+    };
+
+}
+
+#endif //GRAPH_API_PERSISTENT_TREE_H
@@ -0,0 +1,152 @@
+/*
+  RegisterFile.cpp
+        - emulated SPU register file implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RegisterFile.h"
+
+
+namespace SPU
+{
+  RegisterFile::RegisterFile(u8 revision) : rev(revision) {
+  }
+
+  RegisterFile::~RegisterFile() {
+    for (u32 i = 1; i <= SPU_STR_NUM; i++) {
+      clear(i);
+    }
+  }
+
+  /// Структура создается при первой команде: у платы все структуры существуют всегда
+  Simulator &RegisterFile::structure(u32 str) {
+    Simulator *&ret = strs[str - 1];
+    if (!ret) {
+      ret = new Simulator();
+      ret->set_timing(nullptr);
+      ret->set_queues(nullptr);
+    }
+    return *ret;
+  }
+
+  void RegisterFile::clear(u32 str) {
+    delete strs[str - 1];
+    strs[str - 1] = nullptr;
+  }
+
+  void RegisterFile::write(u32 reg, u32 data) {
+    if (reg < KEY_REG + SPU_WEIGHT) {
+      key[reg - KEY_REG] = data;
+    } else if (reg >= VAL_REG && reg < VAL_REG + SPU_WEIGHT) {
+      val[reg - VAL_REG] = data;
+    } else if (reg == CMD_REG) {
+      execute(data);
+    } else if (reg == CNTL_REG_1 && (data & 1)) {
+      /* Reset of SPU: structures become empty */
+      for (u32 i = 1; i <= SPU_STR_NUM; i++) {
+        clear(i);
+      }
+      state = 0;
+    }
+  }
+
+  u32 RegisterFile::read(u32 reg) {
+    if (reg < KEY_REG + SPU_WEIGHT) {
+      return key[reg - KEY_REG];
+    }
+    if (reg >= VAL_REG && reg < VAL_REG + SPU_WEIGHT) {
+      return val[reg - VAL_REG];
+    }
+    switch (reg) {
+      case POWER_REG:
+        return power;
+      case STATE_REG_0:
+        return state | (1u << SPU_READY_FLAG) | (1u << DDR_TEST_SUCC_FLAG);
+      case STATE_REG_1:
+        return 1u << SYS2SPU_Q_EMP_FLAG;
+    }
+    return 0;
+  }
+
+  /// Слово команды: команда, структуры A, B и R; команды форматов 1-3 адресуют структуру полем R
+  void RegisterFile::execute(u32 word) {
+    cmd_t cmd = (word >> 3*MMIO_STR_BITS) & CMD_MASK;
+    u32 a = (word >> 2*MMIO_STR_BITS) & MMIO_STR_MASK;
+    u32 b = (word >> MMIO_STR_BITS) & MMIO_STR_MASK;
+    u32 r = word & MMIO_STR_MASK;
+    key_t k, v;
+    for (u32 i = 0; i < SPU_WEIGHT; i++) {
+      k.cont[i] = key[i];
+      v.cont[i] = val[i];
+    }
+    executed++;
+
+    bool set   = cmd == AND || cmd == OR || cmd == NOT;
+    bool slice = cmd == LS || cmd == LSEQ || cmd == GR || cmd == GREQ;
+    if (r == 0 || ((set || slice) && a == 0) || (set && b == 0)) {
+      state = ERR;
+      return;
+    }
+
+    pair_t ret(ERR);
+    switch (cmd) {
+      case INS:    ret.status = structure(r).insert(k, v, P_FLAG); break;
+      case SRCH:   ret = structure(r).search(k); break;
+      case MIN:    ret = structure(r).min(); break;
+      case MAX:    ret = structure(r).max(); break;
+      case NEXT:   ret = structure(r).next(k); break;
+      case PREV:   ret = structure(r).prev(k); break;
+      case NSM:    ret = structure(r).nsm(k); break;
+      case NGR:    ret = structure(r).ngr(k); break;
+      case SQ:     ret.status = structure(r).squeeze(); break;
+      case AND:    ret.status = structure(a).intersect(structure(b), structure(r)); break;
+      case OR:     ret.status = structure(a).unite(structure(b), structure(r)); break;
+      case NOT:    ret.status = structure(a).subtract(structure(b), structure(r)); break;
+      case LS:     ret.status = structure(a).ls(k, structure(r)); break;
+      case LSEQ:   ret.status = structure(a).lseq(k, structure(r)); break;
+      case GR:     ret.status = structure(a).gr(k, structure(r)); break;
+      case GREQ:   ret.status = structure(a).greq(k, structure(r)); break;
+
+      /* Deleted pair is returned in key and value registers */
+      case DEL:
+        ret = structure(r).search(k);
+        if (ret.status == OK) {
+          ret.status = structure(r).del(k, P_FLAG);
+        }
+        break;
+
+      case DELS:
+        clear(r);
+        ret.status = OK;
+        break;
+
+      default:
+        state = ERR;
+        return;
+    }
+
+    power = cmd == DELS ? 0 : structure(r).get_power();
+    if (ret.status == OK && (cmd == SRCH || cmd == DEL || cmd == MIN || cmd == MAX ||
+                             cmd == NEXT || cmd == PREV || cmd == NSM || cmd == NGR)) {
+      for (u32 i = 0; i < SPU_WEIGHT; i++) {
+        key[i] = ret.key.cont[i];
+        val[i] = ret.value.cont[i];
+      }
+    }
+    state = ret.status & ERRORS_MASK;
+  }
+}
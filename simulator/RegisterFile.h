@@ -0,0 +1,65 @@
+/*
+  RegisterFile.h
+        - emulated SPU register file for userspace command executor
+        - command register writes are decoded and executed on simulator structures
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GRAPH_API_REGISTER_FILE_H
+#define GRAPH_API_REGISTER_FILE_H
+
+#include "../libspu/mmio.h"
+#include "Simulator.h"
+
+namespace SPU
+{
+
+    /// Регистры СП, за которыми стоят структуры симулятора 1..SPU_STR_NUM.
+    /// Запись в регистр команды выполняет команду сразу: СП всегда готов, очередь SYS2SPU пуста
+    class RegisterFile : public Registers {
+    public:
+        /// revision - ревизия PCI платы, которую драйвер записывает в GSID
+        explicit RegisterFile(u8 revision = 0);
+        RegisterFile(const RegisterFile &obj) = delete;
+        RegisterFile& operator=(const RegisterFile &obj) = delete;
+        ~RegisterFile() override;
+
+        void write(u32 reg, u32 data) override;
+        u32 read(u32 reg) override;
+        u8 revision() override { return rev; }
+
+        /// структура СП с номером str (1..SPU_STR_NUM)
+        Simulator &structure(u32 str);
+        /// число выполненных команд
+        u32 commands() const { return executed; }
+
+    private:
+        u32 key[SPU_WEIGHT] = {0};
+        u32 val[SPU_WEIGHT] = {0};
+        u32 power = 0;
+        u8 state = 0;                   // Status bits of state 0 register
+        u8 rev;
+        u32 executed = 0;
+        Simulator *strs[SPU_STR_NUM] = {nullptr};
+
+        void execute(u32 word);
+        void clear(u32 str);
+    };
+
+}
+
+#endif //GRAPH_API_REGISTER_FILE_H
@@ -3,34 +3,42 @@
 //
 
 #include <algorithm>
+#include <iterator>
+#include <thread>
 #include "Simulator.h"
+#include "../libspu/set_kernels.h"
 
 
 namespace SPU
 {
-  map<gsid_t, map<key_t, value_t> *> globalStructures;
+  map<gsid_t, PersistentTree *> &globalStructures() {
+    static map<gsid_t, PersistentTree *> structures;
+    return structures;
+  }
 
 
   Simulator::Simulator(bool initialize) : BaseStructure(false) {
     if (initialize) {
       init();
-      auto gsid = get_gsid();
-      auto it = globalStructures.find(gsid);
-      if (it != globalStructures.end()) {
-        _data = it->second;
-      }
     }
   }
 
-  Simulator::Simulator(Simulator &obj) = default;
-
-  Simulator::~Simulator() = default;
+  /// DELS симулятора освобождает дерево структуры; базовый деструктор DELS не повторяет
+  Simulator::~Simulator() {
+    if (_queues) {
+      _queues->forget(this);
+    }
+    if (_data) {
+      deleteStructure();
+    }
+    detach();
+  }
 
   adds_rslt_t Simulator::createStructure() {
     auto gsid = getNextGsid();
 
-    _data = new map<key_t, value_t>();
-    globalStructures[gsid] = _data;
+    _data = new PersistentTree();
+    globalStructures()[gsid] = _data;
 
     adds_rslt_t res;
     res.gsid = gsid;
@@ -39,7 +47,12 @@ namespace SPU
   }
 
   dels_rslt_t Simulator::deleteStructure() {
-    globalStructures.erase(get_gsid());
+    auto it = globalStructures().find(get_gsid());
+    if (it != globalStructures().end()) {
+      delete it->second;
+      globalStructures().erase(it);
+    }
+    _data = nullptr;
     return dels_rslt_t{.rslt = OK, .power = 0};
   }
 
@@ -48,91 +61,551 @@ namespace SPU
     return _data->size();
   }
 
+  bool Simulator::hasRoom(key_t key) {
+    return _capacity == 0 || _data->size() + _holes < _capacity || _data->contains(key);
+  }
+
+  void Simulator::timed(cmd_t cmd, flags_t flags, u32 pairs) {
+    /// Команда из очереди уже учтена при подаче
+    if (_timing && !(_queues && _queues->executing())) {
+      _timing->command(cmd, flags, _data->size(), pairs);
+    }
+  }
+
+  bool Simulator::queued(pair_t &ret, cmd_t cmd, flags_t flags, key_t key, value_t value,
+                         BaseStructure *b, BaseStructure *result) {
+    if (!_queues || _queues->executing()) {
+      return false;
+    }
+    ret = _queues->submit({this, b, result, (cmd_t) (cmd | flags), LCM_NONE, 0, key, value});
+    return true;
+  }
+
+  pair_t Simulator::apply(const ProgramStruct &command) {
+    return dispatch(command);
+  }
+
   status_t Simulator::insert(key_t key, value_t value, flags_t flags) {
-    _data->emplace(key, value);
+    timed(INS, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, INS, flags, key, value)) {
+      return queued_ret.status;
+    }
+    if (!hasRoom(key)) {
+      return OERR;
+    }
+    _data->insert(key, value);
+    return OK;
+  }
+
+  /// Устойчивая сортировка пакета по ключам: части сортируются потоками и попарно сливаются
+  static void sortPairs(BaseStructure::InsertVector &pairs, u32 threads) {
+    auto less = [](const BaseStructure::InsertStruct &a, const BaseStructure::InsertStruct &b) {
+      return a.key < b.key;
+    };
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t n = pairs.size();
+    if (threads < 2 || n < SIM_PARALLEL_SORT_MIN) {
+      std::stable_sort(pairs.begin(), pairs.end(), less);
+      return;
+    }
+
+    auto begin = pairs.begin();
+    std::vector<std::size_t> bounds;
+    for (u32 i = 0; i <= threads; i++) {
+      bounds.push_back(n * i / threads);
+    }
+    std::vector<std::thread> workers;
+    for (u32 i = 0; i < threads; i++) {
+      workers.emplace_back([=] { std::stable_sort(begin + bounds[i], begin + bounds[i + 1], less); });
+    }
+    for (auto &ex : workers) {
+      ex.join();
+    }
+    /// Слияния одного уровня не пересекаются
+    for (u32 width = 1; width < threads; width *= 2) {
+      workers.clear();
+      for (u32 i = 0; i + width < threads; i += 2 * width) {
+        std::size_t lo = bounds[i], mid = bounds[i + width], hi = bounds[std::min(i + 2 * width, threads)];
+        workers.emplace_back([=] { std::inplace_merge(begin + lo, begin + mid, begin + hi, less); });
+      }
+      for (auto &ex : workers) {
+        ex.join();
+      }
+    }
+  }
+
+  void Simulator::build(const InsertVector &insert_vector) {
+    const InsertStruct *first = insert_vector.data(), *last = first + insert_vector.size();
+    InsertVector sorted;
+    /// Строго возрастающий пакет загружается без копирования
+    if (std::adjacent_find(first, last, [](const InsertStruct &a, const InsertStruct &b) {
+      return !(a.key < b.key);
+    }) != last) {
+      sorted.assign(first, last);
+      sortPairs(sorted, _sort_threads);
+      /// Из пар с равными ключами остается последняя, как при вставке по одной
+      auto out = sorted.begin();
+      for (auto &ex : sorted) {
+        if (out != sorted.begin() && std::prev(out)->key == ex.key) {
+          *std::prev(out) = ex;
+        } else {
+          *out++ = ex;
+        }
+      }
+      sorted.erase(out, sorted.end());
+      first = sorted.data();
+      last = first + sorted.size();
+    }
+    if (first == last) {
+      return;
+    }
+
+    /// Ключи правее дерева вставляются в правый край: при вставке в конец узлы остаются заполненными
+    if (!_data->empty()) {
+      auto back = _data->end();
+      back.prev();
+      if (back.key() < first->key) {
+        for (; first != last; ++first) {
+          _data->insert(first->key, first->value);
+        }
+        return;
+      }
+    }
+
+    /// Иначе дерево строится снизу вверх слиянием со старыми парами; старые узлы возвращаются в арену
+    PersistentTree::Builder builder(*_data);
+    auto it = _data->begin();
+    while (it.valid() || first != last) {
+      if (first == last || (it.valid() && it.key() < first->key)) {
+        builder.push(it.key(), it.value());
+        it.next();
+      } else {
+        if (it.valid() && it.key() == first->key) {
+          it.next();
+        }
+        builder.push(first->key, first->value);
+        ++first;
+      }
+    }
+    builder.finish();
+  }
+
+  status_t Simulator::insert(const InsertVector &insert_vector, flags_t flags) {
+    /// На плате пакетная вставка - отдельные команды INS
+    if (_timing || _queues) {
+      return BaseStructure::insert(insert_vector, flags);
+    }
+    /// Без ограничения памяти большой пакет загружается целиком
+    if (_capacity == 0 && (_data->empty() || insert_vector.size() * SIM_MERGE_RATIO >= _data->size())) {
+      build(insert_vector);
+      return OK;
+    }
+    for (auto &ex : insert_vector) {
+      if (!hasRoom(ex.key)) {
+        return OERR;
+      }
+      _data->insert(ex.key, ex.value);
+    }
     return OK;
   }
 
   status_t Simulator::del(key_t key, flags_t flags) {
-    _data->erase(key);
+    timed(DEL, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, DEL, flags, key)) {
+      return queued_ret.status;
+    }
+    if (_data->erase(key)) {
+      _holes++;
+      noteDeleted(1);
+    }
+    return OK;
+  }
+
+  /// SQ уплотняет блоки: ячейки удаленных пар снова свободны
+  status_t Simulator::squeeze(flags_t flags) {
+    timed(SQ, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, SQ, flags)) {
+      return queued_ret.status;
+    }
+    _holes = 0;
+    resetDeleted();
     return OK;
   }
 
+  u32 Simulator::get_holes() {
+    return _holes;
+  }
+
+  void Simulator::set_capacity(u32 cells) {
+    _capacity = cells;
+  }
+
+  void Simulator::set_timing(LatencyModel *model) {
+    _timing = model;
+  }
+
+  LatencyModel *Simulator::get_timing() {
+    return _timing;
+  }
+
+  void Simulator::set_sort_threads(u32 threads) {
+    _sort_threads = threads;
+  }
+
+  void Simulator::set_queues(SpuQueues *queues) {
+    if (_queues) {
+      _queues->forget(this);
+    }
+    _queues = queues;
+  }
+
+  SpuQueues *Simulator::get_queues() {
+    return _queues;
+  }
+
   pair_t Simulator::search(key_t key, flags_t flags) {
-    auto it = _data->find(key);
-    if (it != _data->end()) {
-      return {key, it->second};
+    timed(SRCH, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, SRCH, flags, key)) {
+      return queued_ret;
+    }
+    value_t value;
+    if (_data->get(key, value)) {
+      return {key, value};
     } else {
       return {ERR};
     }
   }
 
   pair_t Simulator::min(flags_t flags) {
+    timed(MIN, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, MIN, flags)) {
+      return queued_ret;
+    }
     auto it = _data->begin();
-    if (it != _data->end()) {
-      return {it->first, it->second};
+    if (it.valid()) {
+      return {it.key(), it.value()};
     } else {
       return {ERR};
     }
   }
 
   pair_t Simulator::max(flags_t flags) {
-    auto it = _data->rbegin();
-    if (it != _data->rend()) {
-      return {it->first, it->second};
+    timed(MAX, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, MAX, flags)) {
+      return queued_ret;
+    }
+    auto it = _data->end();
+    if (it.prev()) {
+      return {it.key(), it.value()};
     } else {
       return {ERR};
     }
   }
 
   pair_t Simulator::next(key_t key, flags_t flags) {
+    timed(NEXT, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, NEXT, flags, key)) {
+      return queued_ret;
+    }
     auto it = _data->find(key);
-    if (it != _data->end()) {
-      ++it;
-      if (it != _data->end()) {
-        return {it->first, it->second};
-      } else {
-        return {ERR};
-      }
+    if (it.valid() && it.next()) {
+      return {it.key(), it.value()};
     } else {
       return {ERR};
     }
   }
 
   pair_t Simulator::prev(key_t key, flags_t flags) {
+    timed(PREV, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, PREV, flags, key)) {
+      return queued_ret;
+    }
     auto it = _data->find(key);
-    if (it != _data->end()) {
-      --it;
-      if (it != _data->end()) {
-        return {it->first, it->second};
-      } else {
-        return {ERR};
-      }
+    if (it.valid() && it.prev()) {
+      return {it.key(), it.value()};
     } else {
       return {ERR};
     }
   }
 
   pair_t Simulator::nsm(key_t key, flags_t flags) {
+    timed(NSM, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, NSM, flags, key)) {
+      return queued_ret;
+    }
     auto it = _data->lower_bound(key);
-    --it;
-    if (it != _data->end()) {
-      return {it->first, it->second};
+    if (it.prev()) {
+      return {it.key(), it.value()};
     } else {
       return {ERR};
     }
   }
 
   pair_t Simulator::ngr(key_t key, flags_t flags) {
+    timed(NGR, flags);
+    pair_t queued_ret;
+    if (queued(queued_ret, NGR, flags, key)) {
+      return queued_ret;
+    }
     auto it = _data->upper_bound(key);
-    if (it != _data->end()) {
-      return {it->first, it->second};
+    if (it.valid()) {
+      return {it.key(), it.value()};
     } else {
       return {ERR};
     }
   }
 
 
+  /// Срез строится снизу вверх; срез в ту же структуру читает старое дерево до замены
+  status_t Simulator::sliceTo(PersistentTree::Iterator first, PersistentTree::Iterator last, BaseStructure &result) {
+    auto it = globalStructures().find(result.get_gsid());
+    if (it == globalStructures().end()) {
+      return ERR;
+    }
+    PersistentTree::Builder builder(*it->second);
+    for (; first != last; first.next()) {
+      builder.push(first.key(), first.value());
+    }
+    builder.finish();
+    return OK;
+  }
+
+  /// Операция cmd (AND, OR, NOT) над деревьями на хосте. Операнд, много меньший другого, проверяется
+  /// по индексу большего дерева, иначе ключи выгружаются в массивы и пары результата выбирает set_kernels
+  static void hostSet(cmd_t cmd, const PersistentTree &x, const PersistentTree &y,
+                      back_insert_iterator<PersistentTree::Builder> out) {
+    if (cmd != OR && (unsigned long long) x.size() * SET_GALLOP_RATIO <= y.size()) {
+      for (auto it = x.begin(); it.valid(); it.next()) {
+        if (y.contains(it.key()) == (cmd == AND)) {
+          *out++ = *it;
+        }
+      }
+      return;
+    }
+    if (cmd == AND && (unsigned long long) y.size() * SET_GALLOP_RATIO <= x.size()) {
+      value_t value;
+      for (auto it = y.begin(); it.valid(); it.next()) {
+        if (x.get(it.key(), value)) {
+          *out++ = {it.key(), value};
+        }
+      }
+      return;
+    }
+
+    vector<key_t> x_keys, y_keys;
+    vector<value_t> x_values, y_values;
+    x.flatten(x_keys, &x_values);
+    y.flatten(y_keys, cmd == OR ? &y_values : nullptr);
+    vector<u32> pos(cmd == OR ? x.size() + y.size() : x.size());
+    size_t n = cmd == AND ? setIntersect(x_keys.data(), x_keys.size(), y_keys.data(), y_keys.size(), pos.data())
+             : cmd == OR  ? setUnite(x_keys.data(), x_keys.size(), y_keys.data(), y_keys.size(), pos.data())
+             : setSubtract(x_keys.data(), x_keys.size(), y_keys.data(), y_keys.size(), pos.data());
+    for (size_t i = 0; i < n; i++) {
+      u32 at = pos[i] & ~SET_FROM_B;
+      if (pos[i] & SET_FROM_B) {
+        *out++ = {y_keys[at], y_values[at]};
+      } else {
+        *out++ = {x_keys[at], x_values[at]};
+      }
+    }
+  }
+
+  template <class Op>
+  status_t Simulator::setTo(BaseStructure &b, BaseStructure &result, Op op) {
+    auto b_it = globalStructures().find(b.get_gsid());
+    auto r_it = globalStructures().find(result.get_gsid());
+    if (b_it == globalStructures().end() || r_it == globalStructures().end()) {
+      return ERR;
+    }
+
+    /// Старое дерево result заменяется после построения, так как result может совпадать с операндом
+    PersistentTree::Builder builder(*r_it->second);
+    op(*_data, *b_it->second, back_inserter(builder));
+    builder.finish();
+    return OK;
+  }
+
+  status_t Simulator::intersect(BaseStructure &b, BaseStructure &result, flags_t flags) {
+    timed(AND, flags, _data->size() + b.get_power());
+    pair_t queued_ret;
+    if (queued(queued_ret, AND, flags, {0}, {0}, &b, &result)) {
+      return queued_ret.status;
+    }
+    return setTo(b, result, [](PersistentTree &x, PersistentTree &y, back_insert_iterator<PersistentTree::Builder> out) {
+      hostSet(AND, x, y, out);
+    });
+  }
+
+  status_t Simulator::unite(BaseStructure &b, BaseStructure &result, flags_t flags) {
+    timed(OR, flags, _data->size() + b.get_power());
+    pair_t queued_ret;
+    if (queued(queued_ret, OR, flags, {0}, {0}, &b, &result)) {
+      return queued_ret.status;
+    }
+    return setTo(b, result, [](PersistentTree &x, PersistentTree &y, back_insert_iterator<PersistentTree::Builder> out) {
+      hostSet(OR, x, y, out);
+    });
+  }
+
+  status_t Simulator::subtract(BaseStructure &b, BaseStructure &result, flags_t flags) {
+    timed(NOT, flags, _data->size() + b.get_power());
+    pair_t queued_ret;
+    if (queued(queued_ret, NOT, flags, {0}, {0}, &b, &result)) {
+      return queued_ret.status;
+    }
+    return setTo(b, result, [](PersistentTree &x, PersistentTree &y, back_insert_iterator<PersistentTree::Builder> out) {
+      hostSet(NOT, x, y, out);
+    });
+  }
+
+  status_t Simulator::ls(key_t key, BaseStructure &result, flags_t flags) {
+    timed(LS, flags, _data->size());
+    pair_t queued_ret;
+    if (queued(queued_ret, LS, flags, key, {0}, nullptr, &result)) {
+      return queued_ret.status;
+    }
+    return sliceTo(_data->begin(), _data->lower_bound(key), result);
+  }
+
+  status_t Simulator::lseq(key_t key, BaseStructure &result, flags_t flags) {
+    timed(LSEQ, flags, _data->size());
+    pair_t queued_ret;
+    if (queued(queued_ret, LSEQ, flags, key, {0}, nullptr, &result)) {
+      return queued_ret.status;
+    }
+    return sliceTo(_data->begin(), _data->upper_bound(key), result);
+  }
+
+  status_t Simulator::gr(key_t key, BaseStructure &result, flags_t flags) {
+    timed(GR, flags, _data->size());
+    pair_t queued_ret;
+    if (queued(queued_ret, GR, flags, key, {0}, nullptr, &result)) {
+      return queued_ret.status;
+    }
+    return sliceTo(_data->upper_bound(key), _data->end(), result);
+  }
+
+  status_t Simulator::greq(key_t key, BaseStructure &result, flags_t flags) {
+    timed(GREQ, flags, _data->size());
+    pair_t queued_ret;
+    if (queued(queued_ret, GREQ, flags, key, {0}, nullptr, &result)) {
+      return queued_ret.status;
+    }
+    return sliceTo(_data->lower_bound(key), _data->end(), result);
+  }
+
+  /// В режимах задержек и очередей диапазонные операции выполняются командами, как на плате
+  u32 Simulator::count(key_t from, key_t to) {
+    if (_timing || _queues) {
+      return BaseStructure::count(from, to);
+    }
+    if (from > to) {
+      return 0;
+    }
+    return _data->rank(to, true) - _data->rank(from);
+  }
+
+  BaseStructure::PairVector Simulator::scan(key_t from, key_t to, u32 count) {
+    if (_timing || _queues) {
+      return BaseStructure::scan(from, to, count);
+    }
+    PairVector ret;
+    if (from > to) {
+      return ret;
+    }
+    for (auto it = _data->lower_bound(from); it.valid() && it.key() <= to && ret.size() < count; it.next()) {
+      ret.push_back({it.key(), it.value()});
+    }
+    return ret;
+  }
+
+  BaseStructure::RangeVector Simulator::split(key_t from, key_t to, u32 parts) {
+    if (_timing || _queues) {
+      return BaseStructure::split(from, to, parts);
+    }
+    RangeVector ret;
+    if (from > to) {
+      return ret;
+    }
+    u32 first = _data->rank(from);
+    u32 total = _data->rank(to, true) - first;
+    if (total == 0) {
+      return ret;
+    }
+    parts = std::max(1u, std::min(parts, total));
+    key_t begin = from;
+    for (u32 i = 1; i < parts; i++) {
+      key_t end = _data->select(first + (u32) ((unsigned long long) total * i / parts)).key();
+      ret.push_back({begin, end});
+      begin = end;
+      --ret.back().to;
+    }
+    ret.push_back({begin, to});
+    return ret;
+  }
+
+  /// модели задержек и очередей не рассчитаны на несколько потоков
+  bool Simulator::concurrent() {
+    return !_timing && !_queues;
+  }
+
+  status_t Simulator::erase(key_t from, key_t to, flags_t flags) {
+    if (_timing || _queues) {
+      return BaseStructure::erase(from, to, flags);
+    }
+    if (from <= to) {
+      u32 count = _data->erase(from, to);
+      _holes += count;
+      noteDeleted(count);
+    }
+    return OK;
+  }
+
+  BaseStructure::PairVector Simulator::execute(const BatchVector &batch) {
+    LatencyModel::Call call(_timing);
+    PairVector ret;
+    ret.reserve(batch.size());
+    for (auto &ex : batch) {
+      ret.push_back(dispatch(ex));
+    }
+    return ret;
+  }
+
+  BaseStructure::ProgramResult Simulator::run(const ProgramVector &program, u32 out_max, u32 max_steps) {
+    LatencyModel::Call call(_timing);
+    return interpret(program, out_max, max_steps);
+  }
+
+  BaseStructure *Simulator::newStructure() {
+    auto ret = new Simulator();
+    ret->set_timing(_timing);
+    ret->set_queues(_queues);
+    return ret;
+  }
+
+  /// В режимах задержек и очередей клон - команда OR, как на плате
+  BaseStructure *Simulator::clone() {
+    if (_timing || _queues) {
+      return BaseStructure::clone();
+    }
+    auto ret = (Simulator *) newStructure();
+    ret->_data->assign(*_data);
+    ret->_capacity = _capacity;
+    return ret;
+  }
+
+
   gsid_t getNextGsid() {
     static gsid_t gsid = {0};
     ++gsid;
@@ -8,23 +8,58 @@
 
 #include <map>
 #include "../libspu/base_structure.h"
+#include "PersistentTree.h"
+#include "LatencyModel.h"
+#include "SpuQueues.h"
 
 using namespace std;
 
 namespace SPU
 {
 
-    class Simulator : public BaseStructure {
-        map<key_t, value_t> *_data = nullptr;
+/* Minimum unsorted batch that is sorted by several threads */
+#define SIM_PARALLEL_SORT_MIN 65536
+
+/* Batch of at least 1/SIM_MERGE_RATIO of structure power is merged with the tree in one pass */
+#define SIM_MERGE_RATIO 16
+
+    /// final: вызовы через Simulator (в том числе SimBackend) не виртуальны
+    class Simulator final : public BaseStructure {
+        /// пары структуры; владелец - реестр globalStructures()
+        PersistentTree *_data = nullptr;
+        /// модель фрагментации DSM: ячейки удаленных пар не освобождаются до SQ
+        u32 _holes = 0;
+        /// число ячеек DSM структуры (0 - без ограничения)
+        u32 _capacity = 0;
+
+        /// модель задержек СП (nullptr - команды выполняются мгновенно)
+        LatencyModel *_timing = LatencyModel::global();
+        /// очереди SYS2SPU и SPU2CPU (nullptr - команды выполняются сразу)
+        SpuQueues *_queues = SpuQueues::global();
+        /// потоки сортировки неупорядоченных пакетов
+        u32 _sort_threads = 1;
+
+        /// есть ли ячейка для нового ключа
+        bool hasRoom(key_t key);
+        /// учитывает время команды в модели задержек
+        void timed(cmd_t cmd, flags_t flags, u32 pairs = 0);
+        /// подает команду в очереди СП; false - команда выполняется сразу
+        bool queued(pair_t &ret, cmd_t cmd, flags_t flags, key_t key = {0}, value_t value = {0},
+                    BaseStructure *b = nullptr, BaseStructure *result = nullptr);
+        /// загрузка пакета за линейное время: упорядочивание, дописывание справа или слияние с деревом
+        void build(const InsertVector &insert_vector);
 
     public:
         explicit Simulator(bool initialize=true);
-        Simulator(Simulator &obj);
+        /// копия владела бы той же структурой СП и удалила бы её дважды
+        Simulator(const Simulator &obj) = delete;
+        Simulator& operator=(const Simulator &obj) = delete;
         ~Simulator() override;
 
         u32 get_power() override;
 
         status_t insert(key_t key, value_t value, flags_t flags = NO_FLAGS) override;
+        status_t insert(const InsertVector &insert_vector, flags_t flags = NO_FLAGS) override;
         status_t del(key_t key, flags_t flags = NO_FLAGS) override;
         pair_t search(key_t key, flags_t flags = P_FLAG) override;
         pair_t min(flags_t flags = P_FLAG) override;
@@ -33,14 +68,63 @@ namespace SPU
         pair_t prev(key_t key, flags_t flags = P_FLAG) override;
         pair_t nsm(key_t key, flags_t flags = P_FLAG) override;
         pair_t ngr(key_t key, flags_t flags = P_FLAG) override;
+        status_t squeeze(flags_t flags = P_FLAG) override;
+
+        /// ячейки удаленных пар, которые освободит SQ
+        u32 get_holes();
+        /// ограничивает память структуры: вставка нового ключа без свободной ячейки возвращает OERR
+        void set_capacity(u32 cells);
+        /// режим задержек: структура и созданные ею временные структуры ведут время по модели
+        void set_timing(LatencyModel *model);
+        LatencyModel *get_timing();
+        /// режим очередей: команды без флага P выполняются асинхронно, результаты извлекаются queues.drain()
+        void set_queues(SpuQueues *queues);
+        SpuQueues *get_queues();
+        /// потоки сортировки неупорядоченных пакетов insert(InsertVector) (0 - по числу ядер)
+        void set_sort_threads(u32 threads);
+
+        status_t intersect(BaseStructure &b, BaseStructure &result, flags_t flags = P_FLAG) override;
+        status_t unite(BaseStructure &b, BaseStructure &result, flags_t flags = P_FLAG) override;
+        status_t subtract(BaseStructure &b, BaseStructure &result, flags_t flags = P_FLAG) override;
+
+        status_t ls(key_t key, BaseStructure &result, flags_t flags = P_FLAG) override;
+        status_t lseq(key_t key, BaseStructure &result, flags_t flags = P_FLAG) override;
+        status_t gr(key_t key, BaseStructure &result, flags_t flags = P_FLAG) override;
+        status_t greq(key_t key, BaseStructure &result, flags_t flags = P_FLAG) override;
+
+        u32 count(key_t from, key_t to) override;
+        PairVector scan(key_t from, key_t to, u32 count) override;
+        /// границы - порядковые статистики дерева: диапазоны равны с точностью до ключа
+        RangeVector split(key_t from, key_t to, u32 parts) override;
+        /// дерево только читается: потоки сканируют его без блокировок
+        bool concurrent() override;
+        status_t erase(key_t from, key_t to, flags_t flags = NO_FLAGS) override;
+
+        PairVector execute(const BatchVector &batch) override;
+        /// интерпретатор LCM: программы отлаживаются и измеряются без платы
+        ProgramResult run(const ProgramVector &program, u32 out_max, u32 max_steps) override;
+
+        BaseStructure *newStructure() override;
+        /// клон за O(1): новая структура разделяет узлы дерева с текущей до их изменения
+        BaseStructure *clone() override;
+
+        /// выполняет команду очереди методами её структуры
+        static pair_t apply(const ProgramStruct &command);
 
     protected:
+        /// копирует пары из [first, last) в структуру result, замещая её содержимое
+        status_t sliceTo(PersistentTree::Iterator first, PersistentTree::Iterator last, BaseStructure &result);
+        /// выполняет операцию op над данными структур и записывает итог в result
+        template <class Op>
+        status_t setTo(BaseStructure &b, BaseStructure &result, Op op);
+
         adds_rslt_t createStructure() override;
         dels_rslt_t deleteStructure() override;
     };
 
-    /// Созданные структуры
-    extern map<gsid_t, map<key_t, value_t>*> globalStructures;
+    /// Созданные структуры. Доступны через функцию, так как структуры
+    /// могут создаваться при инициализации глобальных объектов
+    map<gsid_t, PersistentTree *> &globalStructures();
 
     gsid_t getNextGsid();
 }
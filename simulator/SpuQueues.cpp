@@ -0,0 +1,109 @@
+/*
+  SpuQueues.cpp
+        - SPU queues model implementation
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SpuQueues.h"
+#include "Simulator.h"
+
+#include <algorithm>
+
+
+namespace SPU
+{
+  SpuQueues::SpuQueues(u32 sys2spu, u32 spu2cpu) : sys_depth(sys2spu), cpu_depth(spu2cpu ? spu2cpu : 1) {
+  }
+
+  SpuQueues *&SpuQueues::global() {
+    static SpuQueues *queues = nullptr;
+    return queues;
+  }
+
+  pair_t SpuQueues::execute(const BaseStructure::ProgramStruct &command) {
+    busy = true;
+    pair_t ret = Simulator::apply(command);
+    busy = false;
+    return ret;
+  }
+
+  /// СП выполняет команды очереди, пока есть место для их результатов
+  void SpuQueues::advance() {
+    while (!commands.empty() && out.size() < cpu_depth) {
+      BaseStructure::ProgramStruct command = commands.front();
+      commands.pop_front();
+      out.push_back(execute(command));
+    }
+  }
+
+  pair_t SpuQueues::submit(const BaseStructure::ProgramStruct &command) {
+    flags_t flags = command.cmd & ~CMD_MASK;
+    if (flags & R_FLAG) {
+      reset();
+    }
+    advance();
+
+    /// СП остановлен заполненной очередью SPU2CPU
+    bool stalled = !commands.empty() || ( !(flags & P_FLAG) && out.size() >= cpu_depth );
+    if (stalled) {
+      if ((flags & Q_FLAG) && !(flags & P_FLAG)) {
+        if (commands.size() >= sys_depth) {
+          overflow++;
+          return pair_t(OERR);
+        }
+        commands.push_back(command);
+        return pair_t(OK);
+      }
+      /// Хост не дождется готовности СП
+      return pair_t(QERR);
+    }
+
+    pair_t ret = execute(command);
+    if (flags & P_FLAG) {
+      return ret;
+    }
+    out.push_back(ret);
+    return pair_t(OK);
+  }
+
+  BaseStructure::PairVector SpuQueues::drain(u32 count) {
+    BaseStructure::PairVector ret;
+    while (ret.size() < count) {
+      if (out.empty()) {
+        advance();
+        if (out.empty()) {
+          break;
+        }
+      }
+      ret.push_back(out.front());
+      out.pop_front();
+    }
+    advance();
+    return ret;
+  }
+
+  void SpuQueues::forget(BaseStructure *structure) {
+    commands.erase(std::remove_if(commands.begin(), commands.end(), [structure](const BaseStructure::ProgramStruct &ex) {
+      return ex.structure == structure || ex.b == structure || ex.result == structure;
+    }), commands.end());
+  }
+
+  void SpuQueues::reset() {
+    commands.clear();
+    out.clear();
+  }
+}
@@ -0,0 +1,78 @@
+/*
+  SpuQueues.h
+        - SYS2SPU command queue and SPU2CPU result queue model for simulator
+        - commands without P flag complete asynchronously, their results drain in order
+
+  Copyright 2019  Dubrovin Egor <dubrovin.en@ya.ru>
+                  Alex Popov <alexpopov@bmstu.ru>
+                  Bauman Moscow State Technical University
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GRAPH_API_SPU_QUEUES_H
+#define GRAPH_API_SPU_QUEUES_H
+
+#include "../libspu/base_structure.h"
+
+#include <deque>
+
+namespace SPU
+{
+
+/* Default depth of SYS2SPU command queue */
+#define SYS2SPU_DEPTH 16
+
+/* Default depth of SPU2CPU result queue */
+#define SPU2CPU_DEPTH 16
+
+    /// Очереди одного СП, общие для всех его структур.
+    /// Команда без флага P помещает результат в очередь SPU2CPU; пока она заполнена, СП стоит,
+    /// а команды с флагом Q копятся в очереди SYS2SPU. Переполнение SYS2SPU - OERR,
+    /// команда, которая не может быть выполнена из-за остановленного СП, - QERR.
+    /// Флаг R сбрасывает обе очереди перед командой
+    class SpuQueues {
+    public:
+        explicit SpuQueues(u32 sys2spu = SYS2SPU_DEPTH, u32 spu2cpu = SPU2CPU_DEPTH);
+
+        /// подает команду в СП и возвращает результат для хоста
+        pair_t submit(const BaseStructure::ProgramStruct &command);
+
+        /// извлекает не более count результатов команд без флага P в порядке их выполнения
+        BaseStructure::PairVector drain(u32 count = ~0u);
+
+        /// удаляет команды структуры, которая удаляется
+        void forget(BaseStructure *structure);
+        void reset();
+
+        u32 pending() const { return commands.size(); }     /// команды в SYS2SPU
+        u32 results() const { return out.size(); }          /// результаты в SPU2CPU
+        u32 overflows() const { return overflow; }          /// команды, отвергнутые с OERR
+        bool executing() const { return busy; }             /// СП выполняет команду очереди
+
+        /// очереди, которые получают новые структуры симулятора (nullptr - без очередей)
+        static SpuQueues *&global();
+
+    private:
+        u32 sys_depth, cpu_depth;
+        std::deque<BaseStructure::ProgramStruct> commands;
+        std::deque<pair_t> out;
+        u32 overflow = 0;
+        bool busy = false;
+
+        pair_t execute(const BaseStructure::ProgramStruct &command);
+        void advance();
+    };
+
+}
+
+#endif //GRAPH_API_SPU_QUEUES_H
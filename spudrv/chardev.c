@@ -129,14 +129,53 @@ static ssize_t cdev_write(struct file *file, const char __user *buf, size_t coun
 
   LOG_DEBUG("Character device write operation invoked");
 
+  if(!usr_cmd)
+  {
+    LOG_ERROR("Character device could not allocate command container");
+    return -ENOMEM;
+  }
+
   /* Copy command struct from user space */
   if(copy_from_user(usr_cmd, usr_buf, count))
   {
     LOG_ERROR("Character device could not copy data from user space");
+    kzfree(usr_cmd);
     return -EFAULT;
   }
   LOG_DEBUG("Character device copy command from user");
 
+  /* Batch is executed in place of the command buffer */
+  if(PURE_CMD(CMDFRMT_0(usr_cmd)->cmd) == BTCH)
+  {
+    LOG_DEBUG("Character device gave batch to execute");
+    rslt_count = execute_batch(usr_cmd, count);
+
+    if(rslt_count > 0 && copy_to_user(usr_buf, usr_cmd, rslt_count))
+    {
+      LOG_ERROR("Character device could not copy batch results into user space");
+      rslt_count = -EFAULT;
+    }
+
+    kzfree(usr_cmd);
+    return rslt_count;
+  }
+
+  /* LCM program is executed in place of the command buffer too */
+  if(PURE_CMD(CMDFRMT_0(usr_cmd)->cmd) == PRGM)
+  {
+    LOG_DEBUG("Character device gave LCM program to execute");
+    rslt_count = execute_program(usr_cmd, count);
+
+    if(rslt_count > 0 && copy_to_user(usr_buf, usr_cmd, rslt_count))
+    {
+      LOG_ERROR("Character device could not copy LCM program results into user space");
+      rslt_count = -EFAULT;
+    }
+
+    kzfree(usr_cmd);
+    return rslt_count;
+  }
+
   LOG_DEBUG("Character device gave command to execute");
   rslt_count = execute_cmd(usr_cmd, &usr_res);
 
@@ -149,20 +188,11 @@ static ssize_t cdev_write(struct file *file, const char __user *buf, size_t coun
     if(copy_to_user(usr_buf, usr_res, rslt_count))
     {
       LOG_ERROR("Character device could not copy data into user space");
-      return -EFAULT;
-    }
-    LOG_DEBUG("Character device wrote result to user");
-
-    if(usr_cmd)
-    {
-      kzfree(usr_cmd);
-      LOG_DEBUG("Delete command container");
+      rslt_count = -EFAULT;
     }
-
-    if(usr_res)
+    else
     {
-      kzfree(usr_res);
-      LOG_DEBUG("Delete result container");
+      LOG_DEBUG("Character device wrote result to user");
     }
   }
   else
@@ -170,5 +200,14 @@ static ssize_t cdev_write(struct file *file, const char __user *buf, size_t coun
     LOG_ERROR("Character device got no result of an operation");
   }
 
+  /* Command and result are deleted on every exit, execute_cmd frees result of failed command itself */
+  kzfree(usr_cmd);
+  LOG_DEBUG("Delete command container");
+  if(usr_res)
+  {
+    kzfree(usr_res);
+    LOG_DEBUG("Delete result container");
+  }
+
   return rslt_count;
 }
\ No newline at end of file
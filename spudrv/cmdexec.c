@@ -23,7 +23,13 @@
 #define LOG_OBJECT "command execution"
 
 #include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
+#include <linux/sched/signal.h>
+#endif
 #include <linux/delay.h>
+#include <linux/string.h>
 
 #include "spu.h"
 #include "log.h"
@@ -38,6 +44,8 @@ static int init_burst_w(struct pci_burst *pci_burst, u8 cmd, const void *cmd_buf
 static int init_burst_r(struct pci_burst *pci_burst, u8 cmd);
 static int poll_spu(u8 reg, u8 shift, u8 *state);
 static void set_rsltfrmt(struct pci_burst *pci_burst, u8 cmd, const void *res_buf, u8 spu_status);
+static int init_lcm_slot(union batch_slot *slot, const struct lcm_instr *instr, const struct lcm_str *strs,
+                         u32 str_count, const spu_key_t *key, const val_t *val);
 
 /* Commands execution in command workflow */
 size_t execute_cmd(const void *cmd_buf, const void **res_buf)
@@ -64,7 +72,12 @@ size_t execute_cmd(const void *cmd_buf, const void **res_buf)
   LOG_DEBUG("Executing command 0x%02x with Q=%d, R=%d, P=%d", PURE_CMD(cmd), GET_Q_FLAG(cmd), GET_R_FLAG(cmd), GET_P_FLAG(cmd)); 
 
   /* Allocate result structure with pulling */
+  *res_buf  = NULL;
   rslt_size = alloc_rslt(res_buf, cmd);
+  if((ssize_t)rslt_size <= 0)
+  {
+    return rslt_size;
+  }
 
   /* Special case ADDS command - no PCI transactions need */
   if(PURE_CMD(cmd) == ADDS)
@@ -77,14 +90,16 @@ size_t execute_cmd(const void *cmd_buf, const void **res_buf)
   if(init_burst_w(&pci_burst_w, cmd, cmd_buf) != 0)
   {
     LOG_ERROR("Could not initialize to-write burst structure");
-    return -ENOMEM;
+    rslt_size = -ENOMEM;
+    goto kill;
   }  
 
   /* Init burst to-read structure */
   if(init_burst_r(&pci_burst_r, cmd) != 0)
   {
     LOG_ERROR("Could not initialize burst to-read structure");
-    return -ENOMEM;
+    rslt_size = -ENOMEM;
+    goto kill;
   }
   LOG_DEBUG("PCI burst structures initialized");
 
@@ -95,7 +110,8 @@ size_t execute_cmd(const void *cmd_buf, const void **res_buf)
     if(poll_spu(STATE_REG_1, SYS2SPU_Q_EMP_FLAG, &spu_state) != 0)
     {
       LOG_ERROR("SPU queue is not ready for operation");
-      return -ENOEXEC;
+      rslt_size = -ENOEXEC;
+      goto kill;
     }
     LOG_DEBUG("SPU queue is ready for operation");
   }
@@ -104,7 +120,8 @@ size_t execute_cmd(const void *cmd_buf, const void **res_buf)
   if(poll_spu(STATE_REG_0, SPU_READY_FLAG, &spu_state) != 0)
   {
     LOG_ERROR("SPU is not ready for operation");
-    return -ENOEXEC;
+    rslt_size = -ENOEXEC;
+    goto kill;
   }
   LOG_DEBUG("SPU is ready for operation");
 
@@ -120,7 +137,8 @@ size_t execute_cmd(const void *cmd_buf, const void **res_buf)
     if(poll_spu(STATE_REG_0, SPU_READY_FLAG, &spu_status) != 0)
     {
       LOG_ERROR("SPU can not finish operation");
-      return -ENOEXEC;
+      rslt_size = -ENOEXEC;
+      goto kill;
     }
     LOG_DEBUG("SPU finish operation");
 
@@ -134,6 +152,14 @@ size_t execute_cmd(const void *cmd_buf, const void **res_buf)
     LOG_DEBUG("Would not poll operation end");
   }
 
+kill:
+  /* Result of failed command is not returned to caller */
+  if((ssize_t)rslt_size < 0)
+  {
+    kzfree(*res_buf);
+    *res_buf = NULL;
+  }
+
   /* Kill burst structures */
   if(pci_burst_w.addr_shift)
   {
@@ -157,6 +183,299 @@ size_t execute_cmd(const void *cmd_buf, const void **res_buf)
   return rslt_size;
 }
 
+/* Batch of commands execution: every slot gets result of its command */
+/* Returns size of results or negative error code */
+ssize_t execute_batch(void *cmd_buf, size_t count)
+{
+  union batch_slot *slots = (union batch_slot *)( CMDFRMT_B(cmd_buf) + 1 );
+  const void *res_buf;
+  ssize_t rslt_size;
+  u32 cmd_count, i;
+
+  /* Header is read only when it was written */
+  if(count < sizeof(struct cmdfrmt_b))
+  {
+    LOG_ERROR("Batch header does not fit into %ld bytes", (unsigned long int)count);
+    return -EINVAL;
+  }
+  cmd_count = CMDFRMT_B(cmd_buf)->count;
+
+  LOG_DEBUG("Executing batch of %d commands", cmd_count);
+
+  /* Check batch size */
+  if(cmd_count > SPU_BATCH_MAX || sizeof(struct cmdfrmt_b) + cmd_count*sizeof(union batch_slot) > count)
+  {
+    LOG_ERROR("Batch of %d commands does not fit into %ld bytes", cmd_count, (unsigned long int)count);
+    return -EINVAL;
+  }
+
+  /* Execute commands in order and place results into their slots */
+  for(i=0; i<cmd_count; i++)
+  {
+    res_buf   = NULL;
+    rslt_size = execute_cmd(&slots[i], &res_buf);
+    if(rslt_size <= 0 || !res_buf)
+    {
+      LOG_ERROR("Batch command %d was not executed", i);
+      kzfree(res_buf);
+      slots[i].rslt_1.rslt = ERR;
+      continue;
+    }
+
+    memcpy(&slots[i], res_buf, rslt_size);
+    kzfree(res_buf);
+  }
+
+  /* Header gets result format 1 with count of executed commands */
+  RSLTFRMT_1(cmd_buf)->rslt  = OK;
+  RSLTFRMT_1(cmd_buf)->power = cmd_count;
+  LOG_DEBUG("Batch executed");
+
+  return sizeof(struct cmdfrmt_b) + cmd_count*sizeof(union batch_slot);
+}
+
+/* LCM program execution: instructions and jumps run in driver without returns to user space */
+/* Returns size of program with results or negative error code */
+ssize_t execute_program(void *cmd_buf, size_t count)
+{
+  struct cmdfrmt_p head;
+  struct lcm_str *strs;
+  struct lcm_instr *code;
+  struct rsltfrmt_2 *out;
+  size_t prgm_size;
+  const struct lcm_instr *instr;
+  union batch_slot slot;
+  const void *res_buf;
+  ssize_t rslt_size;
+  spu_key_t last_key;
+  val_t last_val;
+  rslt_t status = OK, last = OK;
+  u32 pc = 0, steps = 0, out_count = 0, str, i;
+  int jump;
+
+  /* Header is read only when it was written */
+  if(count < sizeof(struct cmdfrmt_p))
+  {
+    LOG_ERROR("LCM program header does not fit into %ld bytes", (unsigned long int)count);
+    return -EINVAL;
+  }
+  head = *CMDFRMT_P(cmd_buf);
+  strs = (struct lcm_str *)( CMDFRMT_P(cmd_buf) + 1 );
+  code = (struct lcm_instr *)( strs + head.str_count );
+  out  = (struct rsltfrmt_2 *)( code + head.count );
+  prgm_size = sizeof(struct cmdfrmt_p) + (size_t)head.str_count*sizeof(struct lcm_str) +
+              (size_t)head.count*sizeof(struct lcm_instr) + (size_t)head.out_max*sizeof(struct rsltfrmt_2);
+
+  LOG_DEBUG("Executing LCM program of %d instructions over %d structures", head.count, head.str_count);
+
+  /* Check program size */
+  if(head.count > LCM_SIZE || head.str_count > SPU_STR_NUM || prgm_size > count)
+  {
+    LOG_ERROR("LCM program of %d instructions does not fit into %ld bytes", head.count, (unsigned long int)count);
+    return -EINVAL;
+  }
+
+  memset(&last_key, 0, sizeof(last_key));
+  memset(&last_val, 0, sizeof(last_val));
+  for(i=0; i<head.str_count; i++)
+  {
+    strs[i].deleted  = 0;
+    strs[i].squeezed = 0;
+  }
+
+  /* Steps are limited by driver: program runs in kernel thread */
+  if(head.max_steps > LCM_MAX_STEPS)
+  {
+    head.max_steps = LCM_MAX_STEPS;
+  }
+
+  while(pc < head.count)
+  {
+    if(steps == head.max_steps)
+    {
+      LOG_ERROR("LCM program exceeded %d steps", head.max_steps);
+      status = ERR;
+      break;
+    }
+    if(fatal_signal_pending(current))
+    {
+      LOG_ERROR("LCM program was interrupted by signal");
+      status = ERR;
+      break;
+    }
+    steps++;
+    instr = &code[pc];
+
+    /* Jumps are resolved by last status */
+    if(PURE_CMD(instr->cmd) == JT)
+    {
+      if(instr->opt & LCM_IF_OK)
+      {
+        jump = (last == OK);
+      }
+      else if(instr->opt & LCM_IF_ERR)
+      {
+        jump = (last != OK);
+      }
+      else
+      {
+        jump = 1;
+      }
+      pc = jump ? instr->target : pc + 1;
+      continue;
+    }
+
+    /* Command with key and value of instruction or last found pair */
+    if(init_lcm_slot(&slot, instr, strs, head.str_count,
+                     (instr->opt & LCM_KEY_LAST) ? &last_key : &instr->key,
+                     (instr->opt & LCM_VAL_LAST) ? &last_val : &instr->val) != 0)
+    {
+      LOG_ERROR("LCM instruction %d is not valid", pc);
+      status = ERR;
+      break;
+    }
+
+    res_buf   = NULL;
+    rslt_size = execute_cmd(&slot, &res_buf);
+    if(rslt_size <= 0 || !res_buf)
+    {
+      LOG_ERROR("LCM instruction %d was not executed", pc);
+      kzfree(res_buf);
+      status = ERR;
+      break;
+    }
+    memcpy(&slot, res_buf, rslt_size);
+    kzfree(res_buf);
+    last = slot.rslt_0.rslt;
+
+    /* Power belongs to result structure of set and slice commands */
+    str = instr->str_a;
+    switch(PURE_CMD(instr->cmd))
+    {
+      CASE_CMDFRMT_4:
+      CASE_CMDFRMT_5:
+        str = instr->str_r;
+        break;
+    }
+    switch(PURE_CMD(instr->cmd))
+    {
+      CASE_RSLTFRMT_1:
+        strs[str].power = slot.rslt_1.power;
+        break;
+
+      CASE_RSLTFRMT_2:
+        strs[str].power = slot.rslt_2.power;
+        break;
+    }
+
+    if(last == OK)
+    {
+      switch(PURE_CMD(instr->cmd))
+      {
+        case DEL:
+          strs[str].deleted++;
+          break;
+
+        case SQ:
+          strs[str].deleted  = 0;
+          strs[str].squeezed = 1;
+          break;
+
+        CASE_LCM_PAIR:
+          last_key = slot.rslt_2.key;
+          last_val = slot.rslt_2.val;
+
+          if(instr->opt & LCM_OUT)
+          {
+            if(out_count == head.out_max)
+            {
+              LOG_ERROR("LCM program output is full");
+              status = OERR;
+              break;
+            }
+            out[out_count++] = slot.rslt_2;
+          }
+          break;
+      }
+      if(status != OK)
+      {
+        break;
+      }
+    }
+
+    pc++;
+    cond_resched();
+  }
+
+  /* Header gets result format P */
+  RSLTFRMT_P(cmd_buf)->rslt      = status;
+  RSLTFRMT_P(cmd_buf)->steps     = steps;
+  RSLTFRMT_P(cmd_buf)->out_count = out_count;
+  LOG_DEBUG("LCM program executed in %d steps", steps);
+
+  return prgm_size;
+}
+
+/* Initialize command of LCM instruction with polling: program needs its status */
+static int init_lcm_slot(union batch_slot *slot, const struct lcm_instr *instr, const struct lcm_str *strs,
+                         u32 str_count, const spu_key_t *key, const val_t *val)
+{
+  u8 cmd = instr->cmd | P_FLAG;
+
+  if(instr->str_a >= str_count || PURE_CMD(cmd) == DELS)
+  {
+    return -EINVAL;
+  }
+
+  switch(PURE_CMD(cmd))
+  {
+    CASE_CMDFRMT_1:
+      slot->frmt_1.cmd  = cmd;
+      slot->frmt_1.gsid = strs[instr->str_a].gsid;
+      slot->frmt_1.key  = *key;
+      slot->frmt_1.val  = *val;
+      break;
+
+    CASE_CMDFRMT_2:
+      slot->frmt_2.cmd  = cmd;
+      slot->frmt_2.gsid = strs[instr->str_a].gsid;
+      slot->frmt_2.key  = *key;
+      break;
+
+    CASE_CMDFRMT_3:
+      slot->frmt_3.cmd  = cmd;
+      slot->frmt_3.gsid = strs[instr->str_a].gsid;
+      break;
+
+    CASE_CMDFRMT_4:
+      if(instr->str_b >= str_count || instr->str_r >= str_count)
+      {
+        return -EINVAL;
+      }
+      slot->frmt_4.cmd    = cmd;
+      slot->frmt_4.gsid_a = strs[instr->str_a].gsid;
+      slot->frmt_4.gsid_b = strs[instr->str_b].gsid;
+      slot->frmt_4.gsid_r = strs[instr->str_r].gsid;
+      break;
+
+    CASE_CMDFRMT_5:
+      if(instr->str_r >= str_count)
+      {
+        return -EINVAL;
+      }
+      slot->frmt_5.cmd    = cmd;
+      slot->frmt_5.gsid_a = strs[instr->str_a].gsid;
+      slot->frmt_5.gsid_r = strs[instr->str_r].gsid;
+      slot->frmt_5.key    = *key;
+      break;
+
+    default:
+      return -ENOEXEC;
+  }
+
+  return 0;
+}
+
 /* Allocate result structure */
 static size_t alloc_rslt(const void **res_buf, u8 cmd)
 {
@@ -323,8 +642,8 @@ static int init_burst_w(struct pci_burst *pci_burst, u8 cmd, const void *cmd_buf
         return -ENOKEY;
       }
 
-      /* Burst count formula: cmd/str */
-      count = 1;
+      /* Burst count formula: key + cmd/str */
+      count = SPU_WEIGHT + 1;
       break;
 
     default:
@@ -409,11 +728,18 @@ static int init_burst_w(struct pci_burst *pci_burst, u8 cmd, const void *cmd_buf
     CASE_CMDFRMT_5:
       LOG_DEBUG("Initialize to-write burst structure for command format 5");
 
-      /* Last just a command */
-      pci_burst->addr_shift[0] = CMD_REG;
-      pci_burst->data[0]       = CMD_SHIFT( SPU_CMD( CMDFRMT_5(cmd_buf)->cmd ) ) |
-                                 STR_A_SHIFT(str_a) |
-                                 STR_R_SHIFT(str_r);
+      /* Slice bound is a key */
+      for(i=0; i<SPU_WEIGHT; i++)
+      {
+        pci_burst->addr_shift[i] = KEY_REG + i;
+        pci_burst->data[i]       = CMDFRMT_5(cmd_buf)->key.cont[i];
+      }
+
+      /* Last one is a command */
+      pci_burst->addr_shift[count-1] = CMD_REG;
+      pci_burst->data[count-1]       = CMD_SHIFT( SPU_CMD( CMDFRMT_5(cmd_buf)->cmd ) ) |
+                                       STR_A_SHIFT(str_a) |
+                                       STR_R_SHIFT(str_r);
 
       break;
 
@@ -31,7 +31,8 @@
                        case NGR
 #define CASE_CMDFRMT_3 case DELS:\
                        case MIN:\
-                       case MAX
+                       case MAX:\
+                       case SQ
 #define CASE_CMDFRMT_4 case AND:\
                        case OR:\
                        case NOT
@@ -50,7 +51,8 @@
                         case LS:\
                         case LSEQ:\
                         case GR:\
-                        case GREQ
+                        case GREQ:\
+                        case SQ
 #define CASE_RSLTFRMT_2 case SRCH:\
                         case DEL:\
                         case MIN:\
@@ -60,6 +62,15 @@
                         case NSM:\
                         case NGR
 
+/* Macro to switch across LCM program commands which find pair */
+#define CASE_LCM_PAIR case SRCH:\
+                      case MIN:\
+                      case MAX:\
+                      case NEXT:\
+                      case PREV:\
+                      case NSM:\
+                      case NGR
+
 /* Type transform macros */
 #define CMDFRMT_0(ptr)  ( (struct cmdfrmt_0 *) ptr )
 #define CMDFRMT_1(ptr)  ( (struct cmdfrmt_1 *) ptr )
@@ -67,9 +78,12 @@
 #define CMDFRMT_3(ptr)  ( (struct cmdfrmt_3 *) ptr )
 #define CMDFRMT_4(ptr)  ( (struct cmdfrmt_4 *) ptr )
 #define CMDFRMT_5(ptr)  ( (struct cmdfrmt_5 *) ptr )
+#define CMDFRMT_B(ptr)  ( (struct cmdfrmt_b *) ptr )
+#define CMDFRMT_P(ptr)  ( (struct cmdfrmt_p *) ptr )
 #define RSLTFRMT_0(ptr) ( (struct rsltfrmt_0 *) ptr )
 #define RSLTFRMT_1(ptr) ( (struct rsltfrmt_1 *) ptr )
 #define RSLTFRMT_2(ptr) ( (struct rsltfrmt_2 *) ptr )
+#define RSLTFRMT_P(ptr) ( (struct rsltfrmt_p *) ptr )
 
 /* Flag helpers */
 #define PURE_CMD(cmd)   ( cmd&CMD_MASK )
@@ -82,5 +96,7 @@
 #define SPU_FLAG(state, shift) ( state & (1<<shift) )
 
 size_t execute_cmd(const void *cmd_buf, const void **res_buf);
+ssize_t execute_batch(void *cmd_buf, size_t count);
+ssize_t execute_program(void *cmd_buf, size_t count);
 
 #endif /* CMDEXEC_H */
\ No newline at end of file
@@ -0,0 +1,89 @@
+//
+// Arena tests: inline block before heap, reuse of freed elements, heap bounded under steady
+// allocations and frees, alignment and release
+//
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <vector>
+#include "check.h"
+#include "../simulator/Arena.h"
+
+using namespace std;
+using namespace SPU;
+
+bool aligned(void *p) {
+  return (uintptr_t) p % alignof(std::max_align_t) == 0;
+}
+
+/// Небольшая арена не берет памяти из кучи
+void test_inline() {
+  Arena arena;
+  std::size_t taken = 0;
+  while (taken + 48 <= ARENA_INLINE_BYTES) {
+    void *p = arena.allocate(40);
+    CHECK(aligned(p));
+    memset(p, 0xab, 40);
+    taken += 48;
+  }
+  CHECK(arena.heap_bytes() == 0);
+  arena.allocate(ARENA_INLINE_BYTES);
+  CHECK(arena.heap_bytes() >= ARENA_FIRST_BLOCK);
+}
+
+/// Освобожденный элемент выдается следующим выделением того же размера
+void test_reuse() {
+  Arena arena;
+  vector<void *> live;
+  for (int i = 0; i < 1000; i++) {
+    live.push_back(arena.allocate(24));
+  }
+  std::size_t heap = arena.heap_bytes();
+
+  void *freed = live[500];
+  arena.deallocate(freed, 24);
+  CHECK(arena.allocate(24) == freed);
+
+  /// Освобождения и выделения при постоянном числе живых элементов не растят кучу
+  set<void *> addresses(live.begin(), live.end());
+  for (int round = 0; round < 100; round++) {
+    for (std::size_t i = round % 2; i < live.size(); i += 2) {
+      arena.deallocate(live[i], 24);
+    }
+    for (std::size_t i = round % 2; i < live.size(); i += 2) {
+      live[i] = arena.allocate(24);
+      CHECK(addresses.count(live[i]) == 1);
+    }
+  }
+  CHECK(arena.heap_bytes() == heap);
+  CHECK(set<void *>(live.begin(), live.end()).size() == live.size());
+}
+
+/// Блоки удваиваются, большое выделение получает блок по размеру
+void test_blocks() {
+  Arena arena;
+  for (int i = 0; i < 20000; i++) {
+    void *p = arena.allocate(64);
+    CHECK(aligned(p));
+  }
+  std::size_t heap = arena.heap_bytes();
+  CHECK(heap >= 20000 * 64 - ARENA_INLINE_BYTES && heap < 2 * 20000 * 64 + ARENA_MAX_BLOCK);
+
+  void *big = arena.allocate(3 * ARENA_MAX_BLOCK);
+  memset(big, 0, 3 * ARENA_MAX_BLOCK);
+  CHECK(aligned(big) && arena.heap_bytes() >= heap + 3 * ARENA_MAX_BLOCK);
+
+  /// После release арена снова начинается со своего блока
+  arena.release();
+  CHECK(arena.heap_bytes() == 0);
+  arena.allocate(64);
+  CHECK(arena.heap_bytes() == 0);
+}
+
+int main() {
+  test_inline();
+  test_reuse();
+  test_blocks();
+  return check_report("arena");
+}
@@ -0,0 +1,109 @@
+//
+// Bitset tests: single bits, counts, set bits iteration and word-wise operations against std::bitset
+// for every width, bits above width from data words and operands of other width
+//
+
+#include <bitset>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "../libspu/bitset.hpp"
+#include "../libspu/data_container_operators.h"
+
+using namespace std;
+using namespace SPU;
+
+using Reference = std::bitset<BITSET_MAX_WIDTH>;
+
+/// Случайные биты ширины width с заданной вероятностью единиц
+Reference random_bits(mt19937_64 &gen, u32 width, unsigned percent) {
+  Reference ret;
+  for (u32 i = 0; i < width; i++) {
+    ret[i] = gen() % 100 < percent;
+  }
+  return ret;
+}
+
+Bitset to_bitset(const Reference &ref, u32 width) {
+  Bitset ret(width);
+  for (u32 i = 0; i < BITSET_MAX_WIDTH; i++) {
+    ret.set(i, ref[i]);
+  }
+  return ret;
+}
+
+/// Биты, число, первый бит и обход совпадают с std::bitset
+bool same(const Bitset &bits, const Reference &ref) {
+  vector<u32> iterated, expected;
+  for (u32 idx : bits) {
+    iterated.push_back(idx);
+  }
+  for (u32 i = 0; i < BITSET_MAX_WIDTH; i++) {
+    if (bits.test(i) != ref[i]) {
+      return false;
+    }
+    if (ref[i]) {
+      expected.push_back(i);
+    }
+  }
+  u32 first = ref.none() ? bits.size() : expected.front();
+  return bits.count() == ref.count() && bits.any() == ref.any() && bits.none() == ref.none() &&
+         bits.first() == first && iterated == expected;
+}
+
+void test_widths() {
+  mt19937_64 gen(17);
+  for (u32 width = 0; width <= BITSET_MAX_WIDTH; width++) {
+    for (unsigned percent : { 0u, 3u, 50u, 97u, 100u }) {
+      Reference a = random_bits(gen, width, percent);
+      Reference b = random_bits(gen, width, 50);
+      Bitset x = to_bitset(a, width);
+      Bitset y = to_bitset(b, width);
+      CHECK(x.size() == width);
+      CHECK(same(x, a));
+
+      CHECK(same(x & y, a & b));
+      CHECK(same(x | y, a | b));
+      CHECK(same(x ^ y, a ^ b));
+      CHECK(same(x - y, a & ~b));
+      CHECK((x == y) == (a == b));
+
+      /// Биты выше ширины в данных отбрасываются, в том числе у операнда большей ширины
+      data_t ones;
+      for (u32 i = 0; i < SPU_WEIGHT; i++) {
+        ones[i] = ~0u;
+      }
+      Bitset full(ones, width);
+      Reference all;
+      for (u32 i = 0; i < width; i++) {
+        all[i] = true;
+      }
+      CHECK(same(full, all));
+      CHECK(same(x | Bitset(ones, BITSET_MAX_WIDTH), all));
+      CHECK(same(x ^ Bitset(ones, BITSET_MAX_WIDTH), all & ~a));
+      CHECK(same(Bitset((data_t) x, width), a));
+
+      /// Установка и сброс отдельных битов, индекс вне ширины игнорируется
+      Bitset z = x;
+      Reference c = a;
+      for (int i = 0; i < 20; i++) {
+        u32 idx = gen() % (BITSET_MAX_WIDTH + 4);
+        bool value = gen() % 2;
+        z.set(idx, value);
+        if (idx < width) {
+          c[idx] = value;
+        }
+      }
+      if (width > 0) {
+        z.reset(width - 1);
+        c[width - 1] = false;
+      }
+      CHECK(same(z, c));
+    }
+  }
+}
+
+int main() {
+  test_widths();
+  return check_report("bitset");
+}
@@ -0,0 +1,26 @@
+//
+// Minimal checks of unit tests: failed condition is printed, exit code is the count of failures
+//
+
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <iostream>
+
+static int check_failures = 0;
+
+#define CHECK(cond)                                                                  \
+  do {                                                                               \
+    if (!(cond)) {                                                                   \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl; \
+      check_failures++;                                                              \
+    }                                                                                \
+  } while (0)
+
+/// итог теста: код возврата main
+inline int check_report(const char *name) {
+  std::cout << name << ": " << (check_failures ? "FAILED" : "OK") << std::endl;
+  return check_failures ? 1 : 0;
+}
+
+#endif //TESTS_CHECK_H
@@ -0,0 +1,92 @@
+//
+// Clustering tests: clusters and segments of keys against clusters of sorted std::set,
+// keys on the edges of key range
+//
+
+#include <limits>
+#include <random>
+#include <set>
+#include <vector>
+#include "check.h"
+#include "../libspu/clustering.hpp"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+/// Кластеры по std::set: соседние ключи кластера отстоят не более чем на gap
+template <class K>
+vector<vector<K>> reference(const set<K> &keys, K gap) {
+  vector<vector<K>> ret;
+  for (K key : keys) {
+    if (ret.empty() || (long double) key - ret.back().back() > gap) {
+      ret.push_back({});
+    }
+    ret.back().push_back(key);
+  }
+  return ret;
+}
+
+/// Скопления ключей со случайными промежутками больше и меньше gap, крайние ключи типа K
+template <class K>
+void check_keys(unsigned seed, K gap, long long centre) {
+  Simulator structure;
+  set<K> keys = { numeric_limits<K>::min(), numeric_limits<K>::max() };
+  mt19937_64 gen(seed);
+  long long at = centre;
+  for (int group = 0; group < 40; group++) {
+    at += gap + 1 + gen() % (4 * gap);
+    for (int i = 0, n = 1 + gen() % 30; i < n; i++) {
+      at += gen() % (gap + 1);
+      keys.insert((K) at);
+    }
+  }
+  for (K key : keys) {
+    structure.insert(encode(key), encode(key));
+  }
+
+  auto expected = reference(keys, gap);
+  ClusterVector found = clusters(structure, gap);
+  CHECK(found.size() == expected.size());
+  for (std::size_t i = 0; i < found.size() && i < expected.size(); i++) {
+    CHECK(decodeKey<K>(found[i].first) == expected[i].front());
+    CHECK(decodeKey<K>(found[i].last) == expected[i].back());
+    CHECK(found[i].count == expected[i].size());
+  }
+
+  /// Каждый кластер срезается в свою структуру
+  vector<BaseStructure *> parts;
+  ClusterVector segmented;
+  CHECK(segment(structure, gap, parts, &segmented) == OK);
+  CHECK(parts.size() == expected.size() && segmented.size() == expected.size());
+  for (std::size_t i = 0; i < parts.size() && i < expected.size(); i++) {
+    CHECK(parts[i]->get_power() == expected[i].size() && segmented[i].count == expected[i].size());
+    CHECK(decodeKey<K>(parts[i]->min().key) == expected[i].front());
+    CHECK(decodeKey<K>(parts[i]->max().key) == expected[i].back());
+    delete parts[i];
+  }
+  CHECK(structure.get_power() == keys.size());
+}
+
+/// Пустая структура не имеет кластеров, gap 0 дает кластер на каждый ключ
+void test_edges() {
+  Simulator structure;
+  CHECK(clusters(structure, 5u).empty());
+
+  set<u32> keys = { 1, 2, 3, 10, 11, 20 };
+  for (u32 key : keys) {
+    structure.insert(encode(key), encode(key));
+  }
+  CHECK(clusters(structure, 0u).size() == keys.size());
+  CHECK(clusters(structure, 1u).size() == 3);
+  CHECK(clusters(structure, numeric_limits<u32>::max()).size() == 1);
+}
+
+int main() {
+  check_keys<u32>(7, 100, 1000);
+  check_keys<int>(8, 50, -3000);
+  check_keys<long long>(9, 1000000, -1ll << 40);
+  test_edges();
+  return check_report("clustering");
+}
@@ -0,0 +1,68 @@
+//
+// External sort tests: sorted keys with repeats against std::sort, with keys in one shard,
+// in several shards and spilled to host runs
+//
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "../libspu/external_sort.hpp"
+#include "../libspu/data_container_operators.h"
+
+using namespace std;
+using namespace SPU;
+
+/// Ключи добавляются в ExternalSort с заданными лимитами и сравниваются с std::sort
+template <class K>
+void check_sort(const vector<K> &keys, u32 shard_keys, u32 shards, u32 batch, bool spilled) {
+  ExternalSort<K> sorter(shard_keys, shards, batch);
+  for (auto &ex : keys) {
+    sorter.push(ex);
+  }
+  vector<K> expected = keys;
+  sort(expected.begin(), expected.end());
+
+  CHECK(sorter.size() == keys.size());
+  CHECK(sorter.sorted() == expected);
+  CHECK(sorter.shardCount() <= shards);
+  CHECK((sorter.runCount() > 0) == spilled);
+
+  vector<K> emitted;
+  sorter.emit([&emitted](const K &key) { emitted.push_back(key); });
+  CHECK(emitted == expected);
+}
+
+void test_sort() {
+  mt19937_64 gen(16);
+  vector<long long> keys;
+  for (int i = 0; i < 20000; i++) {
+    /// Повторы ключей внутри пакета и между пакетами
+    keys.push_back((long long) (gen() % 5000) - 2500);
+  }
+  check_sort(keys, SORT_SHARD_KEYS, SPU_STR_NUM - 1, SORT_BATCH_SIZE, false);
+  check_sort(keys, 3000, 6, 333, false);
+  check_sort(keys, 500, 3, 100, true);
+  check_sort(keys, 1, 1, 1, true);
+
+  vector<double> reals;
+  uniform_real_distribution<double> real(-1e3, 1e3);
+  for (int i = 0; i < 5000; i++) {
+    reals.push_back(i % 3 ? real(gen) : (double) (gen() % 10));
+  }
+  check_sort(reals, 700, 2, 256, true);
+
+  vector<string> strings;
+  for (int i = 0; i < 3000; i++) {
+    strings.push_back(to_string(gen() % 1000));
+  }
+  check_sort(strings, 200, 4, 64, true);
+
+  check_sort(vector<u32>(), 10, 2, 4, false);
+}
+
+int main() {
+  test_sort();
+  return check_report("external_sort");
+}
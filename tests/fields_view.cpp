@@ -0,0 +1,134 @@
+//
+// Fields view tests: reads and writes of fields, fields crossing word boundaries and nested layouts
+// against bit by bit reference, pack() against Fields
+//
+
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "../libspu/fields.hpp"
+#include "../libspu/fields_view.hpp"
+#include "../libspu/data_container_operators.h"
+
+using namespace std;
+using namespace SPU;
+
+bool bit(const data_t &data, u32 idx) {
+  return idx < SPU_WEIGHT * 32 && (data[idx / 32] >> (idx % 32)) & 1;
+}
+
+/// Разряды [offset, offset + width) по одному биту
+unsigned long long reference_get(const data_t &data, u32 offset, u32 width) {
+  unsigned long long ret = 0;
+  for (u32 i = 0; i < width && i < 64; i++) {
+    ret |= (unsigned long long) bit(data, offset + i) << i;
+  }
+  return ret;
+}
+
+void reference_set(data_t &data, u32 offset, u32 width, unsigned long long value) {
+  for (u32 i = 0; i < width && offset + i < SPU_WEIGHT * 32; i++) {
+    u32 idx = offset + i;
+    bool on = i < 64 && (value >> i) & 1;
+    data[idx / 32] = (data[idx / 32] & ~(1u << (idx % 32))) | (u32) on << (idx % 32);
+  }
+}
+
+data_t random_data(mt19937_64 &gen) {
+  data_t ret;
+  for (u32 i = 0; i < SPU_WEIGHT; i++) {
+    ret[i] = (u32) gen();
+  }
+  return ret;
+}
+
+/// Чтение и запись каждого поля раскладки, размещенной с base разряда
+void check_layout(mt19937_64 &gen, FieldsLength<string> length, const vector<string> &names, u32 base = 0) {
+  for (int round = 0; round < 200; round++) {
+    data_t data = random_data(gen);
+    data_t expected = data;
+    FieldsView<string> view(data, length, base);
+    CHECK(reference_get((data_t) view, 0, length.width()) == reference_get(data, base, length.width()));
+
+    for (auto &name : names) {
+      field_pos_t pos = view.position(name);
+      CHECK(pos.offset == base + length.offset(name));
+      CHECK(view.get(name) == reference_get(data, pos.offset, pos.width));
+      CHECK(view.get(pos) == view.get(name));
+      CHECK(reference_get(view.getData(name), 0, 64) == view.get(name));
+
+      Bitset bits = view.bitset(name);
+      CHECK(bits.size() == pos.width);
+      for (u32 i = 0; i < pos.width; i++) {
+        CHECK(bits.test(i) == bit(data, pos.offset + i));
+      }
+
+      /// Запись поля не меняет остальных разрядов
+      unsigned long long value = gen();
+      if (round % 2) {
+        view.set(name, value);
+      } else {
+        view.set(name, (data_t) BitFlow(value));
+      }
+      reference_set(expected, pos.offset, pos.width, value);
+      CHECK(data == expected);
+    }
+  }
+}
+
+/// Поля в одном слове, поля через границу слова, поле во все разряды ключа
+void test_layouts() {
+  mt19937_64 gen(18);
+  check_layout(gen, { { "a", 5 }, { "b", 27 }, { "c", 7 }, { "d", 25 } }, { "a", "b", "c", "d" });
+  check_layout(gen, { { "x", 3 }, { "y", 40 }, { "z", 21 } }, { "x", "y", "z" });
+  check_layout(gen, { { "w", 64 } }, { "w" });
+  check_layout(gen, { { "p", 13 }, { "q", 27 } }, { "p", "q" }, 11);
+}
+
+/// Вложенная раскладка - вид на те же данные со смещением поля
+void test_nested() {
+  mt19937_64 gen(19);
+  FieldsLength<string> outer = { { "h", 4 }, { "inner", 40 }, { "t", 20 } };
+  FieldsLength<string> inner = { { "p", 13 }, { "q", 27 } };
+  for (int round = 0; round < 200; round++) {
+    data_t data = random_data(gen);
+    FieldsView<string> view(data, outer);
+    FieldsView<string> sub = view.view("inner", inner);
+    CHECK(sub.position("q").offset == 4 + 13);
+    CHECK(sub.get("p") == reference_get(data, 4, 13));
+    CHECK(sub.get("q") == reference_get(data, 17, 27));
+    CHECK(reference_get((data_t) sub, 0, 64) == view.get("inner"));
+
+    unsigned long long h = view.get("h"), t = view.get("t");
+    sub.set("q", gen());
+    CHECK(view.get("h") == h && view.get("t") == t);
+    CHECK(reference_get(data, 17, 27) == sub.get("q"));
+  }
+}
+
+/// pack() совпадает с упаковкой Fields; поля, которых нет в данных, остаются нулевыми
+void test_pack() {
+  mt19937_64 gen(20);
+  FieldsLength<string> length = { { "x", 3 }, { "y", 40 }, { "z", 21 } };
+  for (int round = 0; round < 200; round++) {
+    FieldsData<string> fields = { { "x", BitFlow((unsigned long long) gen()) },
+                                  { "y", BitFlow((unsigned long long) gen()) },
+                                  { "z", BitFlow((unsigned long long) gen()) },
+                                  { "missing", BitFlow((unsigned long long) gen()) } };
+    CHECK(pack(length, fields) == (data_t) Fields<string>(length, fields));
+
+    FieldsData<string> partial = { { "y", BitFlow((unsigned long long) gen()) } };
+    data_t packed = pack(length, partial);
+    FieldsView<string> view(packed, length);
+    CHECK(view.get("x") == 0 && view.get("z") == 0);
+    CHECK(view.get("y") == ((unsigned long long) partial["y"] & ((1ull << 40) - 1)));
+  }
+}
+
+int main() {
+  test_layouts();
+  test_nested();
+  test_pack();
+  return check_report("fields_view");
+}
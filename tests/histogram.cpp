@@ -0,0 +1,101 @@
+//
+// Histogram tests: bucket depths after inserts, value replacements and deletes are compared with counts
+// of the structure
+//
+
+#include <random>
+#include "check.h"
+#include "../libspu/histogram.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+data_t to_data(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+/// Корзины не пересекаются, их глубины равны числу ключей структуры в их границах
+void check_buckets(Simulator &structure, const Histogram &hist) {
+  u32 sum = 0;
+  const Histogram::BucketVector &list = hist.buckets();
+  for (std::size_t i = 0; i < list.size(); i++) {
+    CHECK(!(list[i].to < list[i].from));
+    CHECK(i == 0 || list[i - 1].to < list[i].from);
+    CHECK(structure.count(list[i].from, list[i].to) == list[i].count);
+    sum += list[i].count;
+  }
+  CHECK(sum == hist.total());
+  CHECK(hist.total() == structure.get_power());
+}
+
+status_t insert(Simulator &structure, Histogram &hist, unsigned long long key, unsigned long long value) {
+  u32 before = structure.get_power();
+  status_t status = structure.insert(to_data(key), to_data(value), P_FLAG);
+  hist.inserted(to_data(key), before, structure.get_power());
+  return status;
+}
+
+void del(Simulator &structure, Histogram &hist, unsigned long long key) {
+  u32 before = structure.get_power();
+  structure.del(to_data(key), P_FLAG);
+  hist.deleted(to_data(key), before, structure.get_power());
+}
+
+/// Вставки новых ключей внутри и вне корзин, замены значений и удаления, в том числе отсутствующих ключей
+void test_updates() {
+  Simulator structure;
+  mt19937_64 gen(4);
+  for (unsigned long long i = 0; i < 4000; i++) {
+    structure.insert(to_data(1000 + i * 4), to_data(i));
+  }
+  Histogram hist(structure, 16);
+  hist.build();
+  CHECK(hist.buckets().size() <= 16);
+  check_buckets(structure, hist);
+
+  for (int i = 0; i < 6000; i++) {
+    unsigned long long key = gen() % 20000;
+    switch (gen() % 4) {
+      case 0:
+      case 1:
+        insert(structure, hist, key, i);
+        break;
+      case 2:
+        /// Замена значения существующего ключа
+        insert(structure, hist, 1000 + (gen() % 4000) * 4, i);
+        break;
+      default:
+        del(structure, hist, key);
+    }
+  }
+  check_buckets(structure, hist);
+  CHECK(hist.buckets().size() <= 16);
+
+  /// Скопление новых ключей делит глубокую корзину: глубины остаются близкими к средней
+  for (unsigned long long i = 0; i < 3000; i++) {
+    insert(structure, hist, 30000 + i, i);
+  }
+  check_buckets(structure, hist);
+  for (auto &ex : hist.buckets()) {
+    CHECK(ex.count <= HIST_SPLIT_RATIO * hist.total() / hist.buckets().size() + 1);
+  }
+
+  /// Удаление всех ключей опустошает корзины
+  for (unsigned long long key = 0; key < 40000; key++) {
+    del(structure, hist, key);
+  }
+  CHECK(hist.total() == 0);
+  check_buckets(structure, hist);
+}
+
+int main() {
+  test_updates();
+  return check_report("histogram");
+}
@@ -0,0 +1,121 @@
+//
+// Inverted index tests: counts, AND and OR queries on SPU structures and on host against std::set
+// of documents, after adds and removes of postings and terms
+//
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+#include "check.h"
+#include "../libspu/inverted_index.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+using Index = InvertedIndex;
+using Reference = map<Index::term_t, set<Index::doc_t>>;
+
+Index::DocVector expected_all(Reference &ref, const Index::TermVector &terms) {
+  set<Index::doc_t> ret = ref[terms[0]];
+  for (auto term : terms) {
+    set<Index::doc_t> both;
+    set_intersection(ret.begin(), ret.end(), ref[term].begin(), ref[term].end(), inserter(both, both.end()));
+    ret.swap(both);
+  }
+  return Index::DocVector(ret.begin(), ret.end());
+}
+
+Index::DocVector expected_any(Reference &ref, const Index::TermVector &terms) {
+  set<Index::doc_t> ret;
+  for (auto term : terms) {
+    ret.insert(ref[term].begin(), ref[term].end());
+  }
+  return Index::DocVector(ret.begin(), ret.end());
+}
+
+/// Запросы из 1-4 случайных терминов, в том числе отсутствующих
+void check_queries(Index &index, Reference &ref, mt19937_64 &gen) {
+  for (Index::term_t term = 0; term < 24; term++) {
+    CHECK(index.count(term) == ref[term].size());
+  }
+  for (int i = 0; i < 60; i++) {
+    Index::TermVector terms;
+    for (int n = 1 + gen() % 4; n > 0; n--) {
+      terms.push_back(gen() % 24);
+    }
+    Index::Result all = index.all(terms);
+    CHECK(all.get_status() == OK);
+    CHECK(all.rest() == expected_all(ref, terms));
+
+    Index::Result any = index.any(terms);
+    CHECK(any.get_status() == OK);
+    Index::DocVector docs;
+    Index::doc_t doc;
+    while (any.next(doc)) {
+      docs.push_back(doc);
+    }
+    CHECK(docs == expected_any(ref, terms));
+  }
+}
+
+/// temporaries и terms ограничивают структуры СП: с нулевыми лимитами запросы вычисляются на хосте
+void check_index(u32 batch, u32 temporaries, u32 terms) {
+  Simulator structure;
+  Index index(&structure, batch, temporaries, terms);
+  Reference ref;
+  mt19937_64 gen(10 + batch);
+
+  Index::PostingVector postings;
+  for (int i = 0; i < 3000; i++) {
+    /// Термины 20-23 не встречаются
+    Index::term_t term = gen() % 20;
+    Index::doc_t doc = term < 3 ? gen() % 2000 : gen() % 400;
+    postings.push_back({ term, doc, {0} });
+    ref[term].insert(doc);
+  }
+  CHECK(index.add(postings) == OK);
+  for (int i = 0; i < 300; i++) {
+    Index::term_t term = gen() % 20;
+    Index::doc_t doc = gen() % 400;
+    CHECK(index.add(term, doc) == OK);
+    ref[term].insert(doc);
+  }
+  u32 total = 0;
+  for (auto &ex : ref) {
+    total += ex.second.size();
+  }
+  CHECK(index.get_power() == total);
+  check_queries(index, ref, gen);
+  /// Каждому встреченному термину хватает структуры: запрос из них вычисляется в СП
+  CHECK(index.all({ 0, 1, 2 }).on_host() == (terms < 20 || temporaries < 2));
+
+  /// Удаление постингов и всех постингов термина
+  for (int i = 0; i < 500; i++) {
+    Index::term_t term = gen() % 20;
+    Index::doc_t doc = gen() % 400;
+    index.remove(term, doc);
+    ref[term].erase(doc);
+  }
+  CHECK(index.remove(5) == OK);
+  ref[5].clear();
+  check_queries(index, ref, gen);
+
+  /// Постинги термина извлекаются в структуру
+  Simulator extracted;
+  CHECK(index.extract(1, extracted) == OK);
+  CHECK(extracted.get_power() == ref[1].size());
+  CHECK(index.docOf(extracted.min().key) == *ref[1].begin());
+  CHECK(index.termOf(extracted.max().key) == 1);
+}
+
+int main() {
+  check_index(II_BATCH_SIZE, II_MAX_TEMPORARIES, II_MAX_TERM_STRUCTURES);
+  check_index(7, 0, 0);
+  check_index(64, II_MAX_TEMPORARIES, 4);
+  return check_report("inverted_index");
+}
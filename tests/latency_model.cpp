@@ -0,0 +1,141 @@
+//
+// Latency model tests: time of single commands, batches and queued commands by model parameters,
+// simulator commands in timing mode, calibration by synthetic trace
+//
+
+#include <sstream>
+#include "check.h"
+#include "../libspu/batch.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/LatencyModel.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+data_t to_data(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+/// Хост замечает завершение на ближайшем опросе
+unsigned long long polled(unsigned long long ns, unsigned long long poll) {
+  return (ns + poll - 1) / poll * poll;
+}
+
+void test_levels() {
+  LatencyModel model;
+  CHECK(model.levels(0) == 1 && model.levels(32) == 1 && model.levels(33) == 2);
+  CHECK(model.levels(32 * 32) == 2 && model.levels(32 * 32 + 1) == 3);
+}
+
+/// Команда с флагом P: вызов драйвера и выполнение, округленное до опроса
+void test_single() {
+  LatencyModel::Params params;
+  LatencyModel model(params);
+  unsigned long long service = params.cmd_ns[INS] + params.level_ns * model.levels(5000);
+  model.command(INS, P_FLAG, 5000);
+  CHECK(model.now() == params.call_ns + polled(service, params.poll_ns));
+  CHECK(model.busy() == service && model.commands() == 1 && model.calls() == 1);
+
+  /// Пары массовой команды
+  model.reset();
+  model.command(AND, P_FLAG, 10, 1000);
+  CHECK(model.busy() == params.cmd_ns[AND] + params.level_ns + params.pair_ns * 1000);
+}
+
+/// Медленные команды: без флагов хост ждет каждую, с Q - только места в очереди
+void test_queue() {
+  LatencyModel::Params params;
+  for (auto &ex : params.cmd_ns) {
+    ex = 20000;
+  }
+  params.queue_depth = 4;
+  LatencyModel waiting(params), queued(params);
+  for (int i = 0; i < 10; i++) {
+    waiting.command(SRCH, NO_FLAGS, 100);
+    queued.command(SRCH, Q_FLAG, 100);
+  }
+  CHECK(waiting.busy() == queued.busy());
+  CHECK(queued.now() < waiting.now());
+  CHECK(waiting.now() >= 9 * waiting.busy() / 10);
+}
+
+/// Пакет - один вызов драйвера на все команды
+void test_batch() {
+  LatencyModel single, batched;
+  for (int i = 0; i < 10; i++) {
+    single.command(SRCH, P_FLAG, 100);
+  }
+  {
+    LatencyModel::Call call(&batched);
+    for (int i = 0; i < 10; i++) {
+      batched.command(SRCH, P_FLAG, 100);
+    }
+  }
+  CHECK(single.calls() == 10 && batched.calls() == 1 && batched.commands() == 10);
+  CHECK(single.now() - batched.now() >= 9 * single.params().call_ns);
+}
+
+/// Команды структуры симулятора идут в модель; пакет занимает один вызов
+void test_simulator() {
+  LatencyModel model;
+  Simulator structure;
+  structure.set_timing(&model);
+  for (unsigned long long key = 0; key < 100; key++) {
+    structure.insert(to_data(key), to_data(key), P_FLAG);
+  }
+  CHECK(model.commands() == 100 && model.calls() == 100);
+
+  Batch batch;
+  for (unsigned long long key = 0; key < 50; key++) {
+    batch.search(structure, to_data(key));
+  }
+  auto found = batch.execute();
+  CHECK(model.commands() == 150 && model.calls() == 101);
+  CHECK(found.size() == 50 && found[49].status == OK && found[49].value == to_data(49));
+  structure.set_timing(nullptr);
+}
+
+/// Параметры восстанавливаются по трассе, построенной по той же модели
+void test_calibrate() {
+  LatencyModel::Params truth;
+  truth.level_ns = 80;
+  truth.pair_ns = 15;
+  truth.cmd_ns[INS] = 500;
+  truth.cmd_ns[SRCH] = 200;
+  truth.cmd_ns[AND] = 900;
+  LatencyModel shape(truth);
+
+  stringstream trace;
+  trace << "# command power ns pairs" << endl;
+  for (u32 power : { 1u, 40u, 2000u, 70000u, 3000000u }) {
+    for (u32 pairs : { 10u, 5000u }) {
+      double base = truth.call_ns + truth.poll_ns / 2.0 + truth.level_ns * shape.levels(power);
+      trace << "INS " << power << " " << base + truth.cmd_ns[INS] << endl;
+      trace << "0x05 " << power << " " << base + truth.cmd_ns[SRCH] << endl;
+      trace << "AND " << power << " " << base + truth.cmd_ns[AND] + truth.pair_ns * pairs << " " << pairs << endl;
+    }
+  }
+  trace << "BAD 1 1" << endl;
+
+  LatencyModel::Params found = LatencyModel::calibrate(trace);
+  CHECK(found.level_ns == truth.level_ns && found.pair_ns == truth.pair_ns);
+  CHECK(found.cmd_ns[INS] == truth.cmd_ns[INS] && found.cmd_ns[SRCH] == truth.cmd_ns[SRCH]);
+  CHECK(found.cmd_ns[AND] == truth.cmd_ns[AND]);
+  CHECK(found.cmd_ns[MIN] == LatencyModel::Params().cmd_ns[MIN]);
+}
+
+int main() {
+  test_levels();
+  test_single();
+  test_queue();
+  test_batch();
+  test_simulator();
+  test_calibrate();
+  return check_report("latency_model");
+}
@@ -0,0 +1,177 @@
+//
+// Map tests: SPU::Map against std::map after random inserts, assigns and erases, iteration in both
+// directions and bounds; order-preserving key codecs of integers, floating point numbers and strings
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "../libspu/map.hpp"
+#include "../libspu/data_container_operators.h"
+
+using namespace std;
+using namespace SPU;
+
+/// Содержимое и порядок обхода вперед и назад совпадают с std::map
+template <class K, class V>
+bool same(Map<K, V> &map, const std::map<K, V> &ref) {
+  if (map.size() != ref.size() || map.empty() != ref.empty()) {
+    return false;
+  }
+  auto it = map.begin();
+  for (auto &ex : ref) {
+    if (it == map.end() || it->first != ex.first || it->second != ex.second) {
+      return false;
+    }
+    ++it;
+  }
+  if (it != map.end()) {
+    return false;
+  }
+  for (auto rit = ref.rbegin(); rit != ref.rend(); ++rit) {
+    --it;
+    if (it->first != rit->first || it->second != rit->second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class K, class V, class KeyGen, class ValueGen>
+void check_map(unsigned seed, KeyGen key_gen, ValueGen value_gen) {
+  Map<K, V> map(nullptr, 16);
+  std::map<K, V> ref;
+  mt19937_64 gen(seed);
+
+  for (int i = 0; i < 3000; i++) {
+    K key = key_gen(gen);
+    V value = value_gen(gen);
+    switch (gen() % 4) {
+      case 0: {
+        auto done = map.insert({ key, value });
+        auto expected = ref.insert({ key, value });
+        CHECK(done.second == expected.second && done.first->second == expected.first->second);
+        break;
+      }
+      case 1:
+      case 2: {
+        auto done = map.insert_or_assign(key, value);
+        CHECK(done.second == (ref.count(key) == 0));
+        ref[key] = value;
+        CHECK(done.first->first == key && done.first->second == value);
+        break;
+      }
+      default:
+        CHECK(map.erase(key) == ref.erase(key));
+    }
+  }
+  CHECK(same(map, ref));
+
+  /// Поиск, границы и at() для ключей структуры и случайных
+  for (int i = 0; i < 300; i++) {
+    K key = gen() % 2 || ref.empty() ? key_gen(gen) : next(ref.begin(), gen() % ref.size())->first;
+    CHECK(map.count(key) == ref.count(key));
+    CHECK((map.find(key) == map.end()) == (ref.find(key) == ref.end()));
+    auto lower = ref.lower_bound(key);
+    auto upper = ref.upper_bound(key);
+    CHECK(lower == ref.end() ? map.lower_bound(key) == map.end() : map.lower_bound(key)->first == lower->first);
+    CHECK(upper == ref.end() ? map.upper_bound(key) == map.end() : map.upper_bound(key)->first == upper->first);
+    bool thrown = false;
+    try {
+      CHECK(map.at(key) == ref.at(key));
+    } catch (out_of_range &) {
+      thrown = true;
+    }
+    CHECK(thrown == (ref.count(key) == 0));
+  }
+
+  /// Удаление по итератору возвращает следующий элемент
+  for (int i = 0; i < 100 && !ref.empty(); i++) {
+    K key = next(ref.begin(), gen() % ref.size())->first;
+    auto it = map.erase(map.find(key));
+    auto expected = ref.erase(ref.find(key));
+    CHECK(expected == ref.end() ? it == map.end() : it->first == expected->first);
+  }
+  CHECK(same(map, ref));
+
+  map.clear();
+  ref.clear();
+  CHECK(same(map, ref));
+}
+
+/// Кодек сохраняет порядок ключей и восстанавливает их
+template <class K>
+void check_codec(vector<K> keys) {
+  sort(keys.begin(), keys.end());
+  keys.erase(unique(keys.begin(), keys.end()), keys.end());
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    CHECK(KeyCodec<K>::decode(KeyCodec<K>::encode(keys[i])) == keys[i]);
+    CHECK(i == 0 || KeyCodec<K>::encode(keys[i - 1]) < KeyCodec<K>::encode(keys[i]));
+  }
+}
+
+void test_codecs() {
+  mt19937_64 gen(12);
+  vector<int> ints = { numeric_limits<int>::min(), -1, 0, 1, numeric_limits<int>::max() };
+  vector<long long> longs = { numeric_limits<long long>::min(), -1, 0, 1, numeric_limits<long long>::max() };
+  vector<u32> units = { 0, 1, numeric_limits<u32>::max() };
+  vector<float> floats = { -numeric_limits<float>::infinity(), -1e30f, -1.5f, -numeric_limits<float>::denorm_min(), 0.0f,
+                           numeric_limits<float>::denorm_min(), 1.5f, 1e30f, numeric_limits<float>::infinity() };
+  vector<double> doubles = { -numeric_limits<double>::infinity(), -1e300, -numeric_limits<double>::min(), 0.0,
+                             numeric_limits<double>::min(), 1e300, numeric_limits<double>::infinity() };
+  vector<string> strings = { "", "a", "aa", "ab", "b", "zzzzzzzz", "~", "A", "Z0" };
+  uniform_real_distribution<double> real(-1e6, 1e6);
+  for (int i = 0; i < 2000; i++) {
+    ints.push_back((int) gen());
+    longs.push_back((long long) gen());
+    units.push_back((u32) gen());
+    floats.push_back((float) real(gen));
+    doubles.push_back(real(gen));
+    string str;
+    for (std::size_t n = gen() % (sizeof(SPU::key_t) + 1); n > 0; n--) {
+      str.push_back((char) (1 + gen() % 255));
+    }
+    strings.push_back(str);
+  }
+  check_codec(ints);
+  check_codec(longs);
+  check_codec(units);
+  check_codec(floats);
+  check_codec(doubles);
+
+  /// Строки сравниваются как беззнаковые байты
+  sort(strings.begin(), strings.end(), [](const string &a, const string &b) {
+    return lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+                                   [](char x, char y) { return (unsigned char) x < (unsigned char) y; });
+  });
+  strings.erase(unique(strings.begin(), strings.end()), strings.end());
+  for (std::size_t i = 0; i < strings.size(); i++) {
+    CHECK(KeyCodec<string>::decode(KeyCodec<string>::encode(strings[i])) == strings[i]);
+    CHECK(i == 0 || KeyCodec<string>::encode(strings[i - 1]) < KeyCodec<string>::encode(strings[i]));
+  }
+
+  bool thrown = false;
+  try {
+    KeyCodec<string>::encode(string(sizeof(SPU::key_t) + 1, 'x'));
+  } catch (length_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+}
+
+int main() {
+  check_map<int, long long>(13, [](mt19937_64 &gen) { return (int) (gen() % 4000) - 2000; },
+                            [](mt19937_64 &gen) { return (long long) gen(); });
+  check_map<double, int>(14, [](mt19937_64 &gen) { return ((double) (gen() % 4000) - 2000) / 8; },
+                         [](mt19937_64 &gen) { return (int) gen(); });
+  check_map<string, string>(15, [](mt19937_64 &gen) { return to_string(gen() % 3000); },
+                            [](mt19937_64 &gen) { return string(gen() % 40, 'v') + to_string(gen() % 100); });
+  test_codecs();
+  return check_report("map");
+}
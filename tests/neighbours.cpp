@@ -0,0 +1,121 @@
+//
+// Neighbours tests: lower and upper neighbours, nearest keys and interpolation of signed keys
+// against std::map, probes on the edges of key range
+//
+
+#include <climits>
+#include <map>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "../libspu/neighbours.hpp"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+template <class K>
+using Reference = map<K, u32>;
+
+/// Соседи пробы по std::map: наибольший ключ не больше пробы и наименьший не меньше
+template <class K>
+bool same(const Reference<K> &ref, K probe, const neighbours_t &found) {
+  auto upper = ref.lower_bound(probe);
+  auto lower = ref.upper_bound(probe);
+  bool has_lower = lower != ref.begin();
+  if (has_lower) {
+    --lower;
+  }
+  if ((found.lower.status == OK) != has_lower || (found.upper.status == OK) != (upper != ref.end())) {
+    return false;
+  }
+  if (has_lower && (decodeKey<K>(found.lower.key) != lower->first || decode<u32>(found.lower.value) != lower->second)) {
+    return false;
+  }
+  return upper == ref.end() ||
+         (decodeKey<K>(found.upper.key) == upper->first && decode<u32>(found.upper.value) == upper->second);
+}
+
+/// Ключи типа K в [-range, range), пробы - случайные и крайние значения типа
+template <class K>
+void check_keys(unsigned seed, long long range) {
+  Simulator structure;
+  Reference<K> ref;
+  mt19937_64 gen(seed);
+
+  vector<K> probes = { numeric_limits<K>::min(), numeric_limits<K>::max(), 0, -1, 1 };
+  for (int i = 0; i < 500; i++) {
+    probes.push_back((K) ((long long) (gen() % (3 * range)) - 3 * range / 2));
+  }
+
+  /// Пустая структура: соседей нет
+  for (auto &ex : neighbours(structure, encode(probes))) {
+    CHECK(ex.lower.status != OK && ex.upper.status != OK);
+  }
+
+  for (int i = 0; i < 1000; i++) {
+    K key = (K) ((long long) (gen() % (2 * range)) - range);
+    u32 value = (u32) gen();
+    structure.insert(encode(key), BitFlow(value));
+    ref[key] = value;
+  }
+  /// Ключи на краях диапазона
+  for (K key : { numeric_limits<K>::min(), numeric_limits<K>::max() }) {
+    structure.insert(encode(key), BitFlow((u32) 7));
+    ref[key] = 7;
+    probes.push_back(key);
+  }
+  for (auto &ex : ref) {
+    probes.push_back(ex.first);
+  }
+
+  NeighboursVector found = neighbours(structure, encode(probes));
+  BaseStructure::PairVector near = nearest(structure, probes);
+  CHECK(found.size() == probes.size() && near.size() == probes.size());
+  for (std::size_t i = 0; i < probes.size() && i < found.size(); i++) {
+    CHECK(same(ref, probes[i], found[i]));
+    CHECK(same(ref, probes[i], neighbours(structure, encode(probes[i]))));
+
+    /// Ближайший ключ, при равенстве расстояний - меньший
+    auto upper = ref.lower_bound(probes[i]);
+    auto best = upper;
+    if (upper == ref.end() ||
+        (upper != ref.begin() && (long double) probes[i] - prev(upper)->first <= (long double) upper->first - probes[i])) {
+      best = prev(upper);
+    }
+    CHECK(near[i].status == OK && decodeKey<K>(near[i].key) == best->first);
+  }
+}
+
+/// Значение между соседями интерполируется линейно, вне диапазона ключей - ERR
+void test_interpolate() {
+  Simulator structure;
+  for (int key = -100; key <= 100; key += 10) {
+    structure.insert(encode(key), BitFlow((u32) (1000 + key * 3)));
+  }
+
+  vector<int> probes;
+  for (int probe = -120; probe <= 120; probe++) {
+    probes.push_back(probe);
+  }
+  vector<u32> results;
+  vector<status_t> statuses = interpolate(structure, probes, results);
+  for (std::size_t i = 0; i < probes.size(); i++) {
+    int probe = probes[i];
+    bool inside = probe >= -100 && probe <= 100;
+    CHECK((statuses[i] == OK) == inside);
+    if (inside) {
+      CHECK(results[i] == (u32) (1000 + probe * 3));
+      u32 single = 0;
+      CHECK(interpolate(structure, probe, single) == OK && single == results[i]);
+    }
+  }
+}
+
+int main() {
+  check_keys<int>(5, 5000);
+  check_keys<long long>(6, 1ll << 40);
+  test_interpolate();
+  return check_report("neighbours");
+}
@@ -0,0 +1,155 @@
+//
+// Parallel scan tests: ranges cover every key of scanned range exactly once, portions of ranges,
+// ordered and unordered scans and aggregates against std::map, on simulator threads and on
+// batches of emulated SPU
+//
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <random>
+#include "check.h"
+#include "../libspu/parallel_scan.h"
+#include "../libspu/mmio.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/RegisterFile.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+using Reference = map<unsigned long long, unsigned long long>;
+
+/// Наибольший ключ СП
+const unsigned long long TOP = SPU_WEIGHT > 1 ? ~0ull : 0xffffffffull;
+
+data_t to_data(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+unsigned long long from_data(const data_t &data) {
+  unsigned long long ret = data.cont[0];
+#if SPU_WEIGHT > 1
+  ret |= (unsigned long long) data.cont[1] << 32;
+#endif
+  return ret;
+}
+
+bool same(const BaseStructure::PairVector &pairs, const Reference &ref, unsigned long long from, unsigned long long to) {
+  auto it = ref.lower_bound(from);
+  for (auto &ex : pairs) {
+    if (it == ref.end() || it->first > to || from_data(ex.key) != it->first || from_data(ex.value) != it->second) {
+      return false;
+    }
+    ++it;
+  }
+  return it == ref.end() || it->first > to;
+}
+
+/// Диапазоны идут по возрастанию, не пересекаются, лежат в [from, to] и содержат все его ключи
+void check_ranges(ParallelScan &scan, const Reference &ref, unsigned long long from, unsigned long long to) {
+  BaseStructure::RangeVector parts = scan.ranges(to_data(from), to_data(to));
+  for (std::size_t i = 0; i < parts.size(); i++) {
+    CHECK(!(parts[i].to < parts[i].from));
+    CHECK(!(parts[i].from < to_data(from)) && !(to_data(to) < parts[i].to));
+    CHECK(i == 0 || parts[i - 1].to < parts[i].from);
+  }
+  for (auto it = ref.lower_bound(from); it != ref.end() && it->first <= to; ++it) {
+    auto part = upper_bound(parts.begin(), parts.end(), to_data(it->first),
+                            [](const data_t &key, const BaseStructure::RangeStruct &range) { return key < range.from; });
+    CHECK(part != parts.begin() && !(prev(part)->to < to_data(it->first)));
+  }
+
+  /// Порции диапазона идут по порядку и не выходят за его границы
+  vector<unsigned long long> last(parts.size(), 0);
+  vector<bool> started(parts.size(), false);
+  BaseStructure::PairVector all;
+  mutex lock;
+  scan.forEach(parts, [&](u32 part, const BaseStructure::PairVector &pairs) {
+    lock_guard<mutex> guard(lock);
+    for (auto &ex : pairs) {
+      CHECK(!(ex.key < parts[part].from) && !(parts[part].to < ex.key));
+      CHECK(!started[part] || last[part] < from_data(ex.key));
+      started[part] = true;
+      last[part] = from_data(ex.key);
+      all.push_back(ex);
+    }
+  });
+  sort(all.begin(), all.end(), [](const pair_t &a, const pair_t &b) { return a.key < b.key; });
+  CHECK(same(all, ref, from, to));
+}
+
+void check_scans(BaseStructure &structure, const Reference &ref, u32 parts, u32 chunk) {
+  ParallelScan scan(structure, parts, chunk);
+  for (auto range : { make_pair(0ull, TOP), make_pair(1000ull, 50000ull), make_pair(77777ull, 77777ull),
+                      make_pair(200000ull, 300000ull) }) {
+    check_ranges(scan, ref, range.first, range.second);
+    CHECK(same(scan.scan(to_data(range.first), to_data(range.second)), ref, range.first, range.second));
+
+    BaseStructure::PairVector unordered = scan.scan(to_data(range.first), to_data(range.second), false);
+    sort(unordered.begin(), unordered.end(), [](const pair_t &a, const pair_t &b) { return a.key < b.key; });
+    CHECK(same(unordered, ref, range.first, range.second));
+
+    unsigned long long expected = 0;
+    for (auto it = ref.lower_bound(range.first); it != ref.end() && it->first <= range.second; ++it) {
+      expected += it->second;
+    }
+    unsigned long long sum = scan.aggregate(to_data(range.first), to_data(range.second), 0ull,
+                                            [](unsigned long long &acc, const pair_t &pair) { acc += from_data(pair.value); },
+                                            [](unsigned long long &acc, unsigned long long part) { acc += part; });
+    CHECK(sum == expected);
+  }
+}
+
+/// Ключи с неравномерной плотностью и ключи на краях диапазона
+Reference fill(BaseStructure &structure, unsigned seed) {
+  Reference ref;
+  mt19937_64 gen(seed);
+  for (int i = 0; i < 6000; i++) {
+    unsigned long long key = i % 3 ? gen() % 100000 : 100000 + gen() % 100;
+    ref[key] = gen() % 1000;
+  }
+  ref[0] = 1;
+  ref[TOP] = 2;
+  for (auto &ex : ref) {
+    structure.insert(to_data(ex.first), to_data(ex.second));
+  }
+  return ref;
+}
+
+void test_simulator() {
+  Simulator structure;
+  Reference ref = fill(structure, 22);
+  for (u32 parts : { 0u, 1u, 7u, 64u }) {
+    check_scans(structure, ref, parts, 5);
+    check_scans(structure, ref, parts, SPU_BATCH_MAX);
+  }
+}
+
+/// Чтения СП не параллельны: диапазоны продвигаются пакетами
+void test_board() {
+  RegisterFile regs;
+  Mmio mmio(regs);
+  mmio.reset();
+  Transport::global() = &mmio;
+  {
+    BaseStructure structure;
+    CHECK(!structure.concurrent());
+    Reference ref = fill(structure, 23);
+    for (u32 parts : { 0u, 3u }) {
+      check_scans(structure, ref, parts, 17);
+    }
+  }
+  Transport::global() = nullptr;
+}
+
+int main() {
+  test_simulator();
+  test_board();
+  return check_report("parallel_scan");
+}
@@ -0,0 +1,234 @@
+//
+// PersistentTree tests: node splits, merges and borrows, bulk build and isolation of clones
+//
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "../simulator/PersistentTree.h"
+#include "../libspu/data_container_operators.h"
+
+using namespace std;
+using namespace SPU;
+
+using Model = map<unsigned long long, unsigned long long>;
+
+data_t to_data(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+/// дерево совпадает с моделью: обход, поиск, ранги и выборка по номеру
+bool same(const PersistentTree &tree, const Model &model) {
+  if (tree.size() != model.size()) {
+    return false;
+  }
+  auto it = tree.begin();
+  u32 index = 0;
+  for (auto &ex : model) {
+    if (!it.valid() || it.key() != to_data(ex.first) || it.value() != to_data(ex.second)) {
+      return false;
+    }
+    /// Ранги и выборка проверяются выборочно: они идут от корня и стоят O(log n)
+    if (index % 97 == 0) {
+      if (tree.rank(to_data(ex.first)) != index || tree.rank(to_data(ex.first), true) != index + 1 ||
+          tree.select(index).key() != to_data(ex.first)) {
+        return false;
+      }
+    }
+    it.next();
+    index++;
+  }
+  return !it.valid();
+}
+
+/// Вставки по возрастанию, убыванию и случайные: листья и внутренние узлы делятся на всех уровнях
+void test_splits() {
+  for (int order = 0; order < 3; order++) {
+    PersistentTree tree;
+    Model model;
+    mt19937_64 gen(order);
+    for (unsigned long long i = 0; i < 50000; i++) {
+      unsigned long long key = order == 0 ? i : order == 1 ? 50000 - i : gen() % 1000000;
+      CHECK(tree.insert(to_data(key), to_data(i)) == model.emplace(key, i).second);
+      model[key] = i;
+    }
+    CHECK(same(tree, model));
+
+    /// Замена значения не добавляет пару
+    CHECK(!tree.insert(to_data(model.begin()->first), to_data(7)));
+    model.begin()->second = 7;
+    CHECK(same(tree, model));
+
+    value_t value;
+    CHECK(tree.get(to_data(model.rbegin()->first), value) && value == to_data(model.rbegin()->second));
+    CHECK(!tree.contains(to_data(2000000)));
+    CHECK(!tree.find(to_data(2000000)).valid());
+  }
+}
+
+/// Убывающие вставки в промежуток после меньших ключей делят узлы пополам: узлы заполнены
+/// не меньше чем на TREE_MIN, как при возрастающих вставках, и высота не растет
+void test_gap() {
+  const unsigned long long n = 200000;
+  PersistentTree ascending, gap;
+  Model model;
+  for (unsigned long long i = 0; i < n; i++) {
+    ascending.insert(to_data(i), to_data(i));
+  }
+  for (unsigned long long i = 0; i < 32; i++) {
+    gap.insert(to_data(i), to_data(i));
+    model[i] = i;
+  }
+  for (unsigned long long i = n; i > 32; i--) {
+    gap.insert(to_data(i + 1000), to_data(i));
+    model[i + 1000] = i;
+  }
+  CHECK(same(gap, model));
+
+  /// В среднем узел держит не меньше TREE_MIN элементов; высота - как у дерева из узлов по TREE_ORDER / 2
+  CHECK(gap.nodes() * (TREE_ORDER / 2) <= 2 * gap.size());
+  CHECK(gap.nodes() <= 3 * ascending.nodes());
+  CHECK(gap.heap_bytes() <= 3 * ascending.heap_bytes());
+  u32 height = 1;
+  for (unsigned long long pairs = TREE_ORDER / 2; pairs < n; pairs *= TREE_ORDER / 2) {
+    height++;
+  }
+  CHECK(gap.height() <= height);
+  CHECK(ascending.height() <= gap.height());
+}
+
+/// Удаления до пустого дерева: узлы с числом элементов меньше TREE_MIN сливаются или берут у соседа
+void test_merges() {
+  PersistentTree tree;
+  Model model;
+  mt19937_64 gen(5);
+  for (unsigned long long i = 0; i < 40000; i++) {
+    tree.insert(to_data(i * 3), to_data(i));
+    model[i * 3] = i;
+  }
+
+  vector<unsigned long long> keys;
+  for (auto &ex : model) {
+    keys.push_back(ex.first);
+  }
+  shuffle(keys.begin(), keys.end(), gen);
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    CHECK(tree.erase(to_data(keys[i])));
+    model.erase(keys[i]);
+    if (i % 5000 == 0 || model.size() < 40) {
+      CHECK(same(tree, model));
+    }
+  }
+  CHECK(tree.empty());
+  CHECK(!tree.erase(to_data(3)));
+  CHECK(!tree.begin().valid());
+
+  /// Малый диапазон удаляется по одной паре, большой - перестроением
+  for (unsigned long long i = 0; i < 40000; i++) {
+    tree.insert(to_data(i), to_data(i));
+    model[i] = i;
+  }
+  for (auto range : vector<pair<unsigned long long, unsigned long long>>{ { 100, 180 }, { 5000, 30000 }, { 39990, 50000 } }) {
+    u32 count = tree.erase(to_data(range.first), to_data(range.second));
+    CHECK(count == distance(model.lower_bound(range.first), model.upper_bound(range.second)));
+    model.erase(model.lower_bound(range.first), model.upper_bound(range.second));
+    CHECK(same(tree, model));
+  }
+  CHECK(tree.erase(to_data(10), to_data(5)) == 0);
+}
+
+/// Построение снизу вверх для всех хвостов последнего листа
+void test_builder() {
+  for (u32 n : { 0u, 1u, (u32) TREE_MIN - 1, (u32) TREE_ORDER, (u32) TREE_ORDER + 1, (u32) TREE_ORDER * TREE_ORDER + 3, 20000u }) {
+    PersistentTree tree;
+    Model model;
+    PersistentTree::Builder builder(tree);
+    for (u32 i = 0; i < n; i++) {
+      builder.push(to_data(2 * i), to_data(i));
+      model[2 * i] = i;
+    }
+    builder.finish();
+    CHECK(same(tree, model));
+
+    /// Дерево после построения изменяется как обычное
+    tree.insert(to_data(1), to_data(1));
+    model[1] = 1;
+    if (n > 0) {
+      tree.erase(to_data(0));
+      model.erase(0);
+    }
+    CHECK(same(tree, model));
+  }
+}
+
+/// Клон разделяет узлы с исходным деревом: изменения одного не видны другому
+void test_snapshots() {
+  PersistentTree tree;
+  Model model;
+  for (unsigned long long i = 0; i < 30000; i++) {
+    tree.insert(to_data(i), to_data(i));
+    model[i] = i;
+  }
+
+  PersistentTree snapshot;
+  snapshot.assign(tree);
+  Model snapshot_model = model;
+
+  mt19937_64 gen(9);
+  for (int i = 0; i < 20000; i++) {
+    unsigned long long key = gen() % 60000;
+    if (gen() % 2) {
+      tree.insert(to_data(key), to_data(key + 1));
+      model[key] = key + 1;
+    } else {
+      tree.erase(to_data(key));
+      model.erase(key);
+    }
+  }
+  CHECK(same(tree, model));
+  CHECK(same(snapshot, snapshot_model));
+
+  /// Изменения клона не видны исходному дереву
+  PersistentTree second;
+  second.assign(snapshot);
+  second.erase(to_data(0), to_data(20000));
+  second.insert(to_data(100), to_data(100));
+  CHECK(same(snapshot, snapshot_model));
+  CHECK(same(tree, model));
+  CHECK(second.size() == 30000 - 20001 + 1);
+
+  /// Построение в дерево семейства замещает только его корень
+  PersistentTree::Builder builder(snapshot);
+  builder.push(to_data(1), to_data(2));
+  builder.finish();
+  CHECK(snapshot.size() == 1);
+  CHECK(same(tree, model));
+
+  /// Семейство переживает удаление любого из деревьев
+  {
+    PersistentTree temporary;
+    temporary.assign(tree);
+    temporary.clear();
+  }
+  CHECK(same(tree, model));
+  tree.swap(second);
+  CHECK(tree.size() == 30000 - 20001 + 1);
+  CHECK(same(second, model));
+}
+
+int main() {
+  test_splits();
+  test_gap();
+  test_merges();
+  test_builder();
+  test_snapshots();
+  return check_report("persistent_tree");
+}
@@ -0,0 +1,82 @@
+//
+// Typed records tests: pairs written by fields of key and value layouts and read through record
+// views against std::map of rows, changes made through views and written back
+//
+
+#include <map>
+#include <random>
+#include <string>
+#include "check.h"
+#include "../libspu/structure.hpp"
+#include "../libspu/data_container_operators.h"
+
+using namespace std;
+using namespace SPU;
+
+/// Строка: ключ (group, id), значение (count, weight, flag)
+struct Row {
+  unsigned long long count;
+  unsigned long long weight;
+  unsigned long long flag;
+};
+using Reference = map<pair<u32, u32>, Row>;
+
+FieldsLength<string> key_layout = { { "id", 20 }, { "group", 12 } };
+FieldsLength<string> value_layout = { { "count", 24 }, { "weight", 39 }, { "flag", 1 } };
+
+bool same(Structure<string>::Record rec, const pair<u32, u32> &key, const Row &row) {
+  return rec.found() && rec.key().get("group") == key.first && rec.key().get("id") == key.second &&
+         rec.value().get("count") == row.count && rec.value().get("weight") == row.weight &&
+         rec.value().get("flag") == row.flag;
+}
+
+void test_records() {
+  Structure<string> table(key_layout, value_layout);
+  Reference ref;
+  mt19937_64 gen(24);
+
+  for (int i = 0; i < 2000; i++) {
+    pair<u32, u32> key(gen() % 16, gen() % 200);
+    Row row = { gen() % (1 << 24), gen() % (1ull << 39), gen() % 2 };
+    table.insert({ { "group", BitFlow(key.first) }, { "id", BitFlow(key.second) } },
+                 { { "count", BitFlow(row.count) }, { "weight", BitFlow(row.weight) }, { "flag", BitFlow(row.flag) } });
+    ref[key] = row;
+  }
+  CHECK(table.get_power() == ref.size());
+
+  /// Поиск по полям ключа и соседние записи
+  for (auto &ex : ref) {
+    CHECK(same(table.searchRecord({ { "group", BitFlow(ex.first.first) }, { "id", BitFlow(ex.first.second) } }),
+               ex.first, ex.second));
+  }
+  CHECK(same(table.minRecord(), ref.begin()->first, ref.begin()->second));
+  CHECK(same(table.maxRecord(), ref.rbegin()->first, ref.rbegin()->second));
+  auto second = next(ref.begin());
+  /// Виды ссылаются на запись, поэтому она хранится
+  auto first = table.minRecord();
+  CHECK(same(table.nextRecord((data_t) first.key()), second->first, second->second));
+  CHECK(!table.searchRecord({ { "group", BitFlow(100u) }, { "id", BitFlow(1u) } }).found());
+
+  /// Изменения через виды записываются обратно
+  for (auto &ex : ref) {
+    if (gen() % 3) {
+      continue;
+    }
+    auto rec = table.searchRecord({ { "group", BitFlow(ex.first.first) }, { "id", BitFlow(ex.first.second) } });
+    auto value = rec.value();
+    ex.second.count = (ex.second.count + 1) % (1 << 24);
+    ex.second.flag ^= 1;
+    value.set("count", ex.second.count);
+    value.set("flag", ex.second.flag);
+    CHECK(table.insert(rec) == OK);
+  }
+  for (auto &ex : ref) {
+    CHECK(same(table.searchRecord({ { "group", BitFlow(ex.first.first) }, { "id", BitFlow(ex.first.second) } }),
+               ex.first, ex.second));
+  }
+}
+
+int main() {
+  test_records();
+  return check_report("records");
+}
@@ -0,0 +1,191 @@
+//
+// Remote protocol tests: client against server of emulated SPU compared with Simulator,
+// handshake, oversized replies and structures of closed connections
+//
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "check.h"
+#include "../libspu/server.h"
+#include "../libspu/mmio.h"
+#include "../libspu/batch.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/RegisterFile.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+data_t to_data(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+bool same(const pair_t &a, const pair_t &b) {
+  return a.status == b.status && (a.status != OK || (a.key == b.key && a.value == b.value));
+}
+
+/// Вставки и удаления с флагом P и без него, поиск соседей и пакет: ответы сервера совпадают с симулятором
+void test_commands(Remote &remote) {
+  BaseStructure structure;
+  Simulator model;
+  mt19937_64 gen(3);
+  for (int i = 0; i < 3000; i++) {
+    SPU::key_t key = to_data(gen() % 2000);
+    value_t value = to_data(i);
+    flags_t flags = i % 3 ? NO_FLAGS : P_FLAG;
+    if (gen() % 4) {
+      status_t status = structure.insert(key, value, flags);
+      CHECK(model.insert(key, value) == status || !(flags & P_FLAG));
+    } else {
+      /// Статус DEL отсутствующего ключа у симулятора и платы различается: сравнивается содержимое
+      structure.del(key, flags);
+      model.del(key);
+    }
+  }
+
+  /// Мощность приходит в результате команды с флагом P
+  CHECK(same(structure.min(), model.min()));
+  CHECK(structure.get_power() == model.get_power());
+  CHECK(same(structure.max(), model.max()));
+  for (unsigned long long x = 0; x < 2100; x += 7) {
+    CHECK(same(structure.search(to_data(x)), model.search(to_data(x))));
+    CHECK(same(structure.next(to_data(x)), model.next(to_data(x))));
+    CHECK(same(structure.prev(to_data(x)), model.prev(to_data(x))));
+    CHECK(same(structure.nsm(to_data(x)), model.nsm(to_data(x))));
+    CHECK(same(structure.ngr(to_data(x)), model.ngr(to_data(x))));
+  }
+
+  /// Пакет занимает одно обращение к серверу
+  Batch batch, model_batch;
+  for (unsigned long long x = 0; x < 200; x++) {
+    batch.search(structure, to_data(x * 10));
+    model_batch.search(model, to_data(x * 10));
+  }
+  auto trips = remote.round_trips();
+  auto result = batch.execute();
+  auto expected = model_batch.execute();
+  CHECK(remote.round_trips() == trips + 1);
+  CHECK(result.size() == expected.size());
+  for (std::size_t i = 0; i < result.size() && i < expected.size(); i++) {
+    CHECK(same(result[i], expected[i]));
+  }
+}
+
+/// Результат длиннее буфера вычитывается: следующий ответ не сдвигается
+void test_oversized(Remote &remote) {
+  BaseStructure structure;
+  structure.insert(to_data(5), to_data(50), P_FLAG);
+
+  CHECK(resultSize(MIN | P_FLAG) > commandSize(MIN));
+  batch_slot_t slot = {};
+  slot.frmt_3.cmd = MIN | P_FLAG;
+  slot.frmt_3.gsid = structure.get_gsid();
+  CHECK(remote.execute(&slot, commandSize(MIN)) == 0);
+
+  pair_t found = structure.search(to_data(5));
+  CHECK(found.status == OK && found.value == to_data(50));
+  CHECK(structure.get_power() == 1);
+}
+
+/// ADDS по одной команде и пакетом
+u32 create(Remote &remote, u32 singles, u32 batched) {
+  u32 created = 0;
+  for (u32 i = 0; i < singles; i++) {
+    batch_slot_t slot = {};
+    slot.frmt_0.cmd = ADDS | P_FLAG;
+    remote.execute(&slot, &slot);
+    created += slot.rslt_0.rslt == OK;
+  }
+
+  vector<u8> buf(sizeof(btch_cmd_t) + batched * sizeof(batch_slot_t), 0);
+  btch_cmd_t *head = (btch_cmd_t *) buf.data();
+  batch_slot_t *slots = (batch_slot_t *) (head + 1);
+  head->cmd = BTCH | P_FLAG;
+  head->count = batched;
+  for (u32 i = 0; i < batched; i++) {
+    slots[i].frmt_0.cmd = ADDS | P_FLAG;
+  }
+  if (batched && remote.execute(buf.data(), buf.size())) {
+    for (u32 i = 0; i < batched; i++) {
+      created += slots[i].rslt_0.rslt == OK;
+    }
+  }
+  return created;
+}
+
+/// Структуры, не удаленные клиентом, удаляются при закрытии его соединения
+void test_ownership(const char *path) {
+  unique_ptr<Remote> first(Remote::local(path));
+  CHECK(create(*first, SPU_STR_NUM / 2, SPU_STR_NUM - SPU_STR_NUM / 2) == SPU_STR_NUM);
+  CHECK(create(*first, 1, 0) == 0);
+  first.reset();
+
+  /// Сервер удаляет структуры в потоке соединения после его закрытия
+  unique_ptr<Remote> second(Remote::local(path));
+  u32 created = 0;
+  for (int i = 0; i < 2000 && created < SPU_STR_NUM; i++) {
+    if (!create(*second, 1, 0)) {
+      this_thread::sleep_for(chrono::milliseconds(1));
+      continue;
+    }
+    created++;
+  }
+  CHECK(created == SPU_STR_NUM);
+}
+
+/// Клиент другой версии получает приветствие сервера, после чего соединение закрывается
+void test_handshake(const char *path) {
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  CHECK(sock >= 0 && connect(sock, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+
+  remote_hello hello = remoteHello();
+  hello.version++;
+  CHECK(send(sock, &hello, sizeof(hello), MSG_NOSIGNAL) == sizeof(hello));
+  remote_hello server;
+  CHECK(recv(sock, &server, sizeof(server), MSG_WAITALL) == sizeof(server) && remoteAgree(server));
+
+  char byte;
+  CHECK(recv(sock, &byte, 1, 0) == 0);
+  close(sock);
+}
+
+int main() {
+  string path = "/tmp/spu_test_remote_" + to_string(getpid()) + ".sock";
+  RegisterFile regs;
+  Mmio mmio(regs);
+  mmio.reset();
+
+  Server server(&mmio);
+  CHECK(server.listenLocal(path.c_str()));
+  thread serving(&Server::run, &server);
+
+  {
+    unique_ptr<Remote> remote(Remote::local(path.c_str()));
+    Transport::global() = remote.get();
+    test_commands(*remote);
+    test_oversized(*remote);
+    Transport::global() = nullptr;
+  }
+  test_ownership(path.c_str());
+  test_handshake(path.c_str());
+
+  server.stop();
+  serving.join();
+  return check_report("remote");
+}
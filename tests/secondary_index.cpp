@@ -0,0 +1,132 @@
+//
+// Secondary index tests: index keys after single, batched and repeated writes and deletes against
+// std::map of rows, filtered index, first and last rows, index wider than SPU key
+//
+
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include "check.h"
+#include "../libspu/structure.hpp"
+#include "../libspu/data_container_operators.h"
+
+using namespace std;
+using namespace SPU;
+
+/// Значение строки: поле a в младших 8 разрядах, поле b - в следующих 8
+struct Row {
+  u32 a;
+  u32 b;
+};
+using Reference = map<u32, Row>;
+
+u32 packed(const Row &row) {
+  return row.a | row.b << 8;
+}
+
+/// Ключи индекса по полю a строк, прошедших фильтр
+set<u32> expected_keys(const Reference &ref, bool even_b) {
+  set<u32> ret;
+  for (auto &ex : ref) {
+    if (!even_b || ex.second.b % 2 == 0) {
+      ret.insert(ex.second.a << 16 | ex.first);
+    }
+  }
+  return ret;
+}
+
+set<u32> index_keys(BaseStructure &index) {
+  set<u32> ret;
+  Cursor cursor(index);
+  pair_t pair;
+  while (cursor.next(pair)) {
+    ret.insert(pair.key.cont[0]);
+    CHECK(pair.key.cont[1] == 0);
+  }
+  return ret;
+}
+
+void check_indexes(Structure<string> &table, const Reference &ref, std::size_t all, std::size_t even) {
+  auto keys = expected_keys(ref, false);
+  CHECK(index_keys(table.index(all)) == keys);
+  CHECK(index_keys(table.index(even)) == expected_keys(ref, true));
+  CHECK(table.get_power() == ref.size());
+  if (!keys.empty()) {
+    /// Первая и последняя строки по полю a
+    CHECK(table.first(all).status == OK && table.first(all).key.cont[0] == (*keys.begin() & 0xffff));
+    CHECK(table.last(all).status == OK && table.last(all).key.cont[0] == (*keys.rbegin() & 0xffff));
+    CHECK((u32) table.primaryKey(table.index(all).min().key)["id"] == (*keys.begin() & 0xffff));
+    CHECK((u32) table.indexFields(all, table.index(all).max().key)["a"] == *keys.rbegin() >> 16);
+  }
+}
+
+void test_updates() {
+  FieldsLength<string> layout = { { "a", 8 }, { "b", 8 } };
+  Structure<string> table({ { "id", 16 } }, layout);
+  Reference ref;
+  mt19937_64 gen(11);
+
+  /// Индекс по существующим строкам заполняется при объявлении
+  for (u32 id = 0; id < 300; id++) {
+    Row row = { (u32) gen() % 256, (u32) gen() % 256 };
+    table.insert(BitFlow(id), BitFlow(packed(row)));
+    ref[id] = row;
+  }
+  std::size_t all = table.addIndex(layout, { { "a", 8 } });
+  std::size_t even = table.addIndex(layout, { { "a", 8 } }, [](Fields<string> &value) { return (u32) value["b"] % 2 == 0; });
+  check_indexes(table, ref, all, even);
+
+  /// Вставки, замены значений и удаления по одной строке
+  for (int i = 0; i < 2000; i++) {
+    u32 id = gen() % 600;
+    if (gen() % 3) {
+      Row row = { (u32) gen() % 256, (u32) gen() % 256 };
+      CHECK(table.insert(BitFlow(id), BitFlow(packed(row))) == OK);
+      ref[id] = row;
+    } else {
+      table.del(BitFlow(id));
+      ref.erase(id);
+    }
+  }
+  check_indexes(table, ref, all, even);
+
+  /// Пакет с повторяющимися ключами: индекс видит последнее значение
+  Structure<string>::InsertVector batch;
+  for (int i = 0; i < 500; i++) {
+    u32 id = gen() % 100;
+    Row row = { (u32) gen() % 256, (u32) gen() % 256 };
+    batch.push_back({ { { "id", BitFlow(id) } }, BitFlow(packed(row)) });
+    ref[id] = row;
+  }
+  CHECK(table.insert(batch) == OK);
+  check_indexes(table, ref, all, even);
+
+  for (u32 id = 0; id < 600; id++) {
+    table.del(BitFlow(id));
+  }
+  ref.clear();
+  check_indexes(table, ref, all, even);
+  CHECK(table.first(all).status != OK && table.last(even).status != OK);
+}
+
+/// Поля индекса вместе с первичным ключом шире ключа СП
+void test_width() {
+  FieldsLength<string> layout = { { "a", SPU_WEIGHT * 32 - 16 }, { "b", 1 } };
+  Structure<string> table({ { "id", 16 } }, layout);
+  bool thrown = false;
+  try {
+    table.addIndex(layout, { { "a", SPU_WEIGHT * 32 - 16 }, { "b", 1 } });
+  } catch (length_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK(table.addIndex(layout, { { "a", SPU_WEIGHT * 32 - 16 } }) == 0);
+}
+
+int main() {
+  test_updates();
+  test_width();
+  return check_report("secondary_index");
+}
@@ -0,0 +1,152 @@
+//
+// Sorted set kernels tests: every kernel of the host and every block tail against std::set_intersection,
+// std::set_union and std::set_difference
+//
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+#include "check.h"
+#include "../libspu/set_kernels.h"
+#include "../libspu/data_container_operators.h"
+
+using namespace std;
+using namespace SPU;
+
+data_t to_key(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+/// n различных ключей из [0, range) по возрастанию
+vector<unsigned long long> sorted_keys(mt19937_64 &gen, std::size_t n, unsigned long long range) {
+  set<unsigned long long> keys;
+  while (keys.size() < n) {
+    keys.insert(gen() % range);
+  }
+  return vector<unsigned long long>(keys.begin(), keys.end());
+}
+
+/// ключи по позициям результата ядра: позиции b отмечены SET_FROM_B
+template <class T>
+vector<T> taken(const vector<T> &a, const vector<T> &b, const vector<u32> &pos, std::size_t count) {
+  vector<T> ret;
+  for (std::size_t i = 0; i < count; i++) {
+    ret.push_back(pos[i] & SET_FROM_B ? b[pos[i] & ~SET_FROM_B] : a[pos[i]]);
+  }
+  return ret;
+}
+
+/// Ядра совпадают со стандартными алгоритмами на массивах ключей типа T
+template <class T, class Convert>
+void check_pair(const vector<unsigned long long> &x, const vector<unsigned long long> &y, Convert convert) {
+  vector<T> a, b, expected;
+  transform(x.begin(), x.end(), back_inserter(a), convert);
+  transform(y.begin(), y.end(), back_inserter(b), convert);
+  vector<u32> pos(a.size() + b.size() + 1);
+
+  std::size_t count = setIntersect(a.data(), a.size(), b.data(), b.size(), pos.data());
+  set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected));
+  CHECK(taken(a, b, pos, count) == expected);
+
+  expected.clear();
+  count = setUnite(a.data(), a.size(), b.data(), b.size(), pos.data());
+  set_union(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected));
+  CHECK(taken(a, b, pos, count) == expected);
+  /// Равные ключи объединения берутся из a
+  for (std::size_t i = 0; i < count; i++) {
+    if (pos[i] & SET_FROM_B) {
+      CHECK(!binary_search(a.begin(), a.end(), b[pos[i] & ~SET_FROM_B]));
+    }
+  }
+
+  expected.clear();
+  count = setSubtract(a.data(), a.size(), b.data(), b.size(), pos.data());
+  set_difference(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected));
+  CHECK(taken(a, b, pos, count) == expected);
+}
+
+void check_both(const vector<unsigned long long> &x, const vector<unsigned long long> &y) {
+  check_pair<u32>(x, y, [](unsigned long long key) { return (u32) key; });
+  check_pair<data_t>(x, y, to_key);
+}
+
+/// Все длины хвостов блоков до нескольких блоков AVX2 при разной плотности общих ключей
+void test_tails() {
+  mt19937_64 gen(1);
+  for (std::size_t na = 0; na <= 40; na++) {
+    for (std::size_t nb = 0; nb <= 40; nb++) {
+      for (unsigned long long range : { 48ull, 200ull }) {
+        auto x = sorted_keys(gen, na, range);
+        auto y = sorted_keys(gen, nb, range);
+        check_both(x, y);
+      }
+    }
+  }
+}
+
+/// Одинаковые, непересекающиеся и чередующиеся массивы
+void test_layouts() {
+  vector<unsigned long long> x, odd, high;
+  for (unsigned long long i = 0; i < 1000; i++) {
+    x.push_back(2 * i);
+    odd.push_back(2 * i + 1);
+    high.push_back(5000 + i);
+  }
+  check_both(x, x);
+  check_both(x, odd);
+  check_both(x, high);
+  check_both(high, x);
+  check_both(x, {});
+  check_both({}, x);
+}
+
+/// Массивы, различные в SET_GALLOP_RATIO и более раз: пересечение и разность идут галопом
+void test_skewed() {
+  mt19937_64 gen(2);
+  for (std::size_t small : { 1, 3, 17, 64 }) {
+    std::size_t large = small * SET_GALLOP_RATIO * 3 + 5;
+    auto x = sorted_keys(gen, small, large * 2);
+    auto y = sorted_keys(gen, large, large * 2);
+    check_both(x, y);
+    check_both(y, x);
+  }
+}
+
+/// Ключи с различными старшими словами: слова ключа сравниваются как одно машинное слово
+void test_wide() {
+  mt19937_64 gen(3);
+  for (int round = 0; round < 20; round++) {
+    auto x = sorted_keys(gen, 300, 1000);
+    auto y = sorted_keys(gen, 300, 1000);
+    for (auto &ex : x) {
+      ex = (ex % 8) << 32 | ex;
+    }
+    for (auto &ex : y) {
+      ex = (ex % 8) << 32 | ex;
+    }
+    sort(x.begin(), x.end());
+    sort(y.begin(), y.end());
+    check_pair<data_t>(x, y, to_key);
+  }
+}
+
+int main() {
+  for (const char *isa : { "avx2", "sse", "scalar" }) {
+    if (!setKernelsUse(isa)) {
+      cout << "set_kernels: " << isa << " is not supported by host" << endl;
+      continue;
+    }
+    test_tails();
+    test_layouts();
+    test_skewed();
+    test_wide();
+  }
+  return check_report("set_kernels");
+}
@@ -0,0 +1,119 @@
+//
+// Simulator bulk load tests: build() of sorted, unsorted and repeating batches with sequential and
+// parallel sort, merge into existing pairs and append on the right, against std::map
+//
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include "check.h"
+#include "../libspu/cursor.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+using Reference = map<unsigned long long, unsigned long long>;
+
+data_t to_data(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+unsigned long long from_data(const data_t &data) {
+  unsigned long long ret = data.cont[0];
+#if SPU_WEIGHT > 1
+  ret |= (unsigned long long) data.cont[1] << 32;
+#endif
+  return ret;
+}
+
+/// Пары структуры по возрастанию совпадают с std::map
+bool same(Simulator &structure, const Reference &ref) {
+  if (structure.get_power() != ref.size()) {
+    return false;
+  }
+  BaseStructure::PairVector pairs = structure.scan({0}, lastKey(), ref.size() + 1);
+  if (pairs.size() != ref.size()) {
+    return false;
+  }
+  auto it = ref.begin();
+  for (auto &ex : pairs) {
+    if (ex.key != to_data(it->first) || ex.value != to_data(it->second)) {
+      return false;
+    }
+    ++it;
+  }
+  return true;
+}
+
+/// Пакет вставляется целиком; из равных ключей пакета остается последний
+void load(Simulator &structure, Reference &ref, const BaseStructure::InsertVector &batch) {
+  CHECK(structure.insert(batch) == OK);
+  for (auto &ex : batch) {
+    ref[from_data(ex.key)] = from_data(ex.value);
+  }
+}
+
+BaseStructure::InsertVector random_batch(mt19937_64 &gen, std::size_t n, unsigned long long range) {
+  BaseStructure::InsertVector ret;
+  for (std::size_t i = 0; i < n; i++) {
+    ret.push_back({ to_data(gen() % range), to_data(gen()) });
+  }
+  return ret;
+}
+
+void test_sort(u32 threads) {
+  mt19937_64 gen(21 + threads);
+  Simulator structure;
+  structure.set_sort_threads(threads);
+  Reference ref;
+
+  /// Неупорядоченный пакет больше порога параллельной сортировки с повторами ключей
+  load(structure, ref, random_batch(gen, SIM_PARALLEL_SORT_MIN * 3 + 17, SIM_PARALLEL_SORT_MIN * 2));
+  CHECK(same(structure, ref));
+
+  /// Слияние с парами структуры: пакет не меньше структуры / SIM_MERGE_RATIO
+  load(structure, ref, random_batch(gen, ref.size() / SIM_MERGE_RATIO + 1, SIM_PARALLEL_SORT_MIN * 4));
+  CHECK(same(structure, ref));
+}
+
+void test_sorted() {
+  Simulator structure;
+  Reference ref;
+  BaseStructure::InsertVector batch;
+  for (unsigned long long key = 0; key < 50000; key++) {
+    batch.push_back({ to_data(key * 3), to_data(key) });
+  }
+  load(structure, ref, batch);
+  CHECK(same(structure, ref));
+
+  /// Ключи правее структуры вставляются в правый край
+  batch.clear();
+  for (unsigned long long key = 200000; key < 260000; key++) {
+    batch.push_back({ to_data(key), to_data(key + 1) });
+  }
+  load(structure, ref, batch);
+  CHECK(same(structure, ref));
+
+  /// Пакет из равных ключей и пустой пакет
+  batch.assign(5, { to_data(7), to_data(1) });
+  batch.push_back({ to_data(7), to_data(2) });
+  load(structure, ref, batch);
+  load(structure, ref, {});
+  CHECK(same(structure, ref));
+  CHECK(structure.search(to_data(7)).value == to_data(2));
+}
+
+int main() {
+  for (u32 threads : { 1u, 3u, 4u, 0u }) {
+    test_sort(threads);
+  }
+  test_sorted();
+  return check_report("simulator_build");
+}
@@ -0,0 +1,110 @@
+//
+// SPU queues tests: results of commands without P flag are drained in order of execution,
+// Q flag queues commands of stalled SPU, QERR and OERR, R flag and removed structures
+//
+
+#include "check.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/Simulator.h"
+#include "../simulator/SpuQueues.h"
+
+using namespace std;
+using namespace SPU;
+
+data_t to_data(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+/// Результаты SRCH ключей first, first + 1, ... в порядке подачи
+bool in_order(const BaseStructure::PairVector &found, unsigned long long first) {
+  for (std::size_t i = 0; i < found.size(); i++) {
+    if (found[i].status != OK || found[i].key != to_data(first + i) || found[i].value != to_data(100 + first + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void test_order() {
+  SpuQueues queues(4, 3);
+  Simulator structure;
+  for (unsigned long long key = 0; key < 20; key++) {
+    structure.insert(to_data(key), to_data(100 + key), P_FLAG);
+  }
+  structure.set_queues(&queues);
+
+  /// Результаты без флага P копятся в SPU2CPU, заполненная очередь останавливает СП
+  for (unsigned long long key = 0; key < 3; key++) {
+    CHECK(structure.search(to_data(key), NO_FLAGS).status == OK);
+  }
+  CHECK(queues.results() == 3);
+  CHECK(structure.search(to_data(3), NO_FLAGS).status == QERR);
+  CHECK(structure.search(to_data(3), P_FLAG).status == OK);
+
+  /// Команды с флагом Q ждут в SYS2SPU, лишняя команда отвергается
+  for (unsigned long long key = 3; key < 7; key++) {
+    CHECK(structure.search(to_data(key), Q_FLAG).status == OK);
+  }
+  CHECK(queues.pending() == 4);
+  CHECK(structure.search(to_data(7), Q_FLAG).status == OERR);
+  CHECK(queues.overflows() == 1);
+  /// Пока в SYS2SPU есть команды, команда с флагом P не выполняется
+  CHECK(structure.search(to_data(0), P_FLAG).status == QERR);
+
+  /// Извлечение освобождает место: команды очереди выполняются в порядке подачи
+  BaseStructure::PairVector found = queues.drain(2);
+  CHECK(found.size() == 2 && in_order(found, 0));
+  CHECK(queues.pending() == 2 && queues.results() == 3);
+  found = queues.drain();
+  CHECK(found.size() == 5 && in_order(found, 2));
+  CHECK(queues.pending() == 0 && queues.results() == 0);
+
+  /// INS в очереди выполняется до следующего за ним SRCH
+  structure.insert(to_data(50), to_data(150), NO_FLAGS);
+  structure.insert(to_data(51), to_data(151), NO_FLAGS);
+  structure.insert(to_data(52), to_data(152), NO_FLAGS);
+  CHECK(structure.insert(to_data(53), to_data(153), Q_FLAG) == OK);
+  CHECK(structure.search(to_data(53), Q_FLAG).status == OK);
+  found = queues.drain();
+  CHECK(found.size() == 5 && in_order({ found[4] }, 53));
+
+  /// Флаг R сбрасывает обе очереди
+  for (unsigned long long key = 0; key < 5; key++) {
+    structure.search(to_data(key), Q_FLAG);
+  }
+  CHECK(queues.results() == 3 && queues.pending() == 2);
+  CHECK(structure.search(to_data(9), R_FLAG | P_FLAG).status == OK);
+  CHECK(queues.results() == 0 && queues.pending() == 0);
+  structure.set_queues(nullptr);
+}
+
+/// Команды удаляемой структуры удаляются из SYS2SPU, команды других структур остаются
+void test_forget() {
+  SpuQueues queues(8, 1);
+  Simulator kept;
+  kept.insert(to_data(1), to_data(101), P_FLAG);
+  kept.set_queues(&queues);
+  {
+    Simulator removed;
+    removed.set_queues(&queues);
+    CHECK(kept.search(to_data(1), NO_FLAGS).status == OK);
+    CHECK(removed.search(to_data(1), Q_FLAG).status == OK);
+    CHECK(kept.search(to_data(1), Q_FLAG).status == OK);
+    CHECK(queues.pending() == 2);
+  }
+  CHECK(queues.pending() == 1);
+  BaseStructure::PairVector found = queues.drain();
+  CHECK(found.size() == 2 && in_order({ found[0] }, 1) && in_order({ found[1] }, 1));
+  kept.set_queues(nullptr);
+}
+
+int main() {
+  test_order();
+  test_forget();
+  return check_report("spu_queues");
+}
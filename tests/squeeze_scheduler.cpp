@@ -0,0 +1,94 @@
+//
+// Squeeze scheduler tests: due() thresholds, order of squeezes by count of deletes and background
+// squeezes only while SPU lock is free
+//
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "check.h"
+#include "../libspu/squeeze_scheduler.h"
+#include "../libspu/data_container_operators.h"
+#include "../simulator/Simulator.h"
+
+using namespace std;
+using namespace SPU;
+
+data_t to_data(unsigned long long x) {
+  data_t ret = {0};
+  ret.cont[0] = (u32) x;
+#if SPU_WEIGHT > 1
+  ret.cont[1] = (u32) (x >> 32);
+#endif
+  return ret;
+}
+
+/// Структура из power пар после deletes удалений
+void fill(Simulator &structure, u32 power, u32 deletes) {
+  for (u32 i = 0; i < power + deletes; i++) {
+    structure.insert(to_data(i), to_data(i));
+  }
+  for (u32 i = 0; i < deletes; i++) {
+    structure.del(to_data(i));
+  }
+}
+
+void test_order() {
+  SqueezeScheduler scheduler(200, 25);
+  Simulator a, b, few, big;
+  fill(a, 300, 300);
+  fill(b, 300, 500);
+  fill(few, 10, 100);
+  fill(big, 3000, 400);
+  for (Simulator *ex : { &a, &b, &few, &big }) {
+    scheduler.add(*ex);
+  }
+  scheduler.add(a);
+
+  /// Мало удалений или малая их доля среди занятых ячеек
+  CHECK(scheduler.due(a) && scheduler.due(b));
+  CHECK(!scheduler.due(few) && !scheduler.due(big));
+
+  /// Первой сжимается структура с наибольшим числом удалений
+  CHECK(scheduler.run(1) == 1);
+  CHECK(b.get_deleted() == 0 && b.get_holes() == 0 && b.get_power() == 300);
+  CHECK(a.get_deleted() == 300);
+  CHECK(scheduler.run() == 1);
+  CHECK(a.get_deleted() == 0 && a.get_power() == 300);
+  CHECK(few.get_deleted() == 100 && big.get_deleted() == 400);
+  CHECK(scheduler.run() == 0);
+  CHECK(scheduler.squeezed() == 2);
+
+  /// Удаленная из планировщика структура не сжимается
+  fill(b, 0, 400);
+  scheduler.remove(b);
+  CHECK(scheduler.run() == 0 && b.get_deleted() == 400);
+}
+
+/// Фоновый поток не сжимает структуры, пока приложение держит lock
+void test_background() {
+  SqueezeScheduler scheduler(10, 10);
+  Simulator structure;
+  fill(structure, 100, 100);
+  scheduler.add(structure);
+
+  mutex lock;
+  lock.lock();
+  scheduler.start(lock, 2);
+  this_thread::sleep_for(chrono::milliseconds(50));
+  CHECK(structure.get_deleted() == 100);
+  lock.unlock();
+
+  for (int i = 0; i < 2000 && scheduler.squeezed() == 0; i++) {
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  scheduler.stop();
+  CHECK(scheduler.squeezed() == 1);
+  CHECK(structure.get_deleted() == 0 && structure.get_power() == 100);
+}
+
+int main() {
+  test_order();
+  test_background();
+  return check_report("squeeze_scheduler");
+}
@@ -0,0 +1,358 @@
+//
+// Schema generator: emits C++ layouts of SPU keys and values from schema file
+//
+// Usage: schema_gen <schema file> <output header> <SPU_WEIGHT>
+//
+// Schema file:
+//   # comment
+//   namespace <name>
+//   layout <Name>                     -- reusable layout
+//     <field> <width> [uint|int|bool|bitset]
+//     <field> <Layout>                -- nested layout
+//   end
+//   structure <Name>                  -- emits <Name>Key, <Name>Value and SchemaStructure <Name>
+//     key   <field> <width> [codec] | key   <field> <Layout>
+//     value <field> <width> [codec] | value <field> <Layout>
+//   end
+//
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Field {
+  string name;
+  unsigned width;
+  string codec;     // uint, int, bool, bitset or empty for nested
+  string layout;    // Nested layout name
+};
+
+struct Layout {
+  string name;
+  vector<Field> fields;
+  unsigned width;
+};
+
+/// Поле с абсолютным смещением после развертки вложенных раскладок
+struct Leaf {
+  vector<string> path;
+  unsigned offset;
+  unsigned width;
+  string codec;
+};
+
+map<string, Layout> layouts;
+vector<string> order;           // Layouts in order of declaration
+string ns = "schema";
+unsigned weight;
+
+[[noreturn]] void fail(const string &file, unsigned line, const string &what) {
+  throw runtime_error(file + ":" + to_string(line) + ": " + what);
+}
+
+bool isIdentifier(const string &name) {
+  if (name.empty() || isdigit((unsigned char) name[0])) {
+    return false;
+  }
+  return all_of(name.begin(), name.end(), [](char c) { return isalnum((unsigned char) c) || c == '_'; });
+}
+
+/// Разбор строки поля: <field> <width> [codec] или <field> <Layout>
+Field parseField(istringstream &in, const string &file, unsigned line) {
+  Field field;
+  string type;
+  if (!(in >> field.name >> type)) {
+    fail(file, line, "field name and type expected");
+  }
+  if (!isIdentifier(field.name) || field.name == "width" || field.name == "pack" ||
+      field.name == "unpack" || field.name == "descriptor") {
+    fail(file, line, "bad field name '" + field.name + "'");
+  }
+
+  if (isdigit((unsigned char) type[0])) {
+    field.width = stoul(type);
+    field.codec = "uint";
+    in >> field.codec;
+    if (field.codec != "uint" && field.codec != "int" && field.codec != "bool" && field.codec != "bitset") {
+      fail(file, line, "unknown codec '" + field.codec + "'");
+    }
+    if (field.width == 0 || field.width > 64) {
+      fail(file, line, "width of scalar field has to be 1..64");
+    }
+  } else {
+    auto it = layouts.find(type);
+    if (it == layouts.end()) {
+      fail(file, line, "unknown layout '" + type + "'");
+    }
+    field.layout = type;
+    field.width = it->second.width;
+  }
+  return field;
+}
+
+void addLayout(Layout layout, const string &file, unsigned line) {
+  layout.width = 0;
+  for (auto &ex : layout.fields) {
+    layout.width += ex.width;
+  }
+  if (layout.width > weight * 32) {
+    fail(file, line, "layout " + layout.name + " is " + to_string(layout.width) +
+                     " bits wide, SPU data is " + to_string(weight * 32));
+  }
+  if (layouts.count(layout.name)) {
+    fail(file, line, "layout " + layout.name + " is already defined");
+  }
+  layouts[layout.name] = layout;
+  order.push_back(layout.name);
+}
+
+void parse(const string &file) {
+  ifstream in(file);
+  if (!in) {
+    throw runtime_error("could not open " + file);
+  }
+
+  string text;
+  unsigned line = 0;
+  Layout current, key, value;
+  enum { NONE, LAYOUT, STRUCTURE } state = NONE;
+  unsigned start = 0;
+
+  while (getline(in, text)) {
+    line++;
+    text = text.substr(0, text.find('#'));
+    istringstream words(text);
+    string word;
+    if (!(words >> word)) {
+      continue;
+    }
+
+    if (state == NONE) {
+      string name;
+      words >> name;
+      if (word == "namespace" && isIdentifier(name)) {
+        ns = name;
+      } else if ((word == "layout" || word == "structure") && isIdentifier(name)) {
+        state = word == "layout" ? LAYOUT : STRUCTURE;
+        current = { name, {}, 0 };
+        key     = { name + "Key", {}, 0 };
+        value   = { name + "Value", {}, 0 };
+        start   = line;
+      } else {
+        fail(file, line, "namespace, layout or structure expected");
+      }
+    } else if (word == "end") {
+      if (state == LAYOUT) {
+        addLayout(current, file, start);
+      } else {
+        addLayout(key, file, start);
+        addLayout(value, file, start);
+        current.fields = { { "", 0, "", key.name }, { "", 0, "", value.name } };
+        current.width = 0;
+        layouts[current.name + "#structure"] = current;
+        order.push_back(current.name + "#structure");
+      }
+      state = NONE;
+    } else if (state == LAYOUT) {
+      istringstream field(text);
+      current.fields.push_back(parseField(field, file, line));
+    } else {
+      if (word != "key" && word != "value") {
+        fail(file, line, "key or value expected");
+      }
+      (word == "key" ? key : value).fields.push_back(parseField(words, file, line));
+    }
+  }
+  if (state != NONE) {
+    fail(file, line, "end expected");
+  }
+}
+
+/// Развертка вложенных раскладок в список полей с абсолютными смещениями
+void flatten(const Layout &layout, unsigned base, vector<string> path, vector<Leaf> &leaves) {
+  unsigned offset = base;
+  for (auto &ex : layout.fields) {
+    vector<string> sub = path;
+    sub.push_back(ex.name);
+    if (ex.layout.empty()) {
+      leaves.push_back({ sub, offset, ex.width, ex.codec });
+    } else {
+      flatten(layouts[ex.layout], offset, sub, leaves);
+    }
+    offset += ex.width;
+  }
+}
+
+string join(const vector<string> &path, const string &sep) {
+  string ret;
+  for (auto &ex : path) {
+    ret += (ret.empty() ? "" : sep) + ex;
+  }
+  return ret;
+}
+
+string hex(unsigned long long value) {
+  ostringstream out;
+  out << "0x" << std::hex << value << (value > 0xffffffffULL ? "ULL" : "u");
+  return out.str();
+}
+
+string cppType(const Field &field) {
+  if (!field.layout.empty()) return field.layout;
+  if (field.codec == "bool") return "bool";
+  if (field.codec == "int") return field.width > 32 ? "long long" : "int";
+  return field.width > 32 ? "unsigned long long" : "u32";
+}
+
+string cppType(const Leaf &leaf) {
+  return cppType(Field{ "", leaf.width, leaf.codec, "" });
+}
+
+/// Чтение поля из слов данных: смещения известны при генерации
+string emitGet(const Leaf &leaf, const string &data) {
+  string raw;
+  for (unsigned done = 0; done < leaf.width; ) {
+    unsigned idx = (leaf.offset + done) / 32, shift = (leaf.offset + done) % 32;
+    unsigned cnt = min(32 - shift, leaf.width - done);
+    unsigned long long mask = cnt == 32 ? 0xffffffffULL : (1ULL << cnt) - 1;
+    raw += string(raw.empty() ? "" : " | ") + "( (unsigned long long) ( (" + data + ".cont[" + to_string(idx) + "] >> " +
+           to_string(shift) + ") & " + hex(mask) + " ) << " + to_string(done) + " )";
+    done += cnt;
+  }
+
+  if (leaf.codec == "bool") return "( " + raw + " ) != 0";
+  if (leaf.codec == "int") {
+    return "(" + cppType(leaf) + ") ( (long long) ( " + raw + " ) - (long long) " + hex(1ULL << (leaf.width - 1)) + " )";
+  }
+  return "(" + cppType(leaf) + ") ( " + raw + " )";
+}
+
+/// Запись поля в слова данных
+string emitSet(const Leaf &leaf, const string &data, const string &value, const string &indent) {
+  string raw = "(unsigned long long) " + value;
+  if (leaf.codec == "int") raw = "( (unsigned long long) (long long) " + value + " ^ " + hex(1ULL << (leaf.width - 1)) + " )";
+  if (leaf.codec == "bool") raw = "(unsigned long long) ( " + value + " ? 1 : 0 )";
+
+  string ret = indent + "unsigned long long raw = " + raw + ";\n";
+  for (unsigned done = 0; done < leaf.width; ) {
+    unsigned idx = (leaf.offset + done) / 32, shift = (leaf.offset + done) % 32;
+    unsigned cnt = min(32 - shift, leaf.width - done);
+    unsigned long long mask = cnt == 32 ? 0xffffffffULL : (1ULL << cnt) - 1;
+    string word = data + ".cont[" + to_string(idx) + "]";
+    ret += indent + word + " = ( " + word + " & ~" + hex((mask << shift) & 0xffffffffULL) + " ) | ( ( (u32) (raw >> " +
+           to_string(done) + ") & " + hex(mask) + " ) << " + to_string(shift) + " );\n";
+    done += cnt;
+  }
+  return ret;
+}
+
+void emitLayout(ostream &out, const Layout &layout) {
+  vector<Leaf> leaves;
+  flatten(layout, 0, {}, leaves);
+
+  out << "/* Layout " << layout.name << ", " << layout.width << " bits */\n";
+  out << "struct " << layout.name << "\n{\n";
+  out << "  static constexpr u32 width = " << layout.width << ";\n\n";
+
+  for (auto &ex : layout.fields) {
+    out << "  " << cppType(ex) << " " << ex.name << ";\n";
+  }
+
+  /* Unpack and pack of whole layout, nested fields are read by absolute offsets. */
+  /* Parameters of empty layout are unnamed: they are not read                    */
+  bool empty = leaves.empty();
+  out << "\n  static constexpr " << layout.name << " unpack(const data_t &" << (empty ? "" : "data") << ")\n  {\n";
+  out << "    " << layout.name << " ret{};\n";
+  for (auto &ex : leaves) {
+    out << "    ret." << join(ex.path, ".") << " = " << emitGet(ex, "data") << ";\n";
+  }
+  out << "    return ret;\n  }\n";
+
+  out << "\n  static constexpr data_t pack(const " << layout.name << " &" << (empty ? "" : "rec") << ")\n  {\n";
+  out << "    data_t ret{};\n";
+  for (auto &ex : leaves) {
+    out << "    {\n" << emitSet(ex, "ret", "rec." + join(ex.path, "."), "      ") << "    }\n";
+  }
+  out << "    return ret;\n  }\n";
+
+  /* Typed accessors of packed data */
+  for (auto &ex : leaves) {
+    string name = join(ex.path, "_");
+    out << "\n  static constexpr " << cppType(ex) << " get_" << name << "(const data_t &data) { return "
+        << emitGet(ex, "data") << "; }\n";
+    out << "  static constexpr void set_" << name << "(data_t &data, " << cppType(ex) << " value)\n  {\n"
+        << emitSet(ex, "data", "value", "    ") << "  }\n";
+    if (ex.codec == "bitset") {
+      out << "  static Bitset bitset_" << name << "(const data_t &data) { data_t bits{}; bits.cont[0] = (u32) get_" << name
+          << "(data); " << (weight > 1 ? "bits.cont[1] = (u32) ( (unsigned long long) get_" + name + "(data) >> 32 ); " : "")
+          << "return Bitset(bits, " << ex.width << "); }\n";
+    }
+  }
+
+  /* Descriptor for dump and load */
+  /* Empty layout (values of key-only structure) has no field array: zero-size arrays are not C++ */
+  out << "\n  static const schema_layout_t &descriptor()\n  {\n";
+  if (!leaves.empty()) {
+    out << "    static const schema_field_t fields[] = {\n";
+    for (auto &ex : leaves) {
+      string codec = ex.codec == "int" ? "SCHEMA_INT" : ex.codec == "bool" ? "SCHEMA_BOOL" :
+                     ex.codec == "bitset" ? "SCHEMA_BITSET" : "SCHEMA_UINT";
+      out << "      { \"" << join(ex.path, ".") << "\", " << ex.offset << ", " << ex.width << ", " << codec << " },\n";
+    }
+    out << "    };\n";
+  }
+  out << "    static const schema_layout_t layout = { \"" << layout.name << "\", " << layout.width << ", "
+      << (leaves.empty() ? "nullptr" : "fields") << ", " << leaves.size() << " };\n";
+  out << "    return layout;\n  }\n";
+  out << "};\n\n";
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 4) {
+    cerr << "Usage: " << argv[0] << " <schema file> <output header> <SPU_WEIGHT>" << endl;
+    return 1;
+  }
+
+  try {
+    weight = stoul(argv[3]);
+    parse(argv[1]);
+
+    ostringstream out;
+    string guard = "SCHEMA_" + ns + "_H";
+    transform(guard.begin(), guard.end(), guard.begin(), ::toupper);
+
+    out << "/*\n  Generated by schema_gen from " << argv[1] << ", do not edit\n*/\n\n";
+    out << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+    out << "#include \"schema.h\"\n\n";
+    out << "static_assert(SPU_WEIGHT == " << weight << ", \"Schema is generated for other SPU_WEIGHT\");\n\n";
+    out << "namespace " << ns << "\n{\n\nusing namespace SPU;\n\n";
+    for (auto &name : order) {
+      const Layout &layout = layouts[name];
+      if (name.find('#') == string::npos) {
+        emitLayout(out, layout);
+      } else {
+        out << "/* Structure " << layout.name << " */\n";
+        out << "using " << layout.name << " = SchemaStructure<" << layout.fields[0].layout << ", "
+            << layout.fields[1].layout << ">;\n\n";
+      }
+    }
+    out << "} /* namespace " << ns << " */\n\n#endif /* " << guard << " */\n";
+
+    ofstream file(argv[2]);
+    file << out.str();
+    if (!file) {
+      throw runtime_error(string("could not write ") + argv[2]);
+    }
+  } catch (exception &e) {
+    cerr << "schema_gen: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+//
+// SPU server: serves structures of SPU host to remote clients (libspu/remote.h)
+//
+// Usage: spu_server [-p <port>] [-a <address>] [-u <unix socket>] [-s]
+//   -p   TCP port, 7407 by default
+//   -a   address to listen, all addresses by default
+//   -u   Unix socket instead of TCP
+//   -s   emulated SPU: simulator structures behind register file, no board needed
+//
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "../libspu/server.h"
+#include "../libspu/mmio.h"
+#include "../simulator/RegisterFile.h"
+
+using namespace std;
+using namespace SPU;
+
+Server *running = nullptr;
+
+void onSignal(int) {
+  if (running) {
+    running->stop();
+  }
+}
+
+int main(int argc, char **argv) {
+  u32 port = REMOTE_PORT;
+  const char *address = nullptr;
+  const char *local = nullptr;
+  bool emulated = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+      port = (u32) atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-a") && i + 1 < argc) {
+      address = argv[++i];
+    } else if (!strcmp(argv[i], "-u") && i + 1 < argc) {
+      local = argv[++i];
+    } else if (!strcmp(argv[i], "-s")) {
+      emulated = true;
+    } else {
+      cerr << "Usage: " << argv[0] << " [-p <port>] [-a <address>] [-u <unix socket>] [-s]" << endl;
+      return 2;
+    }
+  }
+
+  unique_ptr<RegisterFile> regs;
+  unique_ptr<Mmio> mmio;
+  if (emulated) {
+    regs.reset(new RegisterFile());
+    mmio.reset(new Mmio(*regs));
+    mmio->reset();
+  }
+
+  Server server(mmio.get());
+  if (local ? !server.listenLocal(local) : !server.listenTcp(port, address)) {
+    cerr << "Could not listen on " << (local ? local : to_string(port)) << endl;
+    return 1;
+  }
+
+  running = &server;
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  server.run();
+  cout << server.requests() << " requests served" << endl;
+  return 0;
+}